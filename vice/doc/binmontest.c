@@ -0,0 +1,308 @@
+/*
+ * binmontest.c - loopback test client for the binary remote monitor.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+    Connects to an emulator started with -binarymonitor and runs every
+    command of the protocol (see src/monitor/monitor_binary.c) once,
+    checking the responses.  It also measures the round trip time of ping
+    while the machine runs, and queues a few megabytes of responses before
+    reading them, which must neither stall the emulation nor break the
+    connection.
+
+    gcc -Wall -o binmontest binmontest.c
+    x64 -binarymonitor &
+    ./binmontest [port]
+
+    Exits with 0 if all checks passed.  Unix only.
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define EVENT_ID 0xffffffffu
+
+static int sock;
+static unsigned int request_id = 0;
+static int failed = 0;
+
+typedef struct {
+    unsigned char type;
+    unsigned char error;
+    unsigned int id;
+    unsigned int length;
+    unsigned char *body;
+} response_t;
+
+static void put16(unsigned char *p, unsigned int v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void put32(unsigned char *p, unsigned int v)
+{
+    put16(p, v & 0xffff);
+    put16(p + 2, v >> 16);
+}
+
+static unsigned int get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int get32(const unsigned char *p)
+{
+    return get16(p) | (get16(p + 2) << 16);
+}
+
+static double now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void check(int ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) {
+        failed = 1;
+    }
+}
+
+static void recv_all(unsigned char *buf, unsigned int length)
+{
+    while (length > 0) {
+        ssize_t count = recv(sock, buf, length, 0);
+
+        if (count <= 0) {
+            printf("FAIL: connection lost\n");
+            exit(1);
+        }
+        buf += count;
+        length -= (unsigned int)count;
+    }
+}
+
+static unsigned int request(unsigned char command, const unsigned char *body, unsigned int length)
+{
+    unsigned char *buf = malloc(11 + length);
+
+    buf[0] = 0x02;
+    buf[1] = 0x01;
+    put32(&buf[2], length);
+    put32(&buf[6], ++request_id);
+    buf[10] = command;
+    if (length > 0) {
+        memcpy(&buf[11], body, length);
+    }
+    if (send(sock, buf, 11 + length, 0) != (ssize_t)(11 + length)) {
+        printf("FAIL: cannot send\n");
+        exit(1);
+    }
+    free(buf);
+    return request_id;
+}
+
+static void response(response_t *r)
+{
+    unsigned char header[12];
+
+    recv_all(header, sizeof header);
+    if (header[0] != 0x02 || header[1] != 0x01) {
+        printf("FAIL: bad response header\n");
+        exit(1);
+    }
+    r->length = get32(&header[2]);
+    r->type = header[6];
+    r->error = header[7];
+    r->id = get32(&header[8]);
+    r->body = malloc(r->length + 1);
+    recv_all(r->body, r->length);
+}
+
+/* Wait for the response to a request, skipping events and earlier
+   responses.  */
+static void wait_for(unsigned int id, response_t *r)
+{
+    for (;;) {
+        response(r);
+        if (r->id == id) {
+            return;
+        }
+        free(r->body);
+    }
+}
+
+static unsigned char simple(unsigned char command, const unsigned char *body, unsigned int length)
+{
+    response_t r;
+
+    wait_for(request(command, body, length), &r);
+    free(r.body);
+    return r.error;
+}
+
+int main(int argc, char **argv)
+{
+    struct sockaddr_in addr;
+    unsigned char body[16 + 0x100];
+    response_t r;
+    double start, worst = 0.0, total = 0.0;
+    unsigned int checknum, id, i, count;
+    unsigned long bytes;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(argc > 1 ? atoi(argv[1]) : 6502);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof addr) < 0) {
+        perror("connect");
+        return 1;
+    }
+
+    /* ping while the machine runs */
+    count = 0;
+    for (i = 0; i < 50; i++) {
+        start = now();
+        if (simple(0x81, NULL, 0) == 0x00) {
+            count++;
+        }
+        start = now() - start;
+        total += start;
+        if (start > worst) {
+            worst = start;
+        }
+    }
+    check(count == 50, "ping");
+    printf("ping: %.2f ms average, %.2f ms worst\n", total * 1000 / 50, worst * 1000);
+
+    /* stop, the stopped event comes after the response */
+    check(simple(0xab, NULL, 0) == 0x00, "stop");
+    do {
+        response(&r);
+        free(r.body);
+    } while (r.type != 0x62 || r.id != EVENT_ID);
+    check(1, "stopped event");
+
+    /* mem set and get */
+    body[0] = 0;
+    put16(&body[1], 0xc000);
+    put16(&body[3], 0xc0ff);
+    body[5] = 0;
+    put16(&body[6], 0);
+    for (i = 0; i < 0x100; i++) {
+        body[8 + i] = (unsigned char)(i ^ 0x5a);
+    }
+    check(simple(0x02, body, 8 + 0x100) == 0x00, "mem set");
+    wait_for(request(0x01, body, 8), &r);
+    check(r.error == 0x00 && r.length == 0x100 && memcmp(r.body, &body[8], 0x100) == 0,
+          "mem get");
+    free(r.body);
+    body[5] = 9;
+    check(simple(0x01, body, 8) == 0x02, "mem get, invalid memspace");
+    check(simple(0x01, body, 3) == 0x80, "mem get, wrong length");
+
+    /* registers */
+    body[0] = 0;
+    wait_for(request(0x31, body, 1), &r);
+    count = r.length >= 2 ? get16(r.body) : 0;
+    check(r.error == 0x00 && count > 0 && r.length == 2 + count * 4, "regs get");
+    free(r.body);
+
+    /* checkpoints and conditions */
+    put16(&body[0], 0xc000);
+    put16(&body[2], 0xc000);
+    body[4] = 1;
+    body[5] = 1;
+    body[6] = 4;
+    body[7] = 0;
+    body[8] = 0;
+    wait_for(request(0x12, body, 9), &r);
+    check(r.error == 0x00 && r.length == 22, "cp set");
+    checknum = get32(r.body);
+    free(r.body);
+
+    put32(&body[0], checknum);
+    body[4] = 7;
+    memcpy(&body[5], "A == $1", 7);
+    check(simple(0x22, body, 12) == 0x00, "condition");
+    wait_for(request(0x11, body, 4), &r);
+    check(r.error == 0x00 && r.body[20] == 1, "cp get, has condition");
+    free(r.body);
+    body[4] = 3;
+    memcpy(&body[5], "))(", 3);
+    check(simple(0x22, body, 8) == 0x81, "condition, parse error with a condition set");
+
+    id = request(0x14, NULL, 0);
+    count = 0;
+    for (;;) {
+        wait_for(id, &r);
+        if (r.type != 0x11) {
+            break;
+        }
+        count++;
+        free(r.body);
+    }
+    check(r.error == 0x00 && r.type == 0x14 && r.length == 4 && get32(r.body) == count,
+          "cp list");
+    free(r.body);
+    check(simple(0x13, body, 4) == 0x00, "cp delete");
+    check(simple(0x11, body, 4) == 0x01, "cp get, deleted");
+
+    check(simple(0x7f, NULL, 0) == 0x83, "unknown command");
+
+    /* resume, then queue responses without reading them */
+    check(simple(0xaa, NULL, 0) == 0x00, "exit");
+    body[0] = 0;
+    put16(&body[1], 0x0000);
+    put16(&body[3], 0xffff);
+    body[5] = 0;
+    put16(&body[6], 0);
+    for (i = 0; i < 64; i++) {
+        request(0x01, body, 8);
+    }
+    sleep(2);
+    id = request(0x81, NULL, 0);
+    bytes = 0;
+    do {
+        response(&r);
+        if (r.type == 0x01) {
+            bytes += r.length;
+        }
+        free(r.body);
+    } while (r.id != id);
+    check(bytes == 64 * 0x10000ul, "queued mem get");
+    check(simple(0x81, NULL, 0) == 0x00, "ping after queued responses");
+
+    close(sock);
+    return failed;
+}
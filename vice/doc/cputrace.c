@@ -0,0 +1,424 @@
+/*
+ * cputrace.c - disassemble, summarize and compare binary CPU traces.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+    Reads the traces written by the monitor command cputrace, the format
+    is described in src/monitor/mon_cputrace.c.  Compressed and plain
+    traces are both read.
+
+    gcc -Wall -o cputrace cputrace.c -lz
+
+    ./cputrace dis <trace> [<first> [<count>]]
+        Print the records as disassembly, with the registers before the
+        instruction and the memory operand.
+
+    ./cputrace cov <trace>
+        Print the address ranges executed by each CPU, with the number of
+        instructions executed in each range.
+
+    ./cputrace diff <trace1> <trace2> [<context>]
+        Print the first record where the traces differ, and the records
+        before it.  Exits with 1 if the traces differ.
+
+    Opcodes are shown as NMOS 6502 opcodes, also for 65C02 drives.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define TRACE_VERSION       2
+#define RECORD_SIZE         20
+#define BUFFER_RECORDS      4096
+#define NUM_MEMSPACES       6
+
+enum { IMP, ACC, IMM, ZP, ZPX, ZPY, ABS, ABX, ABY, IND, IZX, IZY, REL };
+
+static const int mode_size[] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 2, 2, 2 };
+
+static const struct {
+    const char *name;
+    int mode;
+} opcodes[0x100] = {
+    /* 00 */ { "BRK",  IMP }, { "ORA",  IZX }, { "JAM",  IMP }, { "SLO",  IZX },
+    /* 04 */ { "NOOP", ZP  }, { "ORA",  ZP  }, { "ASL",  ZP  }, { "SLO",  ZP  },
+    /* 08 */ { "PHP",  IMP }, { "ORA",  IMM }, { "ASL",  ACC }, { "ANC",  IMM },
+    /* 0c */ { "NOOP", ABS }, { "ORA",  ABS }, { "ASL",  ABS }, { "SLO",  ABS },
+    /* 10 */ { "BPL",  REL }, { "ORA",  IZY }, { "JAM",  IMP }, { "SLO",  IZY },
+    /* 14 */ { "NOOP", ZPX }, { "ORA",  ZPX }, { "ASL",  ZPX }, { "SLO",  ZPX },
+    /* 18 */ { "CLC",  IMP }, { "ORA",  ABY }, { "NOOP", IMP }, { "SLO",  ABY },
+    /* 1c */ { "NOOP", ABX }, { "ORA",  ABX }, { "ASL",  ABX }, { "SLO",  ABX },
+    /* 20 */ { "JSR",  ABS }, { "AND",  IZX }, { "JAM",  IMP }, { "RLA",  IZX },
+    /* 24 */ { "BIT",  ZP  }, { "AND",  ZP  }, { "ROL",  ZP  }, { "RLA",  ZP  },
+    /* 28 */ { "PLP",  IMP }, { "AND",  IMM }, { "ROL",  ACC }, { "ANC",  IMM },
+    /* 2c */ { "BIT",  ABS }, { "AND",  ABS }, { "ROL",  ABS }, { "RLA",  ABS },
+    /* 30 */ { "BMI",  REL }, { "AND",  IZY }, { "JAM",  IMP }, { "RLA",  IZY },
+    /* 34 */ { "NOOP", ZPX }, { "AND",  ZPX }, { "ROL",  ZPX }, { "RLA",  ZPX },
+    /* 38 */ { "SEC",  IMP }, { "AND",  ABY }, { "NOOP", IMP }, { "RLA",  ABY },
+    /* 3c */ { "NOOP", ABX }, { "AND",  ABX }, { "ROL",  ABX }, { "RLA",  ABX },
+    /* 40 */ { "RTI",  IMP }, { "EOR",  IZX }, { "JAM",  IMP }, { "SRE",  IZX },
+    /* 44 */ { "NOOP", ZP  }, { "EOR",  ZP  }, { "LSR",  ZP  }, { "SRE",  ZP  },
+    /* 48 */ { "PHA",  IMP }, { "EOR",  IMM }, { "LSR",  ACC }, { "ASR",  IMM },
+    /* 4c */ { "JMP",  ABS }, { "EOR",  ABS }, { "LSR",  ABS }, { "SRE",  ABS },
+    /* 50 */ { "BVC",  REL }, { "EOR",  IZY }, { "JAM",  IMP }, { "SRE",  IZY },
+    /* 54 */ { "NOOP", ZPX }, { "EOR",  ZPX }, { "LSR",  ZPX }, { "SRE",  ZPX },
+    /* 58 */ { "CLI",  IMP }, { "EOR",  ABY }, { "NOOP", IMP }, { "SRE",  ABY },
+    /* 5c */ { "NOOP", ABX }, { "EOR",  ABX }, { "LSR",  ABX }, { "SRE",  ABX },
+    /* 60 */ { "RTS",  IMP }, { "ADC",  IZX }, { "JAM",  IMP }, { "RRA",  IZX },
+    /* 64 */ { "NOOP", ZP  }, { "ADC",  ZP  }, { "ROR",  ZP  }, { "RRA",  ZP  },
+    /* 68 */ { "PLA",  IMP }, { "ADC",  IMM }, { "ROR",  ACC }, { "ARR",  IMM },
+    /* 6c */ { "JMP",  IND }, { "ADC",  ABS }, { "ROR",  ABS }, { "RRA",  ABS },
+    /* 70 */ { "BVS",  REL }, { "ADC",  IZY }, { "JAM",  IMP }, { "RRA",  IZY },
+    /* 74 */ { "NOOP", ZPX }, { "ADC",  ZPX }, { "ROR",  ZPX }, { "RRA",  ZPX },
+    /* 78 */ { "SEI",  IMP }, { "ADC",  ABY }, { "NOOP", IMP }, { "RRA",  ABY },
+    /* 7c */ { "NOOP", ABX }, { "ADC",  ABX }, { "ROR",  ABX }, { "RRA",  ABX },
+    /* 80 */ { "NOOP", IMM }, { "STA",  IZX }, { "NOOP", IMM }, { "SAX",  IZX },
+    /* 84 */ { "STY",  ZP  }, { "STA",  ZP  }, { "STX",  ZP  }, { "SAX",  ZP  },
+    /* 88 */ { "DEY",  IMP }, { "NOOP", IMM }, { "TXA",  IMP }, { "ANE",  IMM },
+    /* 8c */ { "STY",  ABS }, { "STA",  ABS }, { "STX",  ABS }, { "SAX",  ABS },
+    /* 90 */ { "BCC",  REL }, { "STA",  IZY }, { "JAM",  IMP }, { "SHA",  IZY },
+    /* 94 */ { "STY",  ZPX }, { "STA",  ZPX }, { "STX",  ZPY }, { "SAX",  ZPY },
+    /* 98 */ { "TYA",  IMP }, { "STA",  ABY }, { "TXS",  IMP }, { "SHS",  ABY },
+    /* 9c */ { "SHY",  ABX }, { "STA",  ABX }, { "SHX",  ABY }, { "SHA",  ABY },
+    /* a0 */ { "LDY",  IMM }, { "LDA",  IZX }, { "LDX",  IMM }, { "LAX",  IZX },
+    /* a4 */ { "LDY",  ZP  }, { "LDA",  ZP  }, { "LDX",  ZP  }, { "LAX",  ZP  },
+    /* a8 */ { "TAY",  IMP }, { "LDA",  IMM }, { "TAX",  IMP }, { "LXA",  IMM },
+    /* ac */ { "LDY",  ABS }, { "LDA",  ABS }, { "LDX",  ABS }, { "LAX",  ABS },
+    /* b0 */ { "BCS",  REL }, { "LDA",  IZY }, { "JAM",  IMP }, { "LAX",  IZY },
+    /* b4 */ { "LDY",  ZPX }, { "LDA",  ZPX }, { "LDX",  ZPY }, { "LAX",  ZPY },
+    /* b8 */ { "CLV",  IMP }, { "LDA",  ABY }, { "TSX",  IMP }, { "LAS",  ABY },
+    /* bc */ { "LDY",  ABX }, { "LDA",  ABX }, { "LDX",  ABY }, { "LAX",  ABY },
+    /* c0 */ { "CPY",  IMM }, { "CMP",  IZX }, { "NOOP", IMM }, { "DCP",  IZX },
+    /* c4 */ { "CPY",  ZP  }, { "CMP",  ZP  }, { "DEC",  ZP  }, { "DCP",  ZP  },
+    /* c8 */ { "INY",  IMP }, { "CMP",  IMM }, { "DEX",  IMP }, { "SBX",  IMM },
+    /* cc */ { "CPY",  ABS }, { "CMP",  ABS }, { "DEC",  ABS }, { "DCP",  ABS },
+    /* d0 */ { "BNE",  REL }, { "CMP",  IZY }, { "JAM",  IMP }, { "DCP",  IZY },
+    /* d4 */ { "NOOP", ZPX }, { "CMP",  ZPX }, { "DEC",  ZPX }, { "DCP",  ZPX },
+    /* d8 */ { "CLD",  IMP }, { "CMP",  ABY }, { "NOOP", IMP }, { "DCP",  ABY },
+    /* dc */ { "NOOP", ABX }, { "CMP",  ABX }, { "DEC",  ABX }, { "DCP",  ABX },
+    /* e0 */ { "CPX",  IMM }, { "SBC",  IZX }, { "NOOP", IMM }, { "ISB",  IZX },
+    /* e4 */ { "CPX",  ZP  }, { "SBC",  ZP  }, { "INC",  ZP  }, { "ISB",  ZP  },
+    /* e8 */ { "INX",  IMP }, { "SBC",  IMM }, { "NOP",  IMP }, { "USBC",IMM },
+    /* ec */ { "CPX",  ABS }, { "SBC",  ABS }, { "INC",  ABS }, { "ISB",  ABS },
+    /* f0 */ { "BEQ",  REL }, { "SBC",  IZY }, { "JAM",  IMP }, { "ISB",  IZY },
+    /* f4 */ { "NOOP", ZPX }, { "SBC",  ZPX }, { "INC",  ZPX }, { "ISB",  ZPX },
+    /* f8 */ { "SED",  IMP }, { "SBC",  ABY }, { "NOOP", IMP }, { "ISB",  ABY },
+    /* fc */ { "NOOP", ABX }, { "SBC",  ABX }, { "INC",  ABX }, { "ISB",  ABX },
+};
+
+static const char *memspace_name[NUM_MEMSPACES] = { "?", "C", "8", "9", "10", "11" };
+
+typedef struct {
+    gzFile fd;
+    const char *name;
+    unsigned char buffer[RECORD_SIZE * BUFFER_RECORDS];
+    unsigned int len;
+    unsigned int pos;
+    unsigned long index;
+} trace_t;
+
+static void trace_open(trace_t *t, const char *name)
+{
+    unsigned char header[16];
+
+    t->name = name;
+    t->fd = gzopen(name, "rb");
+    if (t->fd == NULL) {
+        fprintf(stderr, "cannot open `%s'\n", name);
+        exit(2);
+    }
+    if (gzread(t->fd, header, sizeof header) != sizeof header
+        || memcmp(header, "VICE CPU TRACE", 14) != 0) {
+        fprintf(stderr, "`%s' is not a CPU trace\n", name);
+        exit(2);
+    }
+    if (header[14] != TRACE_VERSION || header[15] != RECORD_SIZE) {
+        fprintf(stderr, "`%s' has format version %d, need %d\n",
+                name, header[14], TRACE_VERSION);
+        exit(2);
+    }
+    t->len = 0;
+    t->pos = 0;
+    t->index = 0;
+}
+
+/* Return the next record, or NULL at the end of the trace.  */
+static const unsigned char *trace_next(trace_t *t)
+{
+    const unsigned char *rec;
+
+    if (t->pos == t->len) {
+        int count = gzread(t->fd, t->buffer, sizeof t->buffer);
+
+        if (count < 0) {
+            fprintf(stderr, "cannot read `%s'\n", t->name);
+            exit(2);
+        }
+        t->len = (unsigned int)count - (unsigned int)count % RECORD_SIZE;
+        t->pos = 0;
+        if (t->len == 0) {
+            return NULL;
+        }
+    }
+    rec = t->buffer + t->pos;
+    t->pos += RECORD_SIZE;
+    t->index++;
+    return rec;
+}
+
+static unsigned int get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned long get32(const unsigned char *p)
+{
+    return get16(p) | ((unsigned long)get16(p + 2) << 16);
+}
+
+static void print_record(const char *prefix, unsigned long index, const unsigned char *rec)
+{
+    unsigned int pc = get16(rec + 4);
+    unsigned int op = rec[7], p1 = rec[8], p2 = rec[9];
+    unsigned int abs = p1 | (p2 << 8);
+    char operand[16], flags[9];
+    const char *bits = "NV-BDIZC";
+    int i;
+
+    switch (opcodes[op].mode) {
+        case ACC:
+            strcpy(operand, "A");
+            break;
+        case IMM:
+            sprintf(operand, "#$%02X", p1);
+            break;
+        case ZP:
+            sprintf(operand, "$%02X", p1);
+            break;
+        case ZPX:
+            sprintf(operand, "$%02X,X", p1);
+            break;
+        case ZPY:
+            sprintf(operand, "$%02X,Y", p1);
+            break;
+        case ABS:
+            sprintf(operand, "$%04X", abs);
+            break;
+        case ABX:
+            sprintf(operand, "$%04X,X", abs);
+            break;
+        case ABY:
+            sprintf(operand, "$%04X,Y", abs);
+            break;
+        case IND:
+            sprintf(operand, "($%04X)", abs);
+            break;
+        case IZX:
+            sprintf(operand, "($%02X,X)", p1);
+            break;
+        case IZY:
+            sprintf(operand, "($%02X),Y", p1);
+            break;
+        case REL:
+            sprintf(operand, "$%04X", (pc + 2 + (signed char)p1) & 0xffff);
+            break;
+        default:
+            operand[0] = 0;
+            break;
+    }
+
+    for (i = 0; i < 8; i++) {
+        flags[i] = (rec[14] & (0x80 >> i)) ? bits[i] : '.';
+    }
+    flags[8] = 0;
+
+    printf("%s%9lu %10lu %2s:%04X  ", prefix, index, get32(rec),
+           memspace_name[rec[6] < NUM_MEMSPACES ? rec[6] : 0], pc);
+    switch (mode_size[opcodes[op].mode]) {
+        case 1:
+            printf("%02X        ", op);
+            break;
+        case 2:
+            printf("%02X %02X     ", op, p1);
+            break;
+        default:
+            printf("%02X %02X %02X  ", op, p1, p2);
+            break;
+    }
+    printf("%-4s %-9s  A:%02X X:%02X Y:%02X SP:%02X %s",
+           opcodes[op].name, operand, rec[10], rec[11], rec[12], rec[13], flags);
+    if (rec[15] & 1) {
+        printf("  $%04X:%02X", get16(rec + 16), rec[18]);
+    }
+    printf("\n");
+}
+
+static int cmd_dis(const char *name, unsigned long first, unsigned long count)
+{
+    trace_t *t = malloc(sizeof *t);
+    const unsigned char *rec;
+
+    trace_open(t, name);
+    while (count > 0 && (rec = trace_next(t)) != NULL) {
+        if (t->index > first) {
+            print_record("", t->index - 1, rec);
+            count--;
+        }
+    }
+    gzclose(t->fd);
+    free(t);
+    return 0;
+}
+
+static int cmd_cov(const char *name)
+{
+    trace_t *t = malloc(sizeof *t);
+    unsigned long *execs = calloc(NUM_MEMSPACES * 0x10000, sizeof *execs);
+    unsigned char *covered = calloc(NUM_MEMSPACES * 0x10000, 1);
+    const unsigned char *rec;
+    unsigned int mem, addr, start, i;
+    unsigned long total;
+
+    trace_open(t, name);
+    while ((rec = trace_next(t)) != NULL) {
+        unsigned int base = (rec[6] < NUM_MEMSPACES ? rec[6] : 0) * 0x10000;
+        unsigned int pc = get16(rec + 4);
+
+        execs[base + pc]++;
+        for (i = 0; i < (unsigned int)mode_size[opcodes[rec[7]].mode]; i++) {
+            covered[base + ((pc + i) & 0xffff)] = 1;
+        }
+    }
+    printf("%lu instructions\n", t->index);
+
+    for (mem = 0; mem < NUM_MEMSPACES; mem++) {
+        unsigned int base = mem * 0x10000;
+
+        addr = 0;
+        while (addr < 0x10000) {
+            if (!covered[base + addr]) {
+                addr++;
+                continue;
+            }
+            start = addr;
+            total = 0;
+            while (addr < 0x10000 && covered[base + addr]) {
+                total += execs[base + addr];
+                addr++;
+            }
+            printf("%2s:%04X-%04X  %lu\n", memspace_name[mem], start, addr - 1, total);
+        }
+    }
+
+    gzclose(t->fd);
+    free(t);
+    free(execs);
+    free(covered);
+    return 0;
+}
+
+static int cmd_diff(const char *name1, const char *name2, unsigned int context)
+{
+    static const char *fields[] = {
+        "clock", "clock", "clock", "clock", "PC", "PC", "memspace",
+        "opcode", "operand", "operand", "A", "X", "Y", "SP", "status",
+        "effective address", "effective address", "effective address",
+        "value", "unused"
+    };
+    trace_t *t1 = malloc(sizeof *t1);
+    trace_t *t2 = malloc(sizeof *t2);
+    unsigned char *history = malloc((context + 1) * RECORD_SIZE);
+    const unsigned char *rec1, *rec2;
+    unsigned long n, index;
+    int i;
+
+    trace_open(t1, name1);
+    trace_open(t2, name2);
+
+    for (;;) {
+        rec1 = trace_next(t1);
+        rec2 = trace_next(t2);
+        if (rec1 == NULL || rec2 == NULL || memcmp(rec1, rec2, RECORD_SIZE) != 0) {
+            break;
+        }
+        if (context > 0) {
+            memcpy(history + ((t1->index - 1) % context) * RECORD_SIZE, rec1, RECORD_SIZE);
+        }
+    }
+
+    if (rec1 == NULL && rec2 == NULL) {
+        printf("traces are identical, %lu instructions\n", t1->index);
+        return 0;
+    }
+
+    index = t1->index - 1;
+    n = index < context ? index : context;
+    for (; n > 0; n--) {
+        print_record("  ", index - n, history + ((index - n) % context) * RECORD_SIZE);
+    }
+    if (rec1 == NULL) {
+        printf("`%s' ends after %lu instructions\n", name1, index);
+    } else {
+        print_record("< ", index, rec1);
+    }
+    if (rec2 == NULL) {
+        printf("`%s' ends after %lu instructions\n", name2, index);
+    } else {
+        print_record("> ", index, rec2);
+    }
+    if (rec1 != NULL && rec2 != NULL) {
+        printf("differs in:");
+        for (i = 0; i < RECORD_SIZE; i++) {
+            if (rec1[i] != rec2[i] && (i == 0 || fields[i] != fields[i - 1] || rec1[i - 1] == rec2[i - 1])) {
+                printf(" %s", fields[i]);
+            }
+        }
+        printf("\n");
+    }
+    return 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: cputrace dis <trace> [<first> [<count>]]\n"
+                    "       cputrace cov <trace>\n"
+                    "       cputrace diff <trace1> <trace2> [<context>]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && argc <= 5 && strcmp(argv[1], "dis") == 0) {
+        return cmd_dis(argv[2], argc > 3 ? strtoul(argv[3], NULL, 0) : 0,
+                       argc > 4 ? strtoul(argv[4], NULL, 0) : (unsigned long)-1);
+    }
+    if (argc == 3 && strcmp(argv[1], "cov") == 0) {
+        return cmd_cov(argv[2]);
+    }
+    if (argc >= 4 && argc <= 5 && strcmp(argv[1], "diff") == 0) {
+        return cmd_diff(argv[2], argv[3], argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 0) : 10);
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,272 @@
+/*
+ * rotationtest.c - compare the batched 1541 GCR rotation against stepping
+ *                  every UE7 carry.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+    Builds src/drive/rotation.c into this program and reads every track
+    of the given G64 images with three drives:  drive 0 steps every UE7
+    carry and is advanced one CPU cycle at a time, drive 1 passes over the
+    carries that do not clock the shifter and drive 2 steps every carry
+    again, both advanced by batches of random length like the VIA
+    accesses of the drive CPU do.  After each batch the VIA outputs (PA,
+    SYNC, BYTE READY level and edge), the head position and the complete
+    rotation state of all drives must be equal.  Each track is read for
+    two revolutions at 1MHz with 300 and 299 RPM, and at 2MHz with 301
+    RPM.  At the end each track is read for ten revolutions in batches
+    of 32 cycles by drive 1 and 2, and the time needed is printed.
+
+    In the doc directory of a configured source tree:
+
+    gcc -O2 -I../src -I../src/arch/unix -I../src/drive -I../src/lib/p64 \
+        -o rotationtest rotationtest.c
+    ./rotationtest image.g64...
+
+    Exits with 0 if the drives never differed.  Images can be made with
+    c1541 -format "name,id" g64 image.g64 -write file...
+*/
+
+static int batch_carries;
+
+#define ROTATION_BATCH_CARRIES batch_carries
+#include "../src/drive/rotation.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_TRACK_SIZE  0x2000
+#define TEST_DRIVES     3
+
+static uint8_t track[TEST_DRIVES][MAX_TRACK_SIZE];
+static drive_t drv[TEST_DRIVES];
+static CLOCK clk[TEST_DRIVES];
+static clock_t elapsed[TEST_DRIVES];
+static unsigned long cycles_compared = 0;
+
+/* Referenced by rotation.c outside the G64 path, or only used with RPM
+   wobble, which stays off.  */
+drive_context_t *drive_context[DRIVE_NUM];
+
+unsigned int lib_unsigned_rand(unsigned int min, unsigned int max)
+{
+    return min;
+}
+
+void P64PulseStreamAddPulse(PP64PulseStream Instance, p64_uint32_t Position, p64_uint32_t Strength)
+{
+}
+
+void P64PulseStreamFreePulse(PP64PulseStream Instance, p64_int32_t Index)
+{
+}
+
+static unsigned int get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned long get32(const uint8_t *p)
+{
+    return get16(p) | ((unsigned long)get16(p + 2) << 16);
+}
+
+static void run(int dnr, CLOCK cycles)
+{
+    batch_carries = (dnr == 1);
+    if (dnr == 0) {
+        while (cycles-- > 0) {
+            clk[0]++;
+            rotation_1541_gcr_cycle(&drv[0]);
+        }
+    } else {
+        clk[dnr] += cycles;
+        rotation_1541_gcr_cycle(&drv[dnr]);
+    }
+}
+
+static int compare(void)
+{
+    int dnr;
+
+    for (dnr = 1; dnr < TEST_DRIVES; dnr++) {
+        if (memcmp(&rotation[0], &rotation[dnr], sizeof(rotation_t)) != 0
+            || drv[0].GCR_read != drv[dnr].GCR_read
+            || rotation_sync_found(&drv[0]) != rotation_sync_found(&drv[dnr])
+            || drv[0].byte_ready_level != drv[dnr].byte_ready_level
+            || drv[0].byte_ready_edge != drv[dnr].byte_ready_edge
+            || drv[0].GCR_head_offset != drv[dnr].GCR_head_offset) {
+            printf("drive %d ", dnr);
+            return -1;
+        }
+    }
+    for (dnr = 0; dnr < TEST_DRIVES; dnr++) {
+        drv[dnr].byte_ready_edge = 0;
+    }
+    return 0;
+}
+
+static void insert_track(int dnr, const uint8_t *data, unsigned int size,
+                         unsigned int zone, int freq, int rpm)
+{
+    memcpy(track[dnr], data, size);
+    memset(&drv[dnr], 0, sizeof(drive_t));
+    drv[dnr].mynumber = dnr;
+    drv[dnr].clk = &clk[dnr];
+    drv[dnr].GCR_track_start_ptr = track[dnr];
+    drv[dnr].GCR_current_track_size = size;
+    drv[dnr].rpm = rpm;
+    drv[dnr].read_write_mode = 1;
+    drv[dnr].byte_ready_active = 0x06;
+    clk[dnr] = 0;
+    rotation_init(freq, dnr);
+    rotation_reset(&drv[dnr]);
+    rotation_speed_zone_set(zone, dnr);
+}
+
+static int test_track(const uint8_t *data, unsigned int size, unsigned int zone,
+                      int freq, int rpm)
+{
+    CLOCK done = 0, length = (freq ? 400000 : 200000) * 2;
+    int dnr;
+
+    for (dnr = 0; dnr < TEST_DRIVES; dnr++) {
+        insert_track(dnr, data, size, zone, freq, rpm);
+    }
+
+    while (done < length) {
+        CLOCK batch = (rand() % 4) ? 1 + rand() % 40 : 1 + rand() % 4000;
+
+        for (dnr = 0; dnr < TEST_DRIVES; dnr++) {
+            run(dnr, batch);
+        }
+        done += batch;
+        if (compare() < 0) {
+            printf("differs after %u cycles\n", (unsigned int)done);
+            return -1;
+        }
+        cycles_compared += batch;
+    }
+    return 0;
+}
+
+static void time_track(const uint8_t *data, unsigned int size, unsigned int zone)
+{
+    int dnr;
+
+    for (dnr = 1; dnr < TEST_DRIVES; dnr++) {
+        clock_t start = clock();
+        CLOCK done;
+
+        insert_track(dnr, data, size, zone, 0, 30000);
+        for (done = 0; done < 200000 * 10; done += 32) {
+            run(dnr, 32);
+        }
+        elapsed[dnr] += clock() - start;
+    }
+}
+
+static int test_image(const char *name)
+{
+    FILE *f = fopen(name, "rb");
+    uint8_t *image;
+    long length;
+    unsigned int tracks, i, count = 0;
+    int failed = 0;
+
+    if (f == NULL) {
+        perror(name);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    image = malloc(length);
+    if (fread(image, 1, length, f) != (size_t)length
+        || length < 12 || memcmp(image, "GCR-1541", 8) != 0) {
+        printf("FAIL: %s: not a G64 image\n", name);
+        fclose(f);
+        free(image);
+        return -1;
+    }
+    fclose(f);
+
+    tracks = image[9];
+    for (i = 0; i < tracks && !failed; i++) {
+        unsigned long offset, speed;
+        unsigned int size;
+
+        if (12 + tracks * 8 > (unsigned long)length) {
+            break;
+        }
+        offset = get32(&image[12 + i * 4]);
+        speed = get32(&image[12 + tracks * 4 + i * 4]);
+        if (offset == 0 || offset + 2 > (unsigned long)length) {
+            continue;
+        }
+        size = get16(&image[offset]);
+        if (size == 0 || size > MAX_TRACK_SIZE || offset + 2 + size > (unsigned long)length) {
+            continue;
+        }
+        if (speed > 3) {
+            /* per sector speed zones are not supported by rotation.c either */
+            speed = 3;
+        }
+        if (test_track(&image[offset + 2], size, speed, 0, 30000) < 0
+            || test_track(&image[offset + 2], size, speed, 0, 29900) < 0
+            || test_track(&image[offset + 2], size, speed, 1, 30100) < 0) {
+            printf("FAIL: %s: half track %u differs\n", name, i + 2);
+            failed = 1;
+        }
+        time_track(&image[offset + 2], size, speed);
+        count++;
+    }
+    free(image);
+
+    if (!failed) {
+        printf("PASS: %s: %u tracks\n", name, count);
+    }
+    return failed ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    int i, failed = 0;
+
+    if (argc < 2) {
+        printf("usage: rotationtest image.g64...\n");
+        return 1;
+    }
+
+    srand(1541);
+    for (i = 1; i < argc; i++) {
+        if (test_image(argv[i]) < 0) {
+            failed = 1;
+        }
+    }
+
+    printf("%lu cycles compared, %.2fs batched, %.2fs stepping every carry\n",
+           cycles_compared,
+           (double)elapsed[1] / CLOCKS_PER_SEC, (double)elapsed[2] / CLOCKS_PER_SEC);
+    return failed;
+}
@@ -437,6 +437,14 @@
                 if (monitor_mask[CALLER]) {                                                    \
                     EXPORT_REGISTERS();                                                        \
                 }                                                                              \
+                if (monitor_mask[CALLER] & (MI_REVERSE)) {                                     \
+                    if (monitor_check_reverse()) {                                             \
+                        IMPORT_REGISTERS();                                                    \
+                    }                                                                          \
+                }                                                                              \
+                if (monitor_mask[CALLER] & (MI_COVERAGE)) {                                    \
+                    monitor_coverage_exec(CALLER, (uint16_t)reg_pc);                           \
+                }                                                                              \
                 if (monitor_mask[CALLER] & (MI_STEP)) {                                        \
                     monitor_check_icount((uint16_t)reg_pc);                                        \
                     IMPORT_REGISTERS();                                                        \
@@ -2039,6 +2047,16 @@ static const uint8_t rewind_fetch_tab[] = {
 #endif
 #endif
 
+        if (monitor_cputrace_enabled) {
+#ifdef DRIVE_CPU
+            CLOCK trace_clk = CLK;
+#else
+            CLOCK trace_clk = maincpu_clk;
+#endif
+            /* the trace peeks the MSB of JSR itself */
+            monitor_cputrace_store(trace_clk, CALLER, reg_pc, p0, p1, p2 >> 8, reg_a_read, reg_x_read, reg_y_read, reg_sp, LOCAL_STATUS());
+        }
+
 #ifdef DEBUG
 #ifdef DRIVE_CPU
         if (TRACEFLG) {
@@ -385,6 +385,14 @@
                 if (monitor_mask[CALLER]) {                                    \
                     EXPORT_REGISTERS();                                        \
                 }                                                              \
+                if (monitor_mask[CALLER] & (MI_REVERSE)) {                     \
+                    if (monitor_check_reverse()) {                             \
+                        IMPORT_REGISTERS();                                    \
+                    }                                                          \
+                }                                                              \
+                if (monitor_mask[CALLER] & (MI_COVERAGE)) {                    \
+                    monitor_coverage_exec(CALLER, (uint16_t)reg_pc);           \
+                }                                                              \
                 if (monitor_mask[CALLER] & (MI_STEP)) {                        \
                     monitor_check_icount((uint16_t)reg_pc);                        \
                     IMPORT_REGISTERS();                                        \
@@ -1584,6 +1592,11 @@ static const uint8_t fetch_tab[] = {
         memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
 #endif
 
+        if (monitor_cputrace_enabled) {
+            /* the trace peeks the MSB of JSR itself */
+            monitor_cputrace_store(maincpu_clk, CALLER, reg_pc, p0, p1, p2 >> 8, reg_a_read, reg_x, reg_y, reg_sp, LOCAL_STATUS());
+        }
+
 #ifdef DEBUG
         if (TRACEFLG) {
             uint8_t op = (uint8_t)(p0);
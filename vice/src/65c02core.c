@@ -375,6 +375,9 @@
                 if (monitor_mask[CALLER]) {                                                                   \
                     EXPORT_REGISTERS();                                                                       \
                 }                                                                                             \
+                if (monitor_mask[CALLER] & (MI_COVERAGE)) {                                                   \
+                    monitor_coverage_exec(CALLER, (uint16_t)reg_pc);                                          \
+                }                                                                                             \
                 if (monitor_mask[CALLER] & (MI_STEP)) {                                                       \
                     monitor_check_icount((uint16_t)reg_pc);                                                       \
                     IMPORT_REGISTERS();                                                                       \
@@ -1654,6 +1657,16 @@
         memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
 #endif
 
+        if (monitor_cputrace_enabled) {
+#ifdef DRIVE_CPU
+            CLOCK trace_clk = CLK;
+#else
+            CLOCK trace_clk = maincpu_clk;
+#endif
+            /* the trace peeks the MSB of JSR itself */
+            monitor_cputrace_store(trace_clk, CALLER, reg_pc, p0, p1, p2 >> 8, reg_a, reg_x, reg_y, reg_sp, LOCAL_STATUS());
+        }
+
 #ifdef DEBUG
 #ifdef DRIVE_CPU
         if (TRACEFLG) {
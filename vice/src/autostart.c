@@ -170,6 +170,8 @@ static int AutostartWarp = 0;
 static int AutostartDelay = 0;
 static int AutostartDelayRandom = 0;
 
+static int AutostartTurbo = 0;
+
 static int AutostartPrgMode = AUTOSTART_PRG_MODE_VFS;
 
 static char *AutostartPrgDiskImage = NULL;
@@ -262,6 +264,13 @@ static int set_autostart_delayrandom(int val, void *param)
     return 0;
 }
 
+/*! \internal \brief set if autostart should skip the fixed kernal reset delay */
+static int set_autostart_turbo(int val, void *param)
+{
+    AutostartTurbo = val ? 1 : 0;
+    return 0;
+}
+
 /*! \internal \brief set autostart prg mode */
 static int set_autostart_prg_mode(int val, void *param)
 {
@@ -307,6 +316,8 @@ static const resource_int_t resources_int[] = {
       &AutostartDelay, set_autostart_delay, NULL },
     { "AutostartDelayRandom", 1, RES_EVENT_NO, (resource_value_t)0,
       &AutostartDelayRandom, set_autostart_delayrandom, NULL },
+    { "AutostartTurbo", 0, RES_EVENT_NO, (resource_value_t)0,
+      &AutostartTurbo, set_autostart_turbo, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -403,6 +414,16 @@ static const cmdline_option_t cmdline_options[] =
       USE_PARAM_STRING, USE_DESCRIPTION_ID,
       IDCLS_UNUSED, IDCLS_DISABLE_AUTOSTART_RANDOM_DELAY,
       NULL, NULL },
+    { "-autostart-turbo", SET_RESOURCE, 0,
+      NULL, NULL, "AutostartTurbo", (resource_value_t)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Start autostarting as soon as the kernal shows READY" },
+    { "+autostart-turbo", SET_RESOURCE, 0,
+      NULL, NULL, "AutostartTurbo", (resource_value_t)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Wait for the full autostart delay before autostarting" },
     CMDLINE_LIST_END
 };
 
@@ -428,7 +449,9 @@ static void deallocate_program_name(void)
     autostart_program_name = NULL;
 }
 
-static enum { YES, NO, NOT_YET } check(const char *s, unsigned int blink_mode)
+typedef enum { YES, NO, NOT_YET } check_result_t;
+
+static check_result_t check(const char *s, unsigned int blink_mode)
 {
     int screen_addr, line_length, cursor_column, addr, i;
 
@@ -469,6 +492,19 @@ static enum { YES, NO, NOT_YET } check(const char *s, unsigned int blink_mode)
     return YES;
 }
 
+/* Wait for the kernal to reach READY after the autostart reset.  In turbo
+   mode polling starts right after the reset, while the screen still holds
+   garbage, so a mismatch only counts once the regular delay has passed.  */
+static check_result_t check_boot_ready(void)
+{
+    check_result_t result = check("READY.", AUTOSTART_WAIT_BLINK);
+
+    if (result == NO && AutostartTurbo && maincpu_clk < min_cycles) {
+        return NOT_YET;
+    }
+    return result;
+}
+
 static void set_true_drive_emulation_mode(int on)
 {
     resources_set_int("DriveTrueEmulation", on);
@@ -638,7 +674,7 @@ static void autostart_finish(void)
             kbdbuf_feed("GRAPHIC5:");
         }
         /* log_message(autostart_log, "Run command is: '%s' (%s)", AutostartRunCommand, AutostartDelayRandom ? "delayed" : "no delay"); */
-        if (AutostartDelayRandom) {
+        if (AutostartDelayRandom && !AutostartTurbo) {
             kbdbuf_feed_runcmd(AutostartRunCommand);
         } else {
             kbdbuf_feed(AutostartRunCommand);
@@ -732,7 +768,7 @@ static void advance_hastape(void)
 {
     char *tmp;
 
-    switch (check("READY.", AUTOSTART_WAIT_BLINK)) {
+    switch (check_boot_ready()) {
         case YES:
             log_message(autostart_log, "Loading file.");
             if (autostart_program_name) {
@@ -795,7 +831,7 @@ static void advance_hasdisk(void)
     char *tmp, *temp_name;
     int traps;
 
-    switch (check("READY.", AUTOSTART_WAIT_BLINK)) {
+    switch (check_boot_ready()) {
         case YES:
 
             /* autostart_program_name may be petscii or ascii at this point,
@@ -871,7 +907,7 @@ static void advance_hasdisk(void)
 
 static void advance_hassnapshot(void)
 {
-    switch (check("READY.", AUTOSTART_WAIT_BLINK)) {
+    switch (check_boot_ready()) {
         case YES:
             autostart_done();
             log_message(autostart_log, "Restoring snapshot.");
@@ -951,6 +987,20 @@ static void advance_waitloadready(void)
 /* After a reset a PRG file has to be injected into RAM */
 static void advance_inject(void)
 {
+    /* without the fixed delay the kernal may still be clearing RAM */
+    if (AutostartTurbo) {
+        switch (check_boot_ready()) {
+            case YES:
+                break;
+            case NO:
+                disable_warp_if_was_requested();
+                autostart_disable();
+                return;
+            case NOT_YET:
+                return;
+        }
+    }
+
     if (autostart_prg_perform_injection(autostart_log) < 0) {
         disable_warp_if_was_requested();
         autostart_disable();
@@ -1063,8 +1113,13 @@ static void reboot_for_autostart(const char *program_name, unsigned int mode,
     }
 
     autostart_initial_delay_cycles = min_cycles;
+    if (AutostartTurbo) {
+        /* poll the screen from the second frame after the reset on, the
+           first one is needed to notice the reset has happened */
+        autostart_initial_delay_cycles = machine_get_cycles_per_frame() * 2;
+    }
     resources_get_int("AutostartDelayRandom", &rnd);
-    if (rnd) {
+    if (rnd && !AutostartTurbo) {
         /* additional random delay of up to 10 frames */
         autostart_initial_delay_cycles += lib_unsigned_rand(1, machine_get_cycles_per_frame() * 10);
     }
@@ -1399,6 +1454,28 @@ int autostart_device(int num)
     return -1;
 }
 
+/* Number of cycles the kernal needs after a reset before autostart types
+   into it, 0 if autostart is not available.  */
+CLOCK autostart_get_boot_cycles(void)
+{
+    return autostart_enabled ? min_cycles : 0;
+}
+
+/* Returns nonzero if autostart has reset the machine but not yet typed or
+   injected anything.  */
+int autostart_waiting_for_boot(void)
+{
+    switch (autostartmode) {
+        case AUTOSTART_HASTAPE:
+        case AUTOSTART_HASDISK:
+        case AUTOSTART_HASSNAPSHOT:
+        case AUTOSTART_INJECT:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
 int autostart_in_progress(void)
 {
     return ((autostartmode != AUTOSTART_NONE) && (autostartmode != AUTOSTART_DONE));
@@ -1426,6 +1503,10 @@ void autostart_reset(void)
         deallocate_program_name();
         log_message(autostart_log, "Turned off.");
     }
+    if (autostart_ignore_reset) {
+        /* this is the reset requested by reboot_for_autostart() */
+        autostart_wait_for_reset = 0;
+    }
     autostart_ignore_reset = 0;
 }
 
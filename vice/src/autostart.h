@@ -71,6 +71,8 @@ extern void autostart_reset(void);
 extern int autostart_ignore_reset;
 
 extern int autostart_in_progress(void);
+extern int autostart_waiting_for_boot(void);
+extern CLOCK autostart_get_boot_cycles(void);
 
 extern void autostart_trigger_monitor(int enable);
 
@@ -0,0 +1,347 @@
+/*
+ * bootsnapshot.c - Cache of the machine state after the kernal reset.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+ * After a power-up reset the machine runs the kernal reset routine (RAM
+ * test, screen setup, ...) for the time autostart waits before typing.
+ * The state at the end of that wait only depends on the machine setup, so
+ * it is saved as a snapshot the first time and read back instead of
+ * booting on every following power-up.
+ *
+ * The snapshots are keyed by a CRC32 over the resources that decide what
+ * the machine is made of (model, memory, drives, expansions), the content
+ * of the ROM images and the content of the attached cartridges, so any
+ * change to those selects another file.  Host and UI settings are not part
+ * of the key.  Attached disk and tape images are not part of the snapshot.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "archdep.h"
+#include "autostart.h"
+#include "bootsnapshot.h"
+#include "cmdline.h"
+#include "crc32.h"
+#include "interrupt.h"
+#include "ioutil.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "network.h"
+#include "resources.h"
+#include "snapshot.h"
+#include "sysfile.h"
+#include "translate.h"
+#include "types.h"
+#include "util.h"
+#include "vice-event.h"
+
+static log_t bootsnapshot_log = LOG_ERR;
+
+static alarm_t *bootsnapshot_alarm = NULL;
+
+/* Snapshot file for the current power-up, NULL if the cache is not used */
+static char *bootsnapshot_name = NULL;
+
+/* snapshot_get_read_count() at the power-up, any snapshot read since then
+   means the machine state no longer comes from the kernal reset */
+static unsigned int bootsnapshot_read_count;
+
+/* snapshot_get_read_count() after the last snapshot read by the cache; any
+   other snapshot may have attached cartridges the key does not know of */
+static unsigned int bootsnapshot_own_read_count = 0;
+
+/* Resources which decide what the machine is made of, matched by prefix.
+   For string resources naming a file (ROM and cartridge images), the CRC32
+   of the file is part of the key instead of the name.  */
+static const char * const bootsnapshot_key_resources[] = {
+    /* ROM images */
+    "Kernal", "Basic", "Chargen", "Editor", "DosName", "Function",
+    "InternalFunction", "ExternalFunction", "Z80Bios", "H6809Rom",
+    "RomModule", "SCPU64Name", "c64dtvrom", "c1lo", "c1hi", "c2lo", "c2hi",
+    /* models and chips */
+    "Model", "MachineType", "MachineVideoStandard", "BoardType", "DtvRevision",
+    "VICIIModel", "VDCRevision", "VDC64KB", "GlueLogic", "CIA1Model",
+    "CIA2Model", "SidModel", "SidEngine", "SidStereo", "SidAddress",
+    "SidCart", "Sound", "Go64Mode", "40/80ColumnKey", "CPUswitch",
+    /* memory */
+    "RAMInit", "RamSize", "RAMBlock", "Ram9", "RamA", "IOSize", "Crtc",
+    "SuperPET", "EoiBlank", "MemoryHack", "PLUS60K", "PLUS256K", "C64_256K",
+    "IO2RAM", "IO3RAM",
+    /* drives and buses */
+    "Drive8", "Drive9", "Drive1", "DriveTrueEmulation", "DriveProfDOS",
+    "DriveStarDos", "DriveSuperCard", "IECDevice", "IECReset", "IEEE488",
+    "VirtualDevices", "Datasette",
+    /* cartridges and expansions */
+    "Cart", "GenericCartridge", "REU", "GEORAM", "RAMCART", "MMC64", "MMCR",
+    "IDE64", "Expert", "Isepic", "DQBB", "Acia1", "SFXSound", "DIGIMAX",
+    "DIGIBLASTER", "DS12C887RTC", "MIDIEnable", "MagicVoice", "CPMCart",
+    "ETHERNETCART", "TurboMaster", "SpeechEnabled", "EasyFlash",
+    "FinalExpansion", "MegaCart", "UltiMem", "VicFlashPlugin", "PETREU",
+    "PETDWW", "PETHRE", "Userport", "ps2mouse",
+    "IOCollisionHandling",
+    NULL
+};
+
+/* Cartridges attached by cartridge_attach_image(), which does not go
+   through the resources on all machines.  */
+typedef struct bootsnapshot_cartridge_s {
+    int type;
+    unsigned long crc;
+} bootsnapshot_cartridge_t;
+
+static bootsnapshot_cartridge_t *bootsnapshot_cartridges = NULL;
+static unsigned int bootsnapshot_cartridge_count = 0;
+
+/* ------------------------------------------------------------------------- */
+
+/* Directory holding the cached snapshots, empty disables the cache */
+static char *BootSnapshotCacheDir = NULL;
+
+static int set_bootsnapshot_cache_dir(const char *val, void *param)
+{
+    util_string_set(&BootSnapshotCacheDir, val);
+
+    return 0;
+}
+
+static const resource_string_t resources_string[] = {
+    { "BootSnapshotCacheDir", "", RES_EVENT_NO, NULL,
+      &BootSnapshotCacheDir, set_bootsnapshot_cache_dir, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+int bootsnapshot_resources_init(void)
+{
+    return resources_register_string(resources_string);
+}
+
+void bootsnapshot_resources_shutdown(void)
+{
+    lib_free(BootSnapshotCacheDir);
+    BootSnapshotCacheDir = NULL;
+    lib_free(bootsnapshot_name);
+    bootsnapshot_name = NULL;
+    lib_free(bootsnapshot_cartridges);
+    bootsnapshot_cartridges = NULL;
+    bootsnapshot_cartridge_count = 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-bootsnapshotcache", SET_RESOURCE, 1,
+      NULL, NULL, "BootSnapshotCacheDir", NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      "<Directory>", "Cache the machine state after the kernal reset in this directory" },
+    CMDLINE_LIST_END
+};
+
+int bootsnapshot_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Called by the cartridge code after `filename' was attached as `type'.  */
+void bootsnapshot_cartridge_attach(int type, const char *filename)
+{
+    bootsnapshot_cartridge_detach(type);
+
+    bootsnapshot_cartridges = lib_realloc(bootsnapshot_cartridges,
+                                          (bootsnapshot_cartridge_count + 1)
+                                          * sizeof(bootsnapshot_cartridge_t));
+    bootsnapshot_cartridges[bootsnapshot_cartridge_count].type = type;
+    bootsnapshot_cartridges[bootsnapshot_cartridge_count].crc = crc32_file(filename);
+    bootsnapshot_cartridge_count++;
+}
+
+/* Called by the cartridge code when `type' is detached, -1 for all.  */
+void bootsnapshot_cartridge_detach(int type)
+{
+    unsigned int i = 0;
+
+    while (i < bootsnapshot_cartridge_count) {
+        if (type < 0 || bootsnapshot_cartridges[i].type == type) {
+            bootsnapshot_cartridges[i] = bootsnapshot_cartridges[--bootsnapshot_cartridge_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+static void bootsnapshot_key_add(const char *name, void *param)
+{
+    char **key = (char **)param;
+    const char *value;
+    char *path = NULL, *line, *old;
+
+    line = NULL;
+    if (resources_query_type(name) == RES_STRING
+        && resources_get_string(name, &value) == 0
+        && value != NULL && value[0] != '\0') {
+        if (sysfile_locate(value, &path) == 0) {
+            line = lib_msprintf("%s=%08lx\n", name, crc32_file(path) & 0xffffffffUL);
+            lib_free(path);
+        } else if (ioutil_access(value, IOUTIL_ACCESS_R_OK) == 0) {
+            line = lib_msprintf("%s=%08lx\n", name, crc32_file(value) & 0xffffffffUL);
+        }
+    }
+    if (line == NULL) {
+        line = resources_write_item_to_string(name, "\n");
+        if (line == NULL) {
+            return;
+        }
+    }
+
+    old = *key;
+    *key = util_concat(old, line, NULL);
+    lib_free(old);
+    lib_free(line);
+}
+
+static unsigned long bootsnapshot_get_key(void)
+{
+    char *key, *line, *old;
+    unsigned long crc;
+    unsigned int i;
+
+    key = lib_stralloc(machine_get_name());
+    resources_foreach_prefix(bootsnapshot_key_resources, bootsnapshot_key_add, &key);
+
+    for (i = 0; i < bootsnapshot_cartridge_count; i++) {
+        line = lib_msprintf("cartridge %d=%08lx\n", bootsnapshot_cartridges[i].type,
+                            bootsnapshot_cartridges[i].crc & 0xffffffffUL);
+        old = key;
+        key = util_concat(old, line, NULL);
+        lib_free(old);
+        lib_free(line);
+    }
+
+    crc = crc32_buf(key, (unsigned int)strlen(key)) & 0xffffffffUL;
+    lib_free(key);
+
+    return crc;
+}
+
+static void bootsnapshot_save_trap(uint16_t unused_addr, void *unused_data)
+{
+    if (bootsnapshot_name == NULL) {
+        return;
+    }
+
+    /* don't cache anything autostart has already typed */
+    if (autostart_in_progress() && !autostart_waiting_for_boot()) {
+        return;
+    }
+
+    if (snapshot_get_read_count() != bootsnapshot_read_count) {
+        return;
+    }
+
+    if (machine_write_snapshot(bootsnapshot_name, 0, 0, 0) < 0) {
+        log_error(bootsnapshot_log, "Cannot write `%s'.", bootsnapshot_name);
+        ioutil_remove(bootsnapshot_name);
+    } else {
+        log_message(bootsnapshot_log, "Saved `%s'.", bootsnapshot_name);
+    }
+}
+
+static void bootsnapshot_load_trap(uint16_t unused_addr, void *unused_data)
+{
+    if (bootsnapshot_name == NULL) {
+        return;
+    }
+
+    if (machine_read_snapshot(bootsnapshot_name, 0) < 0) {
+        bootsnapshot_own_read_count = snapshot_get_read_count();
+        /* drop it, so the next power-up boots normally and saves a new one */
+        log_error(bootsnapshot_log, "Cannot read `%s', removing it.",
+                  bootsnapshot_name);
+        ioutil_remove(bootsnapshot_name);
+        machine_trigger_reset(MACHINE_RESET_MODE_HARD);
+        return;
+    }
+    bootsnapshot_own_read_count = snapshot_get_read_count();
+    log_message(bootsnapshot_log, "Restored `%s'.", bootsnapshot_name);
+}
+
+static void bootsnapshot_alarm_triggered(CLOCK offset, void *data)
+{
+    alarm_unset(bootsnapshot_alarm);
+
+    interrupt_maincpu_trigger_trap(bootsnapshot_save_trap, NULL);
+}
+
+void bootsnapshot_init(void)
+{
+    bootsnapshot_log = log_open("BootSnapshot");
+
+    bootsnapshot_alarm = alarm_new(maincpu_alarm_context, "BootSnapshot",
+                                   bootsnapshot_alarm_triggered, NULL);
+}
+
+/* Called on every reset, `powerup' is nonzero if memory was initialized.  */
+void bootsnapshot_reset(int powerup)
+{
+    CLOCK boot_cycles;
+
+    if (bootsnapshot_alarm == NULL) {
+        return;
+    }
+
+    alarm_unset(bootsnapshot_alarm);
+    lib_free(bootsnapshot_name);
+    bootsnapshot_name = NULL;
+
+    boot_cycles = autostart_get_boot_cycles();
+
+    if (!powerup
+        || boot_cycles == 0
+        || BootSnapshotCacheDir == NULL
+        || BootSnapshotCacheDir[0] == '\0'
+        || event_record_active()
+        || event_playback_active()
+        || network_connected()
+        || snapshot_get_read_count() != bootsnapshot_own_read_count) {
+        return;
+    }
+
+    bootsnapshot_name = lib_msprintf("%s%sboot-%s-%08lx.vsf",
+                                     BootSnapshotCacheDir, FSDEV_DIR_SEP_STR,
+                                     machine_get_name(), bootsnapshot_get_key());
+
+    bootsnapshot_read_count = snapshot_get_read_count();
+
+    if (ioutil_access(bootsnapshot_name, IOUTIL_ACCESS_R_OK) == 0) {
+        interrupt_maincpu_trigger_trap(bootsnapshot_load_trap, NULL);
+    } else {
+        alarm_set(bootsnapshot_alarm, boot_cycles);
+    }
+}
@@ -81,6 +81,8 @@
 #include "cbmimage.h"
 #include "charset.h"
 #include "cmdline.h"
+#include "crc32.h"
+#include "diskconstants.h"
 #include "diskimage.h"
 #include "fileio.h"
 #include "fsimage-check.h"
@@ -221,6 +223,7 @@ static const char *image_format_name(unsigned int type);
 /* command handlers */
 static int attach_cmd(int nargs, char **args);
 static int bam_cmd(int nargs, char **args);
+static int batch_cmd(int nargs, char **args);
 static int bcopy_cmd(int nargs, char **args);
 static int bfill_cmd(int nargs, char **args);
 static int block_cmd(int nargs, char **args);
@@ -228,19 +231,24 @@ static int bpoke_cmd(int nargs, char **args);
 static int bread_cmd(int nargs, char **args);
 static int bwrite_cmd(int nargs, char **args);
 static int chain_cmd(int nargs, char **args);
+static int check_cmd(int nargs, char **args);
 static int copy_cmd(int nargs, char **args);
 static int delete_cmd(int nargs, char **args);
+static int duplicates_cmd(int nargs, char **args);
 static int extract_cmd(int nargs, char **args);
 static int extract_geos_cmd(int nargs, char **args);
 static int format_cmd(int nargs, char **args);
 static int help_cmd(int nargs, char **args);
+static int index_cmd(int nargs, char **args);
 static int info_cmd(int nargs, char **args);
 static int list_cmd(int nargs, char **args);
+static int locate_cmd(int nargs, char **args);
 static int name_cmd(int nargs, char **args);
 static int p00save_cmd(int nargs, char **args);
 static int quit_cmd(int nargs, char **args);
 static int raw_cmd(int nargs, char **args); /* @ */
 static int read_cmd(int nargs, char **args);
+static int salvage_cmd(int nargs, char **args);
 static int read_geos_cmd(int nargs, char **args);
 static int rename_cmd(int nargs, char **args);
 static int silent_cmd(int narg, char **args);
@@ -360,6 +368,13 @@ const command_t command_list[] = {
       "<track-max>",
       0, 3,
       bam_cmd },
+    { "batch",
+      "batch <manifest>|<directory> [<unit>]",
+      "Attach each disk image listed in <manifest> (one file name per line)\n"
+      "or found below <directory> to <unit> in turn, and print a JSON line\n"
+      "with its directory, file CRC32s and block chain errors.",
+      1, 2,
+      batch_cmd },
     { "bcopy",
       "bcopy <src-track> <src-sector> <dst-track> <dst-sector> [<src-unit> "
       "[<dst-unit>]]",
@@ -400,6 +415,15 @@ const command_t command_list[] = {
       "Follow and print block chain starting at (<track>,<sector>)",
       2, 3,
       chain_cmd },
+    { "check",
+      "check <diskimage>|<directory>|<indexfile> [...]",
+      "Attach each disk image in turn to the current unit, read all of its\n"
+      "blocks and print a JSON line with the read errors and the directory\n"
+      "and block chain errors.  Directories are searched for images, and\n"
+      "for an image index made by `index' the images listed in it are\n"
+      "checked.",
+      1, MAXARG,
+      check_cmd },
     { "copy",
       "copy <source1> [<source2> ... <sourceN>] <destination>",
       "Copy `source1' ... `sourceN' into destination.  If N > 1, "
@@ -416,6 +440,11 @@ const command_t command_list[] = {
       "List files matching <pattern> (default is all files).",
       0, 1,
       list_cmd },
+    { "duplicates",
+      "duplicates <indexfile>",
+      "List files with the same size and CRC32 in the image index <indexfile>.",
+      1, 1,
+      duplicates_cmd },
     { "exit",
       "exit",
       "Exit (same as `quit').",
@@ -460,6 +489,13 @@ const command_t command_list[] = {
       "available\n"      "ones.",
       0, 1,
       help_cmd },
+    { "index",
+      "index <indexfile> <manifest>|<directory> [<unit>]",
+      "Create or update the image index <indexfile> with the directories and\n"
+      "file CRC32s of the disk images listed in <manifest> or found below\n"
+      "<directory>.  Images already in the index are not scanned again.",
+      2, 3,
+      index_cmd },
     { "info",
       "info [<unit>]",
       "Display information about unit <unit> (if unspecified, use the "
@@ -471,6 +507,12 @@ const command_t command_list[] = {
       "List files matching <pattern> (default is all files).",
       0, 1,
       list_cmd },
+    { "locate",
+      "locate <indexfile> <pattern>",
+      "List files matching <pattern> in all images of the image index\n"
+      "<indexfile>.",
+      2, 2,
+      locate_cmd },
     { "name",
       "name <diskname>[,<id>] <unit>",
       "Change image name.",
@@ -498,6 +540,14 @@ const command_t command_list[] = {
       "Rename <oldname> into <newname>.  The files must be on the same drive.",
       2, 2,
       rename_cmd },
+    { "salvage",
+      "salvage <diskimage> <d64image>",
+      "Write a new D64 <d64image> with every block of <diskimage> as the\n"
+      "disk image layer reads it.  Unreadable blocks are written as zeros,\n"
+      "and an error info block records the read error of each block.\n"
+      "Nothing is fixed on the disk, and <diskimage> is not changed.",
+      2, 2,
+      salvage_cmd },
     { "silent",
       "silent <off>",
       "Disable all logging",
@@ -1467,6 +1517,1834 @@ static int bam_cmd(int nargs, char **args)
 }
 
 
+/** \brief  Number of sectors reserved per track in the batch block usage map
+ */
+#define BATCH_MAX_SECTORS   256
+
+
+/** \brief  Directory entry found while scanning an image
+ */
+typedef struct batch_file_s {
+    uint8_t name[IMAGE_CONTENTS_FILE_NAME_LEN]; /**< PETSCII name, padded with
+                                                     shifted spaces */
+    unsigned int type;          /**< file type byte of the directory entry */
+    unsigned int blocks;        /**< block count of the directory entry */
+    unsigned int chain_blocks;  /**< number of blocks in the chains */
+    unsigned int size;          /**< number of data bytes in the file */
+    unsigned long crc;          /**< CRC32 of the data bytes */
+} batch_file_t;
+
+
+/** \brief  Per-image state of the image scanner
+ */
+typedef struct batch_scan_s {
+    vdrive_t *vdrive;   /**< vdrive the image is attached to */
+    uint8_t *used;      /**< block usage map, BATCH_MAX_SECTORS per track */
+    int header_ok;      /**< header block could be read */
+    uint8_t name[IMAGE_CONTENTS_NAME_LEN];  /**< PETSCII disk name, padded */
+    uint8_t id[IMAGE_CONTENTS_ID_LEN];      /**< PETSCII disk ID, padded */
+    unsigned int blocks_free;   /**< free blocks according to the BAM */
+    batch_file_t *files;        /**< directory entries */
+    unsigned int file_count;    /**< number of directory entries */
+    unsigned int files_size;    /**< allocated size of \a files */
+    int subdirs;        /**< subdirectories were found but not scanned */
+    char *errors;       /**< comma separated JSON strings of errors found */
+} batch_scan_t;
+
+
+/** \brief  Callback for each image found by batch_walk()
+ */
+typedef void (*batch_image_func_t)(int dnr, const char *path, void *data);
+
+
+/** \brief  Create a quoted and escaped JSON string from \a s
+ *
+ * \param[in]   s   ASCII string
+ *
+ * \return  heap-allocated JSON string, free with lib_free()
+ */
+static char *batch_json_string(const char *s)
+{
+    char *json = lib_malloc(strlen(s) * 6 + 3);
+    char *p = json;
+
+    *p++ = '"';
+    while (*s != '\0') {
+        unsigned char c = (unsigned char)*s++;
+
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = (char)c;
+        } else if (c < 0x20 || c >= 0x7f) {
+            sprintf(p, "\\u%04x", c);
+            p += 6;
+        } else {
+            *p++ = (char)c;
+        }
+    }
+    *p++ = '"';
+    *p = '\0';
+    return json;
+}
+
+
+/** \brief  Print PETSCII string \a petscii as a JSON string
+ *
+ * The string ends at the first shifted space ($a0) or after \a len bytes.
+ *
+ * \param[in]   petscii PETSCII string
+ * \param[in]   len     maximum length of \a petscii
+ */
+static void batch_print_petscii(const uint8_t *petscii, unsigned int len)
+{
+    uint8_t name[IMAGE_CONTENTS_NAME_T64_LEN + 1];
+    char *json;
+    unsigned int i;
+
+    for (i = 0; i < len && i < IMAGE_CONTENTS_NAME_T64_LEN; i++) {
+        if (petscii[i] == 0xa0) {
+            break;
+        }
+        name[i] = petscii[i] != 0 ? petscii[i] : '?';
+    }
+    name[i] = '\0';
+    charset_petconvstring(name, 1);
+
+    json = batch_json_string((char *)name);
+    printf("%s", json);
+    lib_free(json);
+}
+
+
+/** \brief  Record an error found while scanning an image
+ *
+ * \param[in,out]   scan    batch scan state
+ * \param[in]       fmt     format string
+ */
+static void batch_error(batch_scan_t *scan, const char *fmt, ...)
+{
+    va_list ap;
+    char *text;
+    char *json;
+
+    va_start(ap, fmt);
+    text = lib_mvsprintf(fmt, ap);
+    va_end(ap);
+
+    json = batch_json_string(text);
+    lib_free(text);
+
+    if (scan->errors == NULL) {
+        scan->errors = json;
+    } else {
+        text = util_concat(scan->errors, ",", json, NULL);
+        lib_free(scan->errors);
+        lib_free(json);
+        scan->errors = text;
+    }
+}
+
+
+/** \brief  Check a block and read it into \a block
+ *
+ * Checks that (\a track,\a sector) is a legal block that is not in use by
+ * another chain yet and is allocated in the BAM, then marks it as used.
+ *
+ * \param[in,out]   scan    batch scan state
+ * \param[in]       track   track number
+ * \param[in]       sector  sector number
+ * \param[in]       what    description of the chain for error messages
+ * \param[out]      block   block data
+ *
+ * \return  0 on success, -1 if the chain cannot be followed any further
+ */
+static int batch_read_block(batch_scan_t *scan,
+                            unsigned int track, unsigned int sector,
+                            const char *what, uint8_t *block)
+{
+    vdrive_t *vdrive = scan->vdrive;
+    unsigned int index;
+
+    if (disk_image_check_sector(vdrive->image, track, sector) < 0
+            || sector >= BATCH_MAX_SECTORS) {
+        batch_error(scan, "%s: illegal block %u/%u", what, track, sector);
+        return -1;
+    }
+    index = (track - 1) * BATCH_MAX_SECTORS + sector;
+    if (scan->used[index]) {
+        batch_error(scan, "%s: block %u/%u already in use", what,
+                    track, sector);
+        return -1;
+    }
+    scan->used[index] = 1;
+
+    if (vdrive_read_sector(vdrive, block, track, sector) != 0) {
+        batch_error(scan, "%s: cannot read block %u/%u", what, track, sector);
+        return -1;
+    }
+
+    if (vdrive_bam_is_sector_allocated(vdrive, track, sector) == 0) {
+        batch_error(scan, "%s: block %u/%u not allocated in BAM", what,
+                    track, sector);
+    }
+    return 0;
+}
+
+
+/** \brief  Follow a block chain, collecting its data
+ *
+ * \param[in,out]   scan    batch scan state
+ * \param[in]       track   first track of the chain
+ * \param[in]       sector  first sector of the chain
+ * \param[in]       what    description of the chain for error messages
+ * \param[out]      crc     CRC32 of the data bytes in the chain (or `NULL`)
+ * \param[out]      size    number of data bytes in the chain (or `NULL`)
+ *
+ * \return  number of blocks in the chain
+ */
+static unsigned int batch_scan_chain(batch_scan_t *scan,
+                                     unsigned int track, unsigned int sector,
+                                     const char *what,
+                                     unsigned long *crc, unsigned int *size)
+{
+    uint8_t block[RAW_BLOCK_SIZE];
+    uint8_t *data = NULL;
+    unsigned int data_len = 0;
+    unsigned int data_size = 0;
+    unsigned int blocks = 0;
+
+    while (track != 0) {
+        unsigned int len;
+
+        if (batch_read_block(scan, track, sector, what, block) < 0) {
+            break;
+        }
+        blocks++;
+
+        if (crc != NULL) {
+            len = block[0] != 0 ? RAW_BLOCK_SIZE - 2
+                                : (block[1] > 1 ? block[1] - 1U : 0);
+            if (data_len + len + 1 > data_size) {
+                data_size = data_size ? data_size * 2 : 4096;
+                data = lib_realloc(data, data_size);
+            }
+            memcpy(data + data_len, block + 2, len);
+            data_len += len;
+        }
+
+        track = block[0];
+        sector = block[1];
+    }
+
+    if (crc != NULL) {
+        *crc = crc32_buf((const char *)data, data_len) & 0xffffffffUL;
+        lib_free(data);
+    }
+    if (size != NULL) {
+        *size = data_len;
+    }
+    return blocks;
+}
+
+
+/** \brief  Follow the info block and the VLIR records of a GEOS file
+ *
+ * The first chain of a VLIR file is its index block, with the first track
+ * and sector of each record.
+ *
+ * \param[in,out]   scan    batch scan state
+ * \param[in]       slot    directory entry
+ * \param[in]       what    description of the file for error messages
+ *
+ * \return  number of blocks in the info block and record chains
+ */
+static unsigned int batch_scan_geos(batch_scan_t *scan, const uint8_t *slot,
+                                    const char *what)
+{
+    uint8_t block[RAW_BLOCK_SIZE];
+    unsigned int blocks;
+    int i;
+
+    blocks = batch_scan_chain(scan, slot[SLOT_GEOS_ITRACK],
+                              slot[SLOT_GEOS_ISECTOR], what, NULL, NULL);
+
+    if (slot[SLOT_GEOS_STRUCT] != 1 || slot[SLOT_FIRST_TRACK] == 0
+            || vdrive_read_sector(scan->vdrive, block, slot[SLOT_FIRST_TRACK],
+                                  slot[SLOT_FIRST_SECTOR]) != 0) {
+        return blocks;
+    }
+    for (i = 2; i < RAW_BLOCK_SIZE; i += 2) {
+        if (block[i] != 0) {
+            blocks += batch_scan_chain(scan, block[i], block[i + 1], what,
+                                       NULL, NULL);
+        }
+    }
+    return blocks;
+}
+
+
+/** \brief  Mark \a blocks blocks from (\a track,\a sector) on as used
+ *
+ * Partitions on 1581 images are a range of consecutive blocks.
+ *
+ * \param[in,out]   scan    batch scan state
+ * \param[in]       track   first track of the partition
+ * \param[in]       sector  first sector of the partition
+ * \param[in]       blocks  number of blocks in the partition
+ */
+static void batch_mark_partition(batch_scan_t *scan,
+                                 unsigned int track, unsigned int sector,
+                                 unsigned int blocks)
+{
+    vdrive_t *vdrive = scan->vdrive;
+
+    while (blocks-- > 0) {
+        if (disk_image_check_sector(vdrive->image, track, sector) < 0
+                || sector >= BATCH_MAX_SECTORS) {
+            batch_error(scan, "partition: illegal block %u/%u", track, sector);
+            return;
+        }
+        scan->used[(track - 1) * BATCH_MAX_SECTORS + sector] = 1;
+        if (++sector >= (unsigned int)vdrive_get_max_sectors(vdrive, track)) {
+            track++;
+            sector = 0;
+        }
+    }
+}
+
+
+/** \brief  Add a directory entry to the scan and follow its chains
+ *
+ * \param[in,out]   scan    batch scan state
+ * \param[in]       slot    directory entry
+ */
+static void batch_scan_file(batch_scan_t *scan, const uint8_t *slot)
+{
+    batch_file_t *file;
+    uint8_t name[IMAGE_CONTENTS_FILE_NAME_LEN + 1];
+    char *what;
+    unsigned int i;
+
+    if (scan->file_count == scan->files_size) {
+        scan->files_size = scan->files_size ? scan->files_size * 2 : 64;
+        scan->files = lib_realloc(scan->files,
+                                  scan->files_size * sizeof *scan->files);
+    }
+    file = &scan->files[scan->file_count++];
+    memcpy(file->name, slot + SLOT_NAME_OFFSET, IMAGE_CONTENTS_FILE_NAME_LEN);
+    file->type = slot[SLOT_TYPE_OFFSET];
+    file->blocks = slot[SLOT_NR_BLOCKS] | (slot[SLOT_NR_BLOCKS + 1] << 8);
+    file->chain_blocks = 0;
+    file->size = 0;
+    file->crc = 0;
+
+    /* partitions and subdirectories do not have a plain data chain */
+    if ((file->type & 7) == CBMDOS_FT_CBM) {
+        batch_mark_partition(scan, slot[SLOT_FIRST_TRACK],
+                             slot[SLOT_FIRST_SECTOR], file->blocks);
+        return;
+    }
+    if ((file->type & 7) == CBMDOS_FT_DIR) {
+        scan->subdirs = 1;
+        return;
+    }
+
+    for (i = 0; i < IMAGE_CONTENTS_FILE_NAME_LEN && file->name[i] != 0xa0; i++) {
+        name[i] = file->name[i];
+    }
+    name[i] = '\0';
+    charset_petconvstring(name, 1);
+    what = lib_msprintf("file \"%s\"", name);
+
+    file->chain_blocks = batch_scan_chain(scan, slot[SLOT_FIRST_TRACK],
+                                          slot[SLOT_FIRST_SECTOR], what,
+                                          &file->crc, &file->size);
+    if ((file->type & 7) == CBMDOS_FT_REL) {
+        file->chain_blocks += batch_scan_chain(scan, slot[SLOT_SIDE_TRACK],
+                                               slot[SLOT_SIDE_SECTOR], what,
+                                               NULL, NULL);
+    } else if (slot[SLOT_GEOS_TYPE] != 0) {
+        file->chain_blocks += batch_scan_geos(scan, slot, what);
+    }
+
+    if (file->chain_blocks != file->blocks) {
+        batch_error(scan, "%s: %u blocks in directory, %u in chain", what,
+                    file->blocks, file->chain_blocks);
+    }
+    lib_free(what);
+}
+
+
+/** \brief  Follow a directory chain and scan every entry in it
+ *
+ * \param[in,out]   scan    batch scan state
+ * \param[in]       track   first track of the directory
+ * \param[in]       sector  first sector of the directory
+ * \param[in]       what    description of the chain for error messages
+ */
+static void batch_scan_directory(batch_scan_t *scan,
+                                 unsigned int track, unsigned int sector,
+                                 const char *what)
+{
+    uint8_t block[RAW_BLOCK_SIZE];
+
+    while (track != 0) {
+        int i;
+
+        if (batch_read_block(scan, track, sector, what, block) < 0) {
+            break;
+        }
+        for (i = 0; i < RAW_BLOCK_SIZE; i += 32) {
+            if (block[i + SLOT_TYPE_OFFSET] != 0) {
+                batch_scan_file(scan, block + i);
+            }
+        }
+        track = block[0];
+        sector = block[1];
+    }
+}
+
+
+/** \brief  Mark the header and BAM blocks of the image as used
+ *
+ * These are allocated in the BAM without being part of any chain.
+ *
+ * \param[in,out]   scan    batch scan state
+ */
+static void batch_mark_system_blocks(batch_scan_t *scan)
+{
+    vdrive_t *vdrive = scan->vdrive;
+    unsigned int i, first = 0, count = 0;
+    unsigned int track = vdrive->Header_Track;
+
+    scan->used[(vdrive->Header_Track - 1) * BATCH_MAX_SECTORS
+               + vdrive->Header_Sector] = 1;
+
+    switch (vdrive->image_format) {
+        case VDRIVE_IMAGE_FORMAT_1571:
+            /* the whole track holding the BAM of the second side */
+            track = BAM_TRACK_1571 + 35;
+            count = (unsigned int)vdrive_get_max_sectors(vdrive, track);
+            break;
+        case VDRIVE_IMAGE_FORMAT_1581:
+            track = BAM_TRACK_1581;
+            first = BAM_SECTOR_1581 + 1;
+            count = 2;
+            break;
+        case VDRIVE_IMAGE_FORMAT_8050:
+        case VDRIVE_IMAGE_FORMAT_8250:
+            track = BAM_TRACK_8050 - 1;
+            count = vdrive->image_format == VDRIVE_IMAGE_FORMAT_8050 ? 2 : 4;
+            for (i = 0; i < count; i++) {
+                scan->used[(track - 1) * BATCH_MAX_SECTORS
+                           + BAM_SECTOR_8050 + i * 3] = 1;
+            }
+            count = 0;
+            break;
+        case VDRIVE_IMAGE_FORMAT_4000:
+            /* the system area in front of the directory */
+            track = vdrive->Bam_Track;
+            count = 64;
+            break;
+        default:
+            break;
+    }
+
+    if (track > vdrive->image->tracks) {
+        return;
+    }
+    for (i = first; i < first + count && i < BATCH_MAX_SECTORS; i++) {
+        scan->used[(track - 1) * BATCH_MAX_SECTORS + i] = 1;
+    }
+}
+
+
+/** \brief  Report blocks allocated in the BAM that no chain reaches
+ *
+ * Must be called after all chains have been followed.
+ *
+ * \param[in,out]   scan    batch scan state
+ */
+static void batch_scan_unreachable(batch_scan_t *scan)
+{
+    vdrive_t *vdrive = scan->vdrive;
+    unsigned int track, sector;
+
+    batch_mark_system_blocks(scan);
+
+    for (track = 1; track <= vdrive->num_tracks; track++) {
+        char *list = NULL;
+        char *tmp;
+
+        for (sector = 0;
+             sector < BATCH_MAX_SECTORS
+             && disk_image_check_sector(vdrive->image, track, sector) >= 0;
+             sector++) {
+            if (scan->used[(track - 1) * BATCH_MAX_SECTORS + sector]
+                    || vdrive_bam_is_sector_allocated(vdrive, track,
+                                                      sector) != 1) {
+                continue;
+            }
+            tmp = lib_msprintf("%s%s%u", list != NULL ? list : "",
+                               list != NULL ? "," : "", sector);
+            lib_free(list);
+            list = tmp;
+        }
+        if (list != NULL) {
+            batch_error(scan, "track %u: blocks %s allocated in BAM but not "
+                        "in use", track, list);
+            lib_free(list);
+        }
+    }
+}
+
+
+/** \brief  Scan the header, directory and files of the image in \a vdrive
+ *
+ * Free the results with batch_scan_free().
+ *
+ * \param[out]  scan    batch scan state
+ * \param[in]   vdrive  vdrive with an attached image
+ */
+static void batch_scan_image(batch_scan_t *scan, vdrive_t *vdrive)
+{
+    uint8_t block[RAW_BLOCK_SIZE];
+
+    memset(scan, 0, sizeof *scan);
+    scan->vdrive = vdrive;
+    scan->used = lib_calloc(vdrive->image->tracks, BATCH_MAX_SECTORS);
+
+    if (vdrive_read_sector(vdrive, block, vdrive->Header_Track,
+                           vdrive->Header_Sector) == 0) {
+        scan->header_ok = 1;
+        memcpy(scan->name, block + vdrive->bam_name, IMAGE_CONTENTS_NAME_LEN);
+        memcpy(scan->id, block + vdrive->bam_id, IMAGE_CONTENTS_ID_LEN);
+    } else {
+        batch_error(scan, "cannot read header block %u/%u",
+                    vdrive->Header_Track, vdrive->Header_Sector);
+    }
+    scan->blocks_free = vdrive_bam_free_block_count(vdrive);
+
+    batch_scan_directory(scan, vdrive->Dir_Track, vdrive->Dir_Sector,
+                         "directory");
+
+    /* the GEOS border block holds the entries of files moved off the desk */
+    if (scan->header_ok && memcmp(block + 0xad, "GEOS format", 11) == 0
+            && block[0xab] != 0) {
+        batch_scan_directory(scan, block[0xab], block[0xac],
+                             "GEOS border block");
+    }
+
+    /* blocks in subdirectories are not followed, so they would all show up
+       here */
+    if (!scan->subdirs) {
+        batch_scan_unreachable(scan);
+    }
+
+    lib_free(scan->used);
+    scan->used = NULL;
+}
+
+
+/** \brief  Free the results of batch_scan_image()
+ *
+ * \param[in,out]   scan    batch scan state
+ */
+static void batch_scan_free(batch_scan_t *scan)
+{
+    lib_free(scan->files);
+    lib_free(scan->errors);
+    scan->files = NULL;
+    scan->files_size = 0;
+    scan->errors = NULL;
+}
+
+
+/** \brief  Print the results of a scan as a single line JSON object
+ *
+ * \param[in]   scan    batch scan state
+ * \param[in]   path    image file name, as given to the batch command
+ */
+static void batch_print_json(const batch_scan_t *scan, const char *path)
+{
+    vdrive_t *vdrive = scan->vdrive;
+    const char *format_name;
+    unsigned int i;
+    char *json;
+
+    format_name = image_format_name(vdrive->image_format);
+
+    json = batch_json_string(path);
+    printf("{\"image\":%s,\"format\":\"%s\",\"tracks\":%u", json,
+           format_name != NULL ? format_name : "unknown",
+           vdrive->image->tracks);
+    lib_free(json);
+
+    if (scan->header_ok) {
+        printf(",\"name\":");
+        batch_print_petscii(scan->name, IMAGE_CONTENTS_NAME_LEN);
+        printf(",\"id\":");
+        batch_print_petscii(scan->id, IMAGE_CONTENTS_ID_LEN);
+    }
+    printf(",\"blocks_free\":%u,\"files\":[", scan->blocks_free);
+
+    for (i = 0; i < scan->file_count; i++) {
+        const batch_file_t *file = &scan->files[i];
+
+        printf("%s{\"name\":", i > 0 ? "," : "");
+        batch_print_petscii(file->name, IMAGE_CONTENTS_FILE_NAME_LEN);
+        printf(",\"type\":\"%s\",\"closed\":%s,\"locked\":%s,\"blocks\":%u",
+               cbmdos_filetype_get(file->type & 7),
+               (file->type & CBMDOS_FT_CLOSED) ? "true" : "false",
+               (file->type & CBMDOS_FT_LOCKED) ? "true" : "false",
+               file->blocks);
+        if ((file->type & 7) != CBMDOS_FT_CBM
+                && (file->type & 7) != CBMDOS_FT_DIR) {
+            printf(",\"chain_blocks\":%u,\"size\":%u,\"crc32\":\"%08lx\"",
+                   file->chain_blocks, file->size, file->crc);
+        }
+        printf("}");
+    }
+
+    printf("],\"errors\":[%s]}\n", scan->errors != NULL ? scan->errors : "");
+    fflush(stdout);
+}
+
+
+/** \brief  Attach \a path to the vdrive at \a dnr and scan it
+ *
+ * On success the image stays attached to the vdrive, the caller detaches it
+ * with close_disk_image().
+ *
+ * \param[in]   dnr     index in the vdrive array
+ * \param[in]   path    image file name
+ * \param[out]  scan    batch scan state
+ *
+ * \return  0 on success, -1 if the image cannot be attached
+ */
+static int batch_attach_and_scan(int dnr, const char *path, batch_scan_t *scan)
+{
+    close_disk_image(drives[dnr], dnr + UNIT_MIN);
+    if (open_disk_image(drives[dnr], path, (unsigned int)dnr + UNIT_MIN) < 0) {
+        return -1;
+    }
+    batch_scan_image(scan, drives[dnr]);
+    return 0;
+}
+
+
+/** \brief  Print the JSON line for a single image of the `batch` command
+ *
+ * \param[in]   dnr     index in the vdrive array
+ * \param[in]   path    image file name
+ * \param[in]   data    unused
+ */
+static void batch_image(int dnr, const char *path, void *data)
+{
+    batch_scan_t scan;
+
+    if (batch_attach_and_scan(dnr, path, &scan) < 0) {
+        char *json = batch_json_string(path);
+
+        printf("{\"image\":%s,\"errors\":[\"cannot open image\"]}\n", json);
+        fflush(stdout);
+        lib_free(json);
+        return;
+    }
+    batch_print_json(&scan, path);
+    batch_scan_free(&scan);
+    close_disk_image(drives[dnr], dnr + UNIT_MIN);
+}
+
+
+/** \brief  Call \a func for all files in directory \a path and below
+ *
+ * \param[in]   dnr     index in the vdrive array
+ * \param[in]   path    directory name
+ * \param[in]   func    function to call for each file
+ * \param[in]   data    data passed to \a func
+ */
+static void batch_walk_directory(int dnr, const char *path,
+                                 batch_image_func_t func, void *data)
+{
+    ioutil_dir_t *dir;
+    char *name;
+
+    dir = ioutil_opendir(path);
+    if (dir == NULL) {
+        fprintf(stderr, "cannot open directory `%s'\n", path);
+        return;
+    }
+
+    while ((name = ioutil_readdir(dir)) != NULL) {
+        char *full;
+        unsigned int len;
+        unsigned int isdir;
+
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+        full = util_concat(path, FSDEV_DIR_SEP_STR, name, NULL);
+        if (ioutil_stat(full, &len, &isdir) == 0) {
+            if (isdir) {
+                batch_walk_directory(dnr, full, func, data);
+            } else {
+                func(dnr, full, data);
+            }
+        }
+        lib_free(full);
+    }
+    ioutil_closedir(dir);
+}
+
+
+/** \brief  Call \a func for each image in a manifest or directory tree
+ *
+ * If \a name is a directory, \a func is called for every file below it,
+ * otherwise \a name is read as a manifest listing one image per line.
+ * Empty lines and lines starting with '#' are skipped.
+ *
+ * \param[in]   dnr     index in the vdrive array
+ * \param[in]   name    manifest or directory name
+ * \param[in]   func    function to call for each image
+ * \param[in]   data    data passed to \a func
+ *
+ * \return  FD_OK on success, FD_NOTRD if \a name cannot be read
+ */
+static int batch_walk(int dnr, const char *name,
+                      batch_image_func_t func, void *data)
+{
+    char *path = NULL;
+    unsigned int len;
+    unsigned int isdir;
+
+    archdep_expand_path(&path, name);
+    if (ioutil_stat(path, &len, &isdir) != 0) {
+        fprintf(stderr, "cannot open `%s'\n", path);
+        lib_free(path);
+        return FD_NOTRD;
+    }
+
+    if (isdir) {
+        batch_walk_directory(dnr, path, func, data);
+    } else {
+        FILE *manifest;
+        char *line;
+        unsigned int maxlen;
+
+        manifest = fopen(path, MODE_READ_TEXT);
+        if (manifest == NULL) {
+            fprintf(stderr, "cannot open `%s': %s\n", path, strerror(errno));
+            lib_free(path);
+            return FD_NOTRD;
+        }
+        maxlen = ioutil_maxpathlen();
+        line = lib_malloc(maxlen);
+        while (util_get_line(line, (int)maxlen, manifest) >= 0) {
+            if (line[0] != '\0' && line[0] != '#') {
+                func(dnr, line, data);
+            }
+        }
+        lib_free(line);
+        fclose(manifest);
+    }
+
+    lib_free(path);
+    return FD_OK;
+}
+
+
+/** \brief  Scan a list of disk images and print a JSON line for each
+ *
+ * Syntax: `batch <manifest>|<directory> [<unit>]`
+ *
+ * The images are attached to the unit in turn, replacing the image attached
+ * there.  For each image a single line with a JSON object is printed, which
+ * holds the directory with a CRC32 of the contents of each file, and a list
+ * of errors found while following the block chains.  Logging is disabled
+ * while the batch runs.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int batch_cmd(int nargs, char **args)
+{
+    int dnr = drive_index;
+    int result;
+
+    if (nargs == 3) {
+        int unit = parse_unit_number(args[2]);
+
+        if (unit < 0) {
+            return unit;
+        }
+        dnr = unit - UNIT_MIN;
+    }
+
+    /* keep log messages out of the JSON lines */
+    log_enable(0);
+    result = batch_walk(dnr, args[1], batch_image, NULL);
+    log_enable(1);
+    return result;
+}
+
+
+/** \brief  Convert a CBM DOS read error to the code used in error info blocks
+ *
+ * \param[in]   err     CBMDOS_IPE_* code returned by disk_image_read_sector()
+ *
+ * \return  fdc_err_t code
+ */
+static uint8_t check_error_info_code(int err)
+{
+    switch (err) {
+        case CBMDOS_IPE_OK:
+            return CBMDOS_FDC_ERR_OK;
+        case CBMDOS_IPE_READ_ERROR_BNF:
+            return CBMDOS_FDC_ERR_HEADER;
+        case CBMDOS_IPE_READ_ERROR_SYNC:
+            return CBMDOS_FDC_ERR_SYNC;
+        case CBMDOS_IPE_READ_ERROR_DATA:
+            return CBMDOS_FDC_ERR_NOBLOCK;
+        case CBMDOS_IPE_READ_ERROR_CHK:
+            return CBMDOS_FDC_ERR_DCHECK;
+        case CBMDOS_IPE_READ_ERROR_GCR:
+            return CBMDOS_FDC_ERR_DECODE;
+        case CBMDOS_IPE_WRITE_ERROR_VER:
+            return CBMDOS_FDC_ERR_VERIFY;
+        case CBMDOS_IPE_WRITE_PROTECT_ON:
+            return CBMDOS_FDC_ERR_WPROT;
+        case CBMDOS_IPE_READ_ERROR_BCHK:
+            return CBMDOS_FDC_ERR_HCHECK;
+        case CBMDOS_IPE_WRITE_ERROR_BIG:
+            return CBMDOS_FDC_ERR_BLENGTH;
+        case CBMDOS_IPE_DISK_ID_MISMATCH:
+            return CBMDOS_FDC_ERR_ID;
+        default:
+            return CBMDOS_FDC_ERR_DRIVE;
+    }
+}
+
+
+/** \brief  Write a D64 with an error info block
+ *
+ * \param[in]   name        file name
+ * \param[in]   data        contents of the blocks
+ * \param[in]   error_info  error info code of each block
+ * \param[in]   blocks      number of blocks
+ *
+ * \return  FD_OK on success, FD_WRTERR on failure
+ */
+static int check_write_d64(const char *name, const uint8_t *data,
+                           const uint8_t *error_info, unsigned int blocks)
+{
+    FILE *fd;
+
+    fd = fopen(name, MODE_WRITE);
+    if (fd == NULL) {
+        fprintf(stderr, "cannot create `%s': %s\n", name, strerror(errno));
+        return FD_WRTERR;
+    }
+    if (fwrite(data, RAW_BLOCK_SIZE, blocks, fd) != blocks
+            || fwrite(error_info, 1, blocks, fd) != blocks) {
+        fprintf(stderr, "cannot write `%s': %s\n", name, strerror(errno));
+        fclose(fd);
+        return FD_WRTERR;
+    }
+    if (fclose(fd) != 0) {
+        return FD_WRTERR;
+    }
+    return FD_OK;
+}
+
+
+/** \brief  Check an image block by block and for logical errors
+ *
+ * Reads every block of \a path and prints a JSON line with the read errors
+ * (GCR errors on G64/P64, the error info block on D64/X64) and the logical
+ * errors found by batch_scan_image().  If \a salvage is not `NULL`, a D64
+ * with the readable blocks (unreadable ones cleared) and an error info block
+ * is written to \a salvage.
+ *
+ * \param[in]   dnr     index in the vdrive array
+ * \param[in]   path    image file name
+ * \param[in]   salvage name of the D64 to write (or `NULL`)
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int check_image(int dnr, const char *path, const char *salvage)
+{
+    disk_image_t *image;
+    batch_scan_t scan;
+    disk_addr_t dadr;
+    const char *format_name;
+    uint8_t *data;
+    uint8_t *error_info;
+    int *errors;
+    unsigned int blocks = 0, max_blocks, bad_blocks = 0;
+    int result = FD_OK;
+    char *json;
+
+    json = batch_json_string(path);
+    if (batch_attach_and_scan(dnr, path, &scan) < 0) {
+        printf("{\"image\":%s,\"errors\":[\"cannot open image\"]}\n", json);
+        fflush(stdout);
+        lib_free(json);
+        return FD_NOTRD;
+    }
+    image = drives[dnr]->image;
+
+    if (salvage != NULL
+            && image->type != DISK_IMAGE_TYPE_D64
+            && image->type != DISK_IMAGE_TYPE_X64
+            && image->type != DISK_IMAGE_TYPE_G64
+            && image->type != DISK_IMAGE_TYPE_P64) {
+        fprintf(stderr, "only images with 1541 geometry can be written as D64\n");
+        salvage = NULL;
+        result = FD_BADIMAGE;
+    }
+
+    format_name = image_format_name(drives[dnr]->image_format);
+    printf("{\"image\":%s,\"format\":\"%s\",\"tracks\":%u,\"read_errors\":[",
+           json, format_name != NULL ? format_name : "unknown",
+           image->tracks);
+    lib_free(json);
+
+    max_blocks = image->tracks * BATCH_MAX_SECTORS;
+    data = lib_malloc(max_blocks * RAW_BLOCK_SIZE);
+    error_info = lib_malloc(max_blocks);
+    errors = lib_malloc(max_blocks * sizeof *errors);
+
+    for (dadr.track = 1; dadr.track <= image->tracks; dadr.track++) {
+        unsigned int first = blocks;
+        unsigned int track_bad = 0;
+
+        for (dadr.sector = 0;
+             dadr.sector < BATCH_MAX_SECTORS
+             && disk_image_check_sector(image, dadr.track, dadr.sector) >= 0;
+             dadr.sector++) {
+            uint8_t *block = data + blocks * RAW_BLOCK_SIZE;
+
+            errors[blocks] = disk_image_read_sector(image, block, &dadr);
+            if (errors[blocks] != CBMDOS_IPE_OK) {
+                memset(block, 0, RAW_BLOCK_SIZE);
+                track_bad++;
+            }
+            error_info[blocks] = check_error_info_code(errors[blocks]);
+            blocks++;
+        }
+
+        /* G64 and P64 images often carry empty tracks above track 35 */
+        if (dadr.track > NUM_TRACKS_1541 && track_bad == blocks - first
+                && (image->type == DISK_IMAGE_TYPE_G64
+                    || image->type == DISK_IMAGE_TYPE_P64)) {
+            blocks = first;
+            break;
+        }
+
+        for (dadr.sector = 0; first + dadr.sector < blocks; dadr.sector++) {
+            int err = errors[first + dadr.sector];
+
+            if (err != CBMDOS_IPE_OK) {
+                printf("%s{\"track\":%u,\"sector\":%u,\"code\":%d,\"error\":\"%s\"}",
+                       bad_blocks++ > 0 ? "," : "", dadr.track, dadr.sector,
+                       err, err > 0 ? cbmdos_errortext((unsigned int)err)
+                                    : "cannot read block");
+            }
+        }
+    }
+
+    printf("],\"blocks\":%u,\"bad_blocks\":%u,\"errors\":[%s]}\n",
+           blocks, bad_blocks, scan.errors != NULL ? scan.errors : "");
+    fflush(stdout);
+
+    if (salvage != NULL) {
+        result = check_write_d64(salvage, data, error_info, blocks);
+    }
+
+    lib_free(errors);
+    lib_free(error_info);
+    lib_free(data);
+    batch_scan_free(&scan);
+    close_disk_image(drives[dnr], dnr + UNIT_MIN);
+    return result;
+}
+
+
+/** \brief  Check an image found by batch_walk() or listed in an index
+ *
+ * \param[in]       dnr     index in the vdrive array
+ * \param[in]       path    image file name
+ * \param[in,out]   data    number of images that could not be checked
+ */
+static void check_image_func(int dnr, const char *path, void *data)
+{
+    unsigned int *failed = data;
+
+    if (check_image(dnr, path, NULL) != FD_OK) {
+        (*failed)++;
+    }
+}
+
+
+/** \brief  First line of an image index file
+ */
+#define INDEX_HEADER    "# VICE disk image index 2"
+
+/** \brief  First line of an image index file without modification times
+ */
+#define INDEX_HEADER_1  "# VICE disk image index 1"
+
+
+/** \brief  Image record of an image index
+ *
+ * The records of an image are text lines, an `H` line with the format, track
+ * count, free blocks, disk name and ID, and an `F` line per directory entry
+ * with its type, block count, size, CRC32 and name.  Names are stored as hex
+ * dumps of the PETSCII names padded with shifted spaces.
+ */
+typedef struct index_image_s {
+    char *path;             /**< image file name */
+    unsigned int size;      /**< size of the image file */
+    unsigned long crc;      /**< CRC32 of the image file */
+    unsigned long mtime;    /**< modification time, 0 if unknown */
+    char *records;          /**< header and file lines of the image */
+    struct index_image_s *next; /**< next image in the index */
+    struct index_image_s *content_next; /**< next in the content table */
+    struct index_image_s *path_next;    /**< next in the path table */
+} index_image_t;
+
+
+/** \brief  Hash table of index images, by content or by path
+ */
+typedef struct index_table_s {
+    index_image_t **buckets;    /**< chains of images, size is a power of 2 */
+    unsigned int size;          /**< number of buckets */
+    unsigned int count;         /**< number of images */
+    int by_path;                /**< key is the path, not size and CRC32 */
+} index_table_t;
+
+
+/** \brief  State of the `index` command
+ */
+typedef struct index_update_s {
+    index_image_t *old_list;    /**< images of the existing index */
+    index_image_t *new_list;    /**< images of the updated index */
+    index_image_t *new_last;    /**< last image of the updated index */
+    index_table_t by_content;   /**< old and new images by size and CRC32 */
+    index_table_t by_path;      /**< old images by path */
+    unsigned int scanned;       /**< number of images scanned */
+    unsigned int reused;        /**< number of images taken from the index */
+    unsigned int unchanged;     /**< images not read, same size and time */
+} index_update_t;
+
+
+/** \brief  File entry of an image index, used by `locate` and `duplicates`
+ */
+typedef struct index_file_s {
+    const index_image_t *image; /**< image containing the file */
+    uint8_t name[IMAGE_CONTENTS_FILE_NAME_LEN]; /**< PETSCII name, padded */
+    char type[4];               /**< file type */
+    unsigned int size;          /**< number of data bytes */
+    unsigned long crc;          /**< CRC32 of the data bytes */
+} index_file_t;
+
+
+/** \brief  Write \a len bytes of \a data as hex digits into \a out
+ *
+ * \param[out]  out     buffer of at least 2 * \a len + 1 bytes
+ * \param[in]   data    data to encode
+ * \param[in]   len     length of \a data
+ */
+static void index_hex_encode(char *out, const uint8_t *data, unsigned int len)
+{
+    unsigned int i;
+
+    for (i = 0; i < len; i++) {
+        sprintf(out + i * 2, "%02x", data[i]);
+    }
+    out[len * 2] = '\0';
+}
+
+
+/** \brief  Read \a len bytes of hex digits from \a in into \a data
+ *
+ * \param[in]   in      hex digits
+ * \param[out]  data    decoded bytes
+ * \param[in]   len     number of bytes to decode
+ *
+ * \return  0 on success, -1 on malformed input
+ */
+static int index_hex_decode(const char *in, uint8_t *data, unsigned int len)
+{
+    unsigned int i;
+
+    for (i = 0; i < len; i++) {
+        unsigned int byte;
+
+        if (!isxdigit((int)in[i * 2]) || !isxdigit((int)in[i * 2 + 1])
+                || sscanf(in + i * 2, "%2x", &byte) != 1) {
+            return -1;
+        }
+        data[i] = (uint8_t)byte;
+    }
+    return 0;
+}
+
+
+/** \brief  Append \a str to the heap buffer \a buf of \a *len bytes
+ *
+ * The buffer grows geometrically, \a *size is its allocated size.
+ *
+ * \param[in,out]  buf     buffer, `NULL` to start a new one
+ * \param[in,out]  len     length of the string in \a buf
+ * \param[in,out]  size    allocated size of \a buf
+ * \param[in]      str     string to append
+ */
+static void index_append(char **buf, size_t *len, size_t *size, const char *str)
+{
+    size_t add = strlen(str);
+
+    if (*buf == NULL || *len + add + 1 > *size) {
+        if (*size == 0) {
+            *size = 256;
+        }
+        while (*len + add + 1 > *size) {
+            *size *= 2;
+        }
+        *buf = lib_realloc(*buf, *size);
+    }
+    memcpy(*buf + *len, str, add + 1);
+    *len += add;
+}
+
+
+/** \brief  Hash of the key of \a image in \a table
+ */
+static unsigned int index_table_hash(const index_table_t *table,
+                                     const index_image_t *image)
+{
+    unsigned int hash;
+    const char *p;
+
+    if (!table->by_path) {
+        return (unsigned int)(image->crc ^ (image->size * 2654435761u));
+    }
+    hash = 5381;
+    for (p = image->path; *p != '\0'; p++) {
+        hash = hash * 33 + (unsigned char)*p;
+    }
+    return hash;
+}
+
+
+/** \brief  Chain link of \a image used by \a table
+ */
+static index_image_t **index_table_link(const index_table_t *table,
+                                        index_image_t *image)
+{
+    return table->by_path ? &image->path_next : &image->content_next;
+}
+
+
+/** \brief  Add \a image to \a table, growing it when it gets full
+ *
+ * \param[in,out]  table   hash table
+ * \param[in]      image   image to add
+ */
+static void index_table_add(index_table_t *table, index_image_t *image)
+{
+    unsigned int bucket;
+
+    if (table->count >= table->size) {
+        index_image_t **old = table->buckets;
+        unsigned int old_size = table->size;
+        unsigned int i;
+
+        table->size = old_size ? old_size * 2 : 256;
+        table->buckets = lib_calloc(table->size, sizeof *table->buckets);
+        for (i = 0; i < old_size; i++) {
+            while (old[i] != NULL) {
+                index_image_t *next = *index_table_link(table, old[i]);
+
+                bucket = index_table_hash(table, old[i]) & (table->size - 1);
+                *index_table_link(table, old[i]) = table->buckets[bucket];
+                table->buckets[bucket] = old[i];
+                old[i] = next;
+            }
+        }
+        lib_free(old);
+    }
+
+    bucket = index_table_hash(table, image) & (table->size - 1);
+    *index_table_link(table, image) = table->buckets[bucket];
+    table->buckets[bucket] = image;
+    table->count++;
+}
+
+
+/** \brief  Free the buckets of \a table, not the images
+ */
+static void index_table_free(index_table_t *table)
+{
+    lib_free(table->buckets);
+    table->buckets = NULL;
+    table->size = 0;
+    table->count = 0;
+}
+
+
+/** \brief  Free a list of index images
+ *
+ * \param[in]   list    first image of the list
+ */
+static void index_free(index_image_t *list)
+{
+    while (list != NULL) {
+        index_image_t *next = list->next;
+
+        lib_free(list->path);
+        lib_free(list->records);
+        lib_free(list);
+        list = next;
+    }
+}
+
+
+/** \brief  Load the image index \a name
+ *
+ * A missing index file gives an empty list.
+ *
+ * \param[in]   name    index file name
+ * \param[out]  list    images of the index
+ *
+ * \return  FD_OK on success, FD_BADIMAGE if \a name is not an image index
+ */
+static int index_load(const char *name, index_image_t **list)
+{
+    FILE *fd;
+    char *line;
+    unsigned int maxlen;
+    index_image_t *last = NULL;
+    size_t records_len = 0;
+    size_t records_size = 0;
+    int version = 2;
+    int result = FD_OK;
+
+    *list = NULL;
+
+    fd = fopen(name, MODE_READ_TEXT);
+    if (fd == NULL) {
+        return FD_OK;
+    }
+
+    maxlen = ioutil_maxpathlen() + 64;
+    line = lib_malloc(maxlen);
+
+    if (util_get_line(line, (int)maxlen, fd) < 0) {
+        version = 0;
+    } else if (strcmp(line, INDEX_HEADER_1) == 0) {
+        version = 1;
+    } else if (strcmp(line, INDEX_HEADER) != 0) {
+        version = 0;
+    }
+
+    if (version == 0) {
+        fprintf(stderr, "`%s' is not an image index\n", name);
+        result = FD_BADIMAGE;
+    } else {
+        while (util_get_line(line, (int)maxlen, fd) >= 0) {
+            unsigned int size;
+            unsigned long crc;
+            unsigned long mtime = 0;
+            int pos = 0;
+
+            if (line[0] == 'I') {
+                index_image_t *image;
+
+                if (version == 1) {
+                    if (sscanf(line, "I %u %lx %n", &size, &crc, &pos) < 2
+                            || pos == 0) {
+                        continue;
+                    }
+                } else if (sscanf(line, "I %u %lx %lu %n", &size, &crc,
+                                  &mtime, &pos) < 3 || pos == 0) {
+                    continue;
+                }
+                image = lib_calloc(1, sizeof *image);
+                image->path = lib_stralloc(line + pos);
+                image->size = size;
+                image->crc = crc;
+                image->mtime = mtime;
+                image->records = lib_stralloc("");
+                if (last == NULL) {
+                    *list = image;
+                } else {
+                    last->next = image;
+                }
+                last = image;
+                records_len = 0;
+                records_size = 0;
+            } else if ((line[0] == 'H' || line[0] == 'F') && last != NULL) {
+                if (records_size == 0) {
+                    lib_free(last->records);
+                    last->records = NULL;
+                }
+                index_append(&last->records, &records_len, &records_size, line);
+                index_append(&last->records, &records_len, &records_size, "\n");
+            }
+        }
+    }
+
+    lib_free(line);
+    fclose(fd);
+    if (result != FD_OK) {
+        index_free(*list);
+        *list = NULL;
+    }
+    return result;
+}
+
+
+/** \brief  Tell whether \a name is an image index file
+ *
+ * \param[in]   name    file name
+ *
+ * \return  nonzero if the first line of \a name is an index header
+ */
+static int index_is_index(const char *name)
+{
+    FILE *fd;
+    char line[64];
+    int result = 0;
+
+    fd = fopen(name, MODE_READ_TEXT);
+    if (fd != NULL) {
+        if (util_get_line(line, (int)sizeof line, fd) >= 0) {
+            result = strcmp(line, INDEX_HEADER) == 0
+                     || strcmp(line, INDEX_HEADER_1) == 0;
+        }
+        fclose(fd);
+    }
+    return result;
+}
+
+
+/** \brief  Write the image index \a list to \a name
+ *
+ * \param[in]   name    index file name
+ * \param[in]   list    images of the index
+ *
+ * \return  FD_OK on success, FD_WRTERR on failure
+ */
+static int index_save(const char *name, const index_image_t *list)
+{
+    FILE *fd;
+
+    fd = fopen(name, MODE_WRITE_TEXT);
+    if (fd == NULL) {
+        fprintf(stderr, "cannot create `%s': %s\n", name, strerror(errno));
+        return FD_WRTERR;
+    }
+
+    fprintf(fd, "%s\n", INDEX_HEADER);
+    for (; list != NULL; list = list->next) {
+        fprintf(fd, "I %u %08lx %lu %s\n%s", list->size, list->crc,
+                list->mtime, list->path, list->records);
+    }
+
+    if (fclose(fd) != 0) {
+        fprintf(stderr, "cannot write `%s': %s\n", name, strerror(errno));
+        return FD_WRTERR;
+    }
+    return FD_OK;
+}
+
+
+/** \brief  Create the index records from the results of a scan
+ *
+ * \param[in]   scan    batch scan state
+ *
+ * \return  heap-allocated index lines, free with lib_free()
+ */
+static char *index_records(const batch_scan_t *scan)
+{
+    const char *format_name = image_format_name(scan->vdrive->image_format);
+    char name[IMAGE_CONTENTS_FILE_NAME_LEN * 2 + 1];
+    char id[IMAGE_CONTENTS_ID_LEN * 2 + 1];
+    char *records = NULL;
+    char *line;
+    size_t len = 0;
+    size_t size = 0;
+    unsigned int i;
+
+    index_hex_encode(name, scan->name, IMAGE_CONTENTS_NAME_LEN);
+    index_hex_encode(id, scan->id, IMAGE_CONTENTS_ID_LEN);
+    line = lib_msprintf("H %s %u %u %s %s\n",
+                        format_name != NULL ? format_name : "unknown",
+                        scan->vdrive->image->tracks, scan->blocks_free,
+                        name, id);
+    index_append(&records, &len, &size, line);
+    lib_free(line);
+
+    for (i = 0; i < scan->file_count; i++) {
+        const batch_file_t *file = &scan->files[i];
+
+        index_hex_encode(name, file->name, IMAGE_CONTENTS_FILE_NAME_LEN);
+        line = lib_msprintf("F %02x %u %u %08lx %s\n", file->type,
+                            file->blocks, file->size, file->crc, name);
+        index_append(&records, &len, &size, line);
+        lib_free(line);
+    }
+    return records;
+}
+
+
+/** \brief  Find an image with the key of \a key in \a table
+ *
+ * \param[in]   table   hash table to search
+ * \param[in]   key     image with the size and CRC32, or the path, to find
+ *
+ * \return  image or `NULL` if not found
+ */
+static index_image_t *index_table_find(index_table_t *table,
+                                       const index_image_t *key)
+{
+    index_image_t *image;
+
+    if (table->size == 0) {
+        return NULL;
+    }
+    image = table->buckets[index_table_hash(table, key) & (table->size - 1)];
+    for (; image != NULL; image = *index_table_link(table, image)) {
+        if (table->by_path ? strcmp(image->path, key->path) == 0
+                : (image->size == key->size && image->crc == key->crc)) {
+            return image;
+        }
+    }
+    return NULL;
+}
+
+
+/** \brief  Add a single image to the index being updated
+ *
+ * An image whose path, size and modification time are unchanged since the
+ * old index is taken from it without reading the file.  Other images with
+ * the same size and CRC32 as an image already indexed reuse that image's
+ * records instead of being attached and scanned again.
+ *
+ * \param[in]       dnr     index in the vdrive array
+ * \param[in]       path    image file name
+ * \param[in,out]   data    index update state
+ */
+static void index_update_image(int dnr, const char *path, void *data)
+{
+    index_update_t *update = data;
+    const index_image_t *known;
+    index_image_t *image;
+    unsigned int size;
+    unsigned int isdir;
+
+    if (ioutil_stat(path, &size, &isdir) != 0 || isdir) {
+        return;
+    }
+
+    image = lib_calloc(1, sizeof *image);
+    image->path = lib_stralloc(path);
+    image->size = size;
+    if (ioutil_mtime(path, &image->mtime) < 0) {
+        image->mtime = 0;
+    }
+
+    known = index_table_find(&update->by_path, image);
+    if (known != NULL && known->size == size && known->mtime != 0
+            && known->mtime == image->mtime) {
+        image->crc = known->crc;
+        update->unchanged++;
+    } else {
+        image->crc = crc32_file(path) & 0xffffffffUL;
+        known = index_table_find(&update->by_content, image);
+    }
+
+    if (known != NULL) {
+        image->records = lib_stralloc(known->records);
+        update->reused++;
+    } else {
+        batch_scan_t scan;
+
+        if (batch_attach_and_scan(dnr, path, &scan) < 0) {
+            lib_free(image->path);
+            lib_free(image);
+            return;
+        }
+        image->records = index_records(&scan);
+        batch_scan_free(&scan);
+        close_disk_image(drives[dnr], dnr + UNIT_MIN);
+        update->scanned++;
+    }
+    index_table_add(&update->by_content, image);
+
+    if (update->new_last == NULL) {
+        update->new_list = image;
+    } else {
+        update->new_last->next = image;
+    }
+    update->new_last = image;
+}
+
+
+/** \brief  Create or update an image index
+ *
+ * Syntax: `index <indexfile> <manifest>|<directory> [<unit>]`
+ *
+ * The new index lists the images of the manifest or directory tree.  Only
+ * images whose size and CRC32 are not in the old index are scanned, and
+ * images whose size and modification time did not change are not read.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int index_cmd(int nargs, char **args)
+{
+    index_update_t update;
+    int dnr = drive_index;
+    char *path = NULL;
+    int result;
+
+    if (nargs == 4) {
+        int unit = parse_unit_number(args[3]);
+
+        if (unit < 0) {
+            return unit;
+        }
+        dnr = unit - UNIT_MIN;
+    }
+
+    memset(&update, 0, sizeof update);
+    archdep_expand_path(&path, args[1]);
+
+    update.by_path.by_path = 1;
+    result = index_load(path, &update.old_list);
+    if (result == FD_OK) {
+        index_image_t *image;
+
+        for (image = update.old_list; image != NULL; image = image->next) {
+            index_table_add(&update.by_content, image);
+            index_table_add(&update.by_path, image);
+        }
+        log_enable(0);
+        result = batch_walk(dnr, args[2], index_update_image, &update);
+        log_enable(1);
+    }
+    if (result == FD_OK) {
+        result = index_save(path, update.new_list);
+    }
+    if (result == FD_OK) {
+        printf("%u images scanned, %u taken from the index"
+               " (%u of them unchanged and not read)\n",
+               update.scanned, update.reused, update.unchanged);
+    }
+
+    index_table_free(&update.by_content);
+    index_table_free(&update.by_path);
+    index_free(update.old_list);
+    index_free(update.new_list);
+    lib_free(path);
+    return result;
+}
+
+
+/** \brief  Check disk images for read and logical errors
+ *
+ * Syntax: `check <diskimage>|<directory>|<indexfile> [...]`
+ *
+ * Each image is attached to the current unit in turn, replacing the image
+ * attached there.  The result is a single JSON line per image: `read_errors`
+ * lists the blocks that cannot be read with their CBM DOS error, `errors` the
+ * problems found in the header, directory and block chains.  Directories are
+ * searched for images like with `batch`, and image index files made by the
+ * `index` command stand for the images listed in them.  Logging is disabled
+ * while checking.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK if all images were checked, < 0 on failure
+ */
+static int check_cmd(int nargs, char **args)
+{
+    unsigned int failed = 0;
+    int result = FD_OK;
+    int i;
+
+    log_enable(0);
+    for (i = 1; i < nargs; i++) {
+        unsigned int len;
+        unsigned int isdir;
+
+        if (ioutil_stat(args[i], &len, &isdir) != 0) {
+            fprintf(stderr, "cannot open `%s'\n", args[i]);
+            result = FD_NOTRD;
+        } else if (isdir) {
+            if (batch_walk(drive_index, args[i], check_image_func,
+                           &failed) != FD_OK) {
+                result = FD_NOTRD;
+            }
+        } else if (index_is_index(args[i])) {
+            index_image_t *list;
+            const index_image_t *image;
+
+            if (index_load(args[i], &list) != FD_OK) {
+                result = FD_BADIMAGE;
+            }
+            for (image = list; image != NULL; image = image->next) {
+                check_image_func(drive_index, image->path, &failed);
+            }
+            index_free(list);
+        } else {
+            check_image_func(drive_index, args[i], &failed);
+        }
+    }
+    log_enable(1);
+
+    if (result == FD_OK && failed > 0) {
+        result = FD_NOTRD;
+    }
+    return result;
+}
+
+
+/** \brief  Write the readable blocks of a disk image to a new D64
+ *
+ * Syntax: `salvage <diskimage> <d64image>`
+ *
+ * The image is attached to the current unit, replacing the image attached
+ * there, and checked like with `check`.  Every block of the image is read
+ * through the disk image layer and written to the D64 in track and sector
+ * order.  Blocks that cannot be read
+ * are written as zeros, and the error info block appended to the D64 holds
+ * the read error of each block, so the read errors of a G64 remain visible
+ * to software emulated from the D64.  Tracks above 35 of G64/P64 images
+ * without any readable block are left out.  The BAM, directory and block
+ * chains are copied as they are, nothing is fixed, and the source image is
+ * not written to.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int salvage_cmd(int nargs, char **args)
+{
+    int result;
+
+    log_enable(0);
+    result = check_image(drive_index, args[1], args[2]);
+    log_enable(1);
+    return result;
+}
+
+
+/** \brief  Collect the file entries of the images in \a list
+ *
+ * \param[in]   list    images of an index
+ * \param[out]  count   number of file entries
+ *
+ * \return  heap-allocated file entries, free with lib_free()
+ */
+static index_file_t *index_files(const index_image_t *list, unsigned int *count)
+{
+    index_file_t *files = NULL;
+    unsigned int files_size = 0;
+
+    *count = 0;
+    for (; list != NULL; list = list->next) {
+        const char *line = list->records;
+
+        while (*line != '\0') {
+            const char *next = strchr(line, '\n');
+            unsigned int type;
+            unsigned int blocks;
+            unsigned int size;
+            unsigned long crc;
+            int pos = 0;
+
+            if (next == NULL) {
+                next = line + strlen(line);
+            } else {
+                next++;
+            }
+            if (line[0] == 'F'
+                    && sscanf(line, "F %x %u %u %lx %n", &type, &blocks,
+                              &size, &crc, &pos) == 4 && pos > 0) {
+                index_file_t *file;
+
+                if (*count == files_size) {
+                    files_size = files_size ? files_size * 2 : 256;
+                    files = lib_realloc(files, files_size * sizeof *files);
+                }
+                file = &files[*count];
+                if (index_hex_decode(line + pos, file->name,
+                                     IMAGE_CONTENTS_FILE_NAME_LEN) == 0) {
+                    file->image = list;
+                    strcpy(file->type, cbmdos_filetype_get(type & 7));
+                    file->size = size;
+                    file->crc = crc;
+                    (*count)++;
+                }
+            }
+            line = next;
+        }
+    }
+    return files;
+}
+
+
+/** \brief  Print a file entry of an image index
+ *
+ * \param[in]   file    file entry
+ */
+static void index_print_file(const index_file_t *file)
+{
+    uint8_t name[IMAGE_CONTENTS_FILE_NAME_LEN + 1];
+    unsigned int i;
+
+    for (i = 0; i < IMAGE_CONTENTS_FILE_NAME_LEN && file->name[i] != 0xa0; i++) {
+        name[i] = file->name[i];
+    }
+    name[i] = '\0';
+    charset_petconvstring(name, 1);
+
+    printf("%-18s %s %6u %08lx  %s\n", name, file->type, file->size,
+           file->crc, file->image->path);
+}
+
+
+/** \brief  Find files matching a pattern in an image index
+ *
+ * Syntax: `locate <indexfile> <pattern>`
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int locate_cmd(int nargs, char **args)
+{
+    index_image_t *list;
+    index_file_t *files;
+    uint8_t pattern[IMAGE_CONTENTS_FILE_NAME_LEN];
+    char *path = NULL;
+    unsigned int count;
+    unsigned int len;
+    unsigned int i;
+    int result;
+
+    archdep_expand_path(&path, args[1]);
+    result = index_load(path, &list);
+    lib_free(path);
+    if (result != FD_OK) {
+        return result;
+    }
+
+    memset(pattern, 0xa0, sizeof pattern);
+    len = (unsigned int)strlen(args[2]);
+    if (len > IMAGE_CONTENTS_FILE_NAME_LEN) {
+        len = IMAGE_CONTENTS_FILE_NAME_LEN;
+    }
+    memcpy(pattern, args[2], len);
+    for (i = 0; i < len; i++) {
+        pattern[i] = charset_p_topetcii(pattern[i]);
+    }
+
+    files = index_files(list, &count);
+    for (i = 0; i < count; i++) {
+        if (cbmdos_parse_wildcard_compare(pattern, files[i].name)) {
+            index_print_file(&files[i]);
+        }
+    }
+
+    lib_free(files);
+    index_free(list);
+    return FD_OK;
+}
+
+
+/** \brief  Sort file entries by CRC32 and size
+ */
+static int index_compare_files(const void *p1, const void *p2)
+{
+    const index_file_t *f1 = p1;
+    const index_file_t *f2 = p2;
+
+    if (f1->crc != f2->crc) {
+        return f1->crc < f2->crc ? -1 : 1;
+    }
+    if (f1->size != f2->size) {
+        return f1->size < f2->size ? -1 : 1;
+    }
+    return 0;
+}
+
+
+/** \brief  List files with identical contents in an image index
+ *
+ * Syntax: `duplicates <indexfile>`
+ *
+ * Files with the same size and CRC32 are printed as a group.  Empty files
+ * are ignored.
+ *
+ * \param[in]   nargs   argument count
+ * \param[in]   args    argument list
+ *
+ * \return  FD_OK on success, < 0 on failure
+ */
+static int duplicates_cmd(int nargs, char **args)
+{
+    index_image_t *list;
+    index_file_t *files;
+    char *path = NULL;
+    unsigned int count;
+    unsigned int i;
+    unsigned int j;
+    int result;
+
+    archdep_expand_path(&path, args[1]);
+    result = index_load(path, &list);
+    lib_free(path);
+    if (result != FD_OK) {
+        return result;
+    }
+
+    files = index_files(list, &count);
+    if (count > 0) {
+        qsort(files, count, sizeof *files, index_compare_files);
+    }
+
+    for (i = 0; i < count; i = j) {
+        for (j = i + 1; j < count
+                && index_compare_files(&files[i], &files[j]) == 0; j++) {
+        }
+        if (j - i > 1 && files[i].size > 0) {
+            unsigned int k;
+
+            for (k = i; k < j; k++) {
+                index_print_file(&files[k]);
+            }
+            putchar('\n');
+        }
+    }
+
+    lib_free(files);
+    index_free(list);
+    return FD_OK;
+}
+
+
 /** \brief  Copy block to another block
  *
  * Copies a single block (sector) to another block, optionally between different
@@ -109,6 +109,7 @@
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
 #include "sid.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "tape.h"
 #include "tape_diag_586220_harness.h"
@@ -1321,7 +1322,11 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks, int
 
 int machine_read_snapshot(const char *name, int event_mode)
 {
-    return c64_snapshot_read(name, event_mode);
+    if (c64_snapshot_read(name, event_mode) < 0) {
+        return -1;
+    }
+    snapshot_read_done();
+    return 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -25,6 +25,7 @@
 
 #include "vice.h"
 
+#include "c64mem.h"
 #include "maincpu.h"
 #include "mem.h"
 
@@ -116,6 +117,33 @@ static void memmap_mark_read(unsigned int addr)
 }
 #endif
 
+#ifndef FEATURE_CPUMEMHISTORY
+/* Side-effect free pages are read with a single indexed load from the
+   flattened read map, only I/O, cartridge and zero page accesses need to
+   call a read function.  */
+inline static uint8_t mem_read_direct(unsigned int addr)
+{
+    uint8_t *p = _mem_read_direct_tab_ptr[addr >> 8];
+
+    if (p != NULL) {
+        return p[addr];
+    }
+    return (*_mem_read_tab_ptr[addr >> 8])((uint16_t)(addr));
+}
+
+inline static uint8_t mem_read_direct_zero(unsigned int addr)
+{
+    addr &= 0xff;
+    if (addr > 1 && _mem_read_direct_zero_ptr != NULL) {
+        return _mem_read_direct_zero_ptr[addr];
+    }
+    return (*_mem_read_tab_ptr[0])((uint16_t)(addr));
+}
+
+#define LOAD(addr) mem_read_direct(addr)
+#define LOAD_ZERO(addr) mem_read_direct_zero(addr)
+#endif
+
 static void check_and_run_alternate_cpu(void)
 {
     cpmcart_check_and_run_z80();
@@ -79,6 +79,14 @@ extern void mem_set_tape_motor_in(int val);
 
 extern uint8_t mem_chargen_rom[C64_CHARGEN_ROM_SIZE];
 
+/* Flattened read map of the current memory configuration, NULL entries must
+   be read through `_mem_read_tab_ptr'.  */
+extern uint8_t **_mem_read_direct_tab_ptr;
+
+/* Zero page of the current memory configuration for direct reads of
+   $02-$ff, NULL if they must be read through `_mem_read_tab_ptr[0]'.  */
+extern uint8_t *_mem_read_direct_zero_ptr;
+
 extern void mem_set_write_hook(int config, int page, store_func_t *f);
 extern void mem_read_tab_set(unsigned int base, unsigned int index, read_func_ptr_t read_func);
 extern void mem_read_base_set(unsigned int base, unsigned int index, uint8_t *mem_ptr);
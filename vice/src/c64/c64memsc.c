@@ -45,6 +45,9 @@
 #include "c64pla.h"
 #include "c64ui.h"
 #include "c64cartmem.h"
+#define CARTRIDGE_INCLUDE_SLOTMAIN_API
+#include "c64cartsystem.h"
+#undef CARTRIDGE_INCLUDE_SLOTMAIN_API
 #include "cartio.h"
 #include "cartridge.h"
 #include "cia.h"
@@ -101,6 +104,8 @@ read_func_ptr_t *_mem_read_tab_ptr;
 store_func_ptr_t *_mem_write_tab_ptr;
 static uint8_t **_mem_read_base_tab_ptr;
 static uint32_t *mem_read_limit_tab_ptr;
+uint8_t **_mem_read_direct_tab_ptr;
+uint8_t *_mem_read_direct_zero_ptr;
 
 /* Memory read and write tables.  */
 static store_func_ptr_t mem_write_tab[NUM_CONFIGS][0x101];
@@ -108,6 +113,16 @@ static read_func_ptr_t mem_read_tab[NUM_CONFIGS][0x101];
 static uint8_t *mem_read_base_tab[NUM_CONFIGS][0x101];
 static uint32_t mem_read_limit_tab[NUM_CONFIGS][0x101];
 
+/* Flattened read map per memory configuration: pages that are plain RAM or
+   ROM point to their backing memory, all other pages are NULL and must be
+   read through the read function table.  */
+static uint8_t *mem_read_direct_tab[NUM_CONFIGS][0x101];
+static uint8_t *mem_read_direct_tab_watch[0x101];
+
+/* Zero page for direct reads of $02-$ff per memory configuration, NULL if
+   the zero page has a RAM expansion handler.  */
+static uint8_t *mem_read_direct_zero[NUM_CONFIGS];
+
 static store_func_ptr_t mem_write_tab_watch[0x101];
 static read_func_ptr_t mem_read_tab_watch[0x101];
 
@@ -159,9 +174,13 @@ void mem_toggle_watchpoints(int flag, void *context)
     if (flag) {
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
+        _mem_read_direct_tab_ptr = mem_read_direct_tab_watch;
+        _mem_read_direct_zero_ptr = NULL;
     } else {
         _mem_read_tab_ptr = mem_read_tab[mem_config];
         _mem_write_tab_ptr = mem_write_tab[mem_config];
+        _mem_read_direct_tab_ptr = mem_read_direct_tab[mem_config];
+        _mem_read_direct_zero_ptr = mem_read_direct_zero[mem_config];
     }
     watchpoints_active = flag;
 }
@@ -203,10 +222,34 @@ static void clk_overflow_callback(CLOCK sub, void *unused_data)
     }
 }
 
+/* Tell the coverage maps which bank an access goes to.  */
+static int mem_coverage_bank(uint16_t addr, int store)
+{
+    read_func_ptr_t f = mem_read_tab[mem_config][addr >> 8];
+
+    if (f == roml_read) {
+        return MON_COVERAGE_BANK_CART + (roml_bank & 0xff);
+    }
+    if (f == romh_read || f == ultimax_romh_read_hirom) {
+        return MON_COVERAGE_BANK_CART + (romh_bank & 0xff);
+    }
+    if (f == c64memrom_basic64_read || f == c64memrom_kernal64_read
+        || f == chargen_read) {
+        /* writes go to the RAM below */
+        return store ? MON_COVERAGE_BANK_RAM : MON_COVERAGE_BANK_ROM;
+    }
+    if (addr >= 0xd000 && addr <= 0xdfff && f != ram_read) {
+        return MON_COVERAGE_BANK_IO;
+    }
+    return MON_COVERAGE_BANK_RAM;
+}
+
 void c64_mem_init(void)
 {
     clk_guard_add_callback(maincpu_clk_guard, clk_overflow_callback, NULL);
 
+    monitor_coverage_set_bank_func(e_comp_space, mem_coverage_bank);
+
     /* Initialize REU BA low interface (FIXME find a better place for this) */
     reu_ba_register(vicii_cycle_reu, vicii_steal_cycles, &maincpu_ba_low_flags, MAINCPU_BA_LOW_REU);
 
@@ -223,9 +266,13 @@ void mem_pla_config_changed(void)
     if (watchpoints_active) {
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
+        _mem_read_direct_tab_ptr = mem_read_direct_tab_watch;
+        _mem_read_direct_zero_ptr = NULL;
     } else {
         _mem_read_tab_ptr = mem_read_tab[mem_config];
         _mem_write_tab_ptr = mem_write_tab[mem_config];
+        _mem_read_direct_tab_ptr = mem_read_direct_tab[mem_config];
+        _mem_read_direct_zero_ptr = mem_read_direct_zero[mem_config];
     }
 
     _mem_read_base_tab_ptr = mem_read_base_tab[mem_config];
@@ -628,6 +675,55 @@ void mem_read_base_set(unsigned int base, unsigned int index, uint8_t *mem_ptr)
     mem_read_base_tab[base][index] = mem_ptr;
 }
 
+/* Return the direct read base for `page' of a ROM that is read through
+   `rom[addr & mask]'.  */
+static uint8_t *mem_read_direct_rom(uint8_t *rom, unsigned int mask, unsigned int page)
+{
+    return rom + ((page << 8) & mask) - (page << 8);
+}
+
+/* Build the flattened read maps from the read function tables.  Only the
+   plain RAM, BASIC, KERNAL and character ROM handlers are side-effect free,
+   so only those pages get a direct pointer.  The zero page has its own
+   pointer, as the processor port at $00/$01 must always be read through
+   zero_read().  The $100xx wrap-around page always goes through the read
+   functions.  */
+static void mem_read_direct_init(void)
+{
+    unsigned int i, j;
+    read_func_ptr_t f;
+    uint8_t *p;
+
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        if (mem_read_tab[i][0] == zero_read && !c64_256k_enabled && !plus256k_enabled) {
+            mem_read_direct_zero[i] = mem_ram;
+        } else {
+            mem_read_direct_zero[i] = NULL;
+        }
+        mem_read_direct_tab[i][0] = NULL;
+        for (j = 1; j <= 0xff; j++) {
+            f = mem_read_tab[i][j];
+            if (f == ram_read) {
+                p = mem_ram;
+            } else if (f == chargen_read) {
+                p = mem_read_direct_rom(mem_chargen_rom, 0xfff, j);
+            } else if (f == c64memrom_basic64_read) {
+                p = mem_read_direct_rom(c64memrom_basic64_rom, 0x1fff, j);
+            } else if (f == c64memrom_kernal64_read) {
+                p = mem_read_direct_rom(c64memrom_kernal64_rom, 0x1fff, j);
+            } else {
+                p = NULL;
+            }
+            mem_read_direct_tab[i][j] = p;
+        }
+        mem_read_direct_tab[i][0x100] = NULL;
+    }
+
+    for (j = 0; j <= 0x100; j++) {
+        mem_read_direct_tab_watch[j] = NULL;
+    }
+}
+
 void mem_initialize_memory(void)
 {
     int i, j;
@@ -710,6 +806,7 @@ void mem_initialize_memory(void)
     _mem_write_tab_ptr = mem_write_tab[7];
     _mem_read_base_tab_ptr = mem_read_base_tab[7];
     mem_read_limit_tab_ptr = mem_read_limit_tab[7];
+    _mem_read_direct_tab_ptr = mem_read_direct_tab[7];
 
     vicii_set_chargen_addr_options(0x7000, 0x1000);
 
@@ -730,6 +827,9 @@ void mem_initialize_memory(void)
     if (board == 1) {
         mem_limit_max_init(mem_read_limit_tab);
     }
+
+    mem_read_direct_init();
+    _mem_read_direct_zero_ptr = mem_read_direct_zero[7];
 }
 
 void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit)
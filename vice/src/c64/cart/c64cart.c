@@ -37,6 +37,7 @@
 
 #include "alarm.h"
 #include "archdep.h"
+#include "bootsnapshot.h"
 #include "c64.h"
 #include "c64cart.h"
 #define CARTRIDGE_INCLUDE_SLOTMAIN_API
@@ -640,6 +641,7 @@ int cartridge_attach_image(int type, const char *filename)
     }
 
     DBG(("CART: cartridge_attach_image type: %d ID: %d done.\n", type, carttype));
+    bootsnapshot_cartridge_attach(cartid, abs_filename);
     lib_free(rawcart);
     log_message(LOG_DEFAULT, "CART: attached '%s' as ID %d.", abs_filename, carttype);
     lib_free(abs_filename);
@@ -712,6 +714,8 @@ void cart_detach_slotmain(void)
 */
 void cartridge_detach_image(int type)
 {
+    bootsnapshot_cartridge_detach(type == 0 ? cart_getid_slotmain() : type);
+
     if (type == 0) {
         DBG(("CART: detach MAIN ID: %d\n", type));
         cart_detach_slotmain();
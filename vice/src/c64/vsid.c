@@ -63,6 +63,7 @@
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
 #include "sid.h"
+#include "snapshot.h"
 #include "viciivsid.h"
 #include "vicii-mem.h"
 #include "video.h"
@@ -400,7 +401,11 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks, int
 
 int machine_read_snapshot(const char *name, int event_mode)
 {
-    return c64_snapshot_read(name, event_mode);
+    if (c64_snapshot_read(name, event_mode) < 0) {
+        return -1;
+    }
+    snapshot_read_done();
+    return 0;
 }
 
 /* ------------------------------------------------------------------------- */
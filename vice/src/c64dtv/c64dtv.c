@@ -93,6 +93,7 @@
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
 #include "sid.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "tape.h"
 #include "tapeport.h"
@@ -894,7 +895,11 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks,
 
 int machine_read_snapshot(const char *name, int event_mode)
 {
-    return c64dtv_snapshot_read(name, event_mode);
+    if (c64dtv_snapshot_read(name, event_mode) < 0) {
+        return -1;
+    }
+    snapshot_read_done();
+    return 0;
 }
 
 /* ------------------------------------------------------------------------- */
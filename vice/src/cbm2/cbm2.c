@@ -942,7 +942,11 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks,
 
 int machine_read_snapshot(const char *name, int event_mode)
 {
-    return cbm2_snapshot_read(name, event_mode);
+    if (cbm2_snapshot_read(name, event_mode) < 0) {
+        return -1;
+    }
+    snapshot_read_done();
+    return 0;
 }
 
 /* ------------------------------------------------------------------------- */
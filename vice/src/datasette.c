@@ -66,6 +66,18 @@
 /* at least every DATASETTE_MAX_GAP cycle there should be an alarm */
 #define DATASETTE_MAX_GAP   100000
 
+/* With DatasetteCollapsePilot, pilot tones of more than
+   DATASETTE_PILOT_MIN + DATASETTE_PILOT_KEEP pulses pass with one alarm
+   per DATASETTE_MAX_GAP cycles, except for the last DATASETTE_PILOT_KEEP
+   pulses which the loader needs to sync.  Pulses within
+   DATASETTE_PILOT_TOLERANCE TAP units of the first one count as pilot.
+   The dropped pulses are not sent to the machine even if the CPU is
+   watching the read line; there is no fallback to sending every pulse,
+   so loaders that count or time the whole pilot tone fail with it.  */
+#define DATASETTE_PILOT_MIN         512
+#define DATASETTE_PILOT_KEEP        4096
+#define DATASETTE_PILOT_TOLERANCE   2
+
 
 /* Attached TAP tape image.  */
 static tap_t *current_image = NULL;
@@ -95,6 +107,10 @@ static CLOCK datasette_long_gap_elapsed = 0;
 
 static int datasette_last_direction = 0;
 
+/* Counter cycles of the gaps up to the pending alarm, added to the tape
+   counter when the alarm fires.  */
+static int datasette_counter_pending = 0;
+
 static long datasette_cycles_per_second;
 
 /* Remember the reset of tape-counter.  */
@@ -120,6 +136,12 @@ static CLOCK fullwave_gap;
 /* random wobble to be added to tape pulses */
 static int datasette_tape_wobble = 0;
 
+/* pass over long pilot tones with one alarm in play mode */
+static int datasette_collapse_pilot = 0;
+
+/* write the header index of TAP images next to them */
+static int datasette_write_index = 1;
+
 /* datasette device enable */
 static int datasette_enable = 0;
 
@@ -210,6 +232,21 @@ static int set_datasette_tape_wobble(int val, void *param)
     return 0;
 }
 
+static int set_datasette_collapse_pilot(int val, void *param)
+{
+    datasette_collapse_pilot = val ? 1 : 0;
+
+    return 0;
+}
+
+static int set_datasette_write_index(int val, void *param)
+{
+    datasette_write_index = val ? 1 : 0;
+    tap_set_index_write(datasette_write_index);
+
+    return 0;
+}
+
 static int set_datasette_enable(int value, void *param)
 {
     int val = value ? 1 : 0;
@@ -249,6 +286,12 @@ static const resource_int_t resources_int[] = {
     { "DatasetteTapeWobble", 10, RES_EVENT_SAME, NULL,
       &datasette_tape_wobble,
       set_datasette_tape_wobble, NULL },
+    { "DatasetteCollapsePilot", 0, RES_EVENT_SAME, NULL,
+      &datasette_collapse_pilot,
+      set_datasette_collapse_pilot, NULL },
+    { "DatasetteWriteIndex", 1, RES_EVENT_NO, NULL,
+      &datasette_write_index,
+      set_datasette_write_index, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -299,6 +342,26 @@ static const cmdline_option_t cmdline_options[] = {
       USE_PARAM_ID, USE_DESCRIPTION_ID,
       IDCLS_P_VALUE, IDCLS_SET_TAPE_WOBBLE,
       NULL, NULL },
+    { "-dscollapsepilot", SET_RESOURCE, 0,
+      NULL, NULL, "DatasetteCollapsePilot", (resource_value_t)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Pass over long pilot tones with one alarm, dropping all but their last pulses" },
+    { "+dscollapsepilot", SET_RESOURCE, 0,
+      NULL, NULL, "DatasetteCollapsePilot", (resource_value_t)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Send every pulse of pilot tones to the machine" },
+    { "-dswriteindex", SET_RESOURCE, 0,
+      NULL, NULL, "DatasetteWriteIndex", (resource_value_t)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Save the file headers found on TAP images in a .vtx file next to them" },
+    { "+dswriteindex", SET_RESOURCE, 0,
+      NULL, NULL, "DatasetteWriteIndex", (resource_value_t)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Do not write .vtx index files for TAP images" },
     CMDLINE_LIST_END
 };
 
@@ -581,6 +644,62 @@ static CLOCK datasette_read_gap(int direction)
     return gap;
 }
 
+/* Add the counter of the gaps that passed the head since the last alarm.  */
+static void datasette_counter_apply(void)
+{
+    if (current_image != NULL) {
+        current_image->cycle_counter += datasette_counter_pending;
+    }
+    datasette_counter_pending = 0;
+}
+
+/* In play mode, pass over the pilot tone following the gap just read, up
+   to DATASETTE_PILOT_KEEP pulses before its end as far as it is in the
+   buffer.  Returns the length of the skipped pulses, 0 if the gap does
+   not start a long enough pilot.  */
+static CLOCK datasette_skip_pilot(CLOCK gap)
+{
+    long run, skip, i;
+    int pilot;
+    CLOCK total = 0;
+
+    if (!datasette_collapse_pilot
+        || machine_tape_behaviour() == TAPE_BEHAVIOUR_C16
+        || next_tap < 1 || next_tap > last_tap) {
+        return 0;
+    }
+
+    pilot = tap_buffer[next_tap - 1];
+    if (pilot == 0) {
+        return 0;
+    }
+    for (run = 0; next_tap + run < last_tap; run++) {
+        int value = tap_buffer[next_tap + run];
+
+        if (value == 0 || value < pilot - DATASETTE_PILOT_TOLERANCE
+            || value > pilot + DATASETTE_PILOT_TOLERANCE) {
+            break;
+        }
+    }
+    if (run < DATASETTE_PILOT_MIN + DATASETTE_PILOT_KEEP) {
+        return 0;
+    }
+
+    skip = run - DATASETTE_PILOT_KEEP;
+    for (i = 0; i < skip && gap + total < DATASETTE_MAX_GAP; i++) {
+        CLOCK next = 0;
+        int direction = 1;
+
+        if (fetch_gap(&next, &direction, next_tap) < 0) {
+            break;
+        }
+        next_tap++;
+        current_image->current_file_seek_position++;
+        total += next;
+    }
+    return total;
+}
+
 /* this is the alarm function */
 static void datasette_read_bit(CLOCK offset, void *data)
 {
@@ -590,6 +709,7 @@ static void datasette_read_bit(CLOCK offset, void *data)
 
     alarm_unset(datasette_alarm);
     datasette_alarm_pending = 0;
+    datasette_counter_apply();
 
     DBG(("datasette_read_bit(motor:%d) %d>=%d (image present:%s)", datasette_motor, maincpu_clk, motor_stop_clk, current_image ? "yes" : "no"));
 
@@ -685,10 +805,40 @@ static void datasette_read_bit(CLOCK offset, void *data)
     datasette_long_gap_elapsed += gap;
     datasette_last_direction = direction;
 
-    if (direction > 0) {
-        current_image->cycle_counter += gap / 8;
-    } else {
-        current_image->cycle_counter -= gap / 8;
+    datasette_counter_pending = (int)(gap / 8);
+
+    if (current_image->mode != DATASETTE_CONTROL_START) {
+        /* While winding no flux changes reach the machine, so pass over
+           the gaps up to DATASETTE_MAX_GAP with one alarm.  */
+        CLOCK next;
+
+        while (gap < DATASETTE_MAX_GAP && !datasette_long_gap_pending) {
+            next = datasette_read_gap(direction);
+            if (!next) {
+                break;
+            }
+            if (gap + next > DATASETTE_MAX_GAP) {
+                datasette_long_gap_pending = gap + next - DATASETTE_MAX_GAP;
+                next -= datasette_long_gap_pending;
+            }
+            datasette_long_gap_elapsed = next;
+            datasette_counter_pending += (int)(next / 8);
+            gap += next;
+        }
+    } else if (!datasette_long_gap_pending) {
+        /* The flux changes inside a long pilot tone are dropped, the
+           next alarm comes at the end of the skipped pulses.  */
+        CLOCK skipped = datasette_skip_pilot(gap);
+
+        if (skipped) {
+            datasette_long_gap_elapsed = skipped;
+            datasette_counter_pending += (int)(skipped / 8);
+            gap += skipped;
+        }
+    }
+
+    if (direction < 0) {
+        datasette_counter_pending = -datasette_counter_pending;
     }
 
     gap -= offset;
@@ -777,6 +927,7 @@ static void datasette_forward(void)
         mode == DATASETTE_CONTROL_REWIND) {
         alarm_unset(datasette_alarm);
         datasette_alarm_pending = 0;
+        datasette_counter_apply();
     }
     alarm_set(datasette_alarm, maincpu_clk + 1000);
     datasette_alarm_pending = 1;
@@ -792,6 +943,7 @@ static void datasette_rewind(void)
         mode == DATASETTE_CONTROL_FORWARD) {
         alarm_unset(datasette_alarm);
         datasette_alarm_pending = 0;
+        datasette_counter_apply();
     }
     alarm_set(datasette_alarm, maincpu_clk + 1000);
     datasette_alarm_pending = 1;
@@ -818,6 +970,7 @@ static void datasette_internal_reset(void)
         current_image->cycle_counter = 0;
     }
     datasette_counter_offset = 0;
+    datasette_counter_pending = 0;
     datasette_long_gap_pending = 0;
     datasette_long_gap_elapsed = 0;
     datasette_last_direction = 0;
@@ -1079,6 +1232,8 @@ inline static void bit_write(void)
         current_image->cycle_counter_total = current_image->cycle_counter;
     }
     current_image->has_changed = 1;
+    current_image->file_index_count = 0;
+    current_image->file_index_saved = 0;
     datasette_update_ui_counter();
 }
 
@@ -1127,7 +1282,7 @@ void datasette_event_playback(CLOCK offset, void *data)
  ******************************************************************************/
 
 #define DATASETTE_SNAP_MAJOR 1
-#define DATASETTE_SNAP_MINOR 3
+#define DATASETTE_SNAP_MINOR 4
 
 static int datasette_write_snapshot(snapshot_t *s, int write_image)
 {
@@ -1160,7 +1315,8 @@ static int datasette_write_snapshot(snapshot_t *s, int write_image)
         || SMW_DW(m, datasette_speed_tuning) < 0
         || SMW_DW(m, datasette_tape_wobble) < 0
         || SMW_B(m, (uint8_t)fullwave) < 0
-        || SMW_DW(m, fullwave_gap) < 0) {
+        || SMW_DW(m, fullwave_gap) < 0
+        || SMW_DW(m, (uint32_t)datasette_counter_pending) < 0) {
         snapshot_module_close(m);
         return -1;
     }
@@ -1205,6 +1361,13 @@ static int datasette_read_snapshot(snapshot_t *s)
         return -1;
     }
 
+    datasette_counter_pending = 0;
+    if (SNAPVAL(major_version, minor_version, 1, 4)
+        && SMR_DW_INT(m, &datasette_counter_pending) < 0) {
+        snapshot_module_close(m);
+        return -1;
+    }
+
     if (datasette_alarm_pending) {
         alarm_set(datasette_alarm, alarm_clk);
     } else {
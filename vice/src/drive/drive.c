@@ -798,6 +798,12 @@ void drive_cpu_execute_one(drive_context_t *drv, CLOCK clk_value)
 {
     drive_t *drive = drv->drive;
 
+    /* Nothing to do if the drive already caught up with this clock, which
+       happens a lot when several bus accesses sync within the same cycle.  */
+    if (clk_value == drv->cpu->last_clk) {
+        return;
+    }
+
     if (drive->type == DRIVE_TYPE_2000 || drive->type == DRIVE_TYPE_4000) {
         drivecpu65c02_execute(drv, clk_value);
     } else {
@@ -125,12 +125,56 @@ void drivecpu_setup_context(struct drive_context_s *drv, int i)
 
 /* ------------------------------------------------------------------------- */
 
-#define LOAD(a)           (*drv->cpud->read_func_ptr[(a) >> 8])(drv, (uint16_t)(a))
-#define LOAD_ZERO(a)      (*drv->cpud->read_func_ptr[0])(drv, (uint16_t)(a))
+/* Read directly from RAM/ROM pages, call the read function otherwise.  */
+inline static uint8_t drive_load(drive_context_t *drv, unsigned int addr)
+{
+    uint8_t *p = drv->cpud->read_direct_ptr[addr >> 8];
+
+    if (p != NULL) {
+        return p[addr];
+    }
+    return (*drv->cpud->read_func_ptr[addr >> 8])(drv, (uint16_t)addr);
+}
+
+inline static uint8_t drive_load_zero(drive_context_t *drv, unsigned int addr)
+{
+    uint8_t *p = drv->cpud->read_direct_ptr[0];
+
+    if (p != NULL) {
+        return p[addr & 0xff];
+    }
+    return (*drv->cpud->read_func_ptr[0])(drv, (uint16_t)addr);
+}
+
+/* Store directly into RAM pages, call the store function otherwise.  */
+inline static void drive_store(drive_context_t *drv, unsigned int addr, uint8_t value)
+{
+    uint8_t *p = drv->cpud->store_direct_ptr[addr >> 8];
+
+    if (p != NULL) {
+        p[addr] = value;
+    } else {
+        (*drv->cpud->store_func_ptr[addr >> 8])(drv, (uint16_t)addr, value);
+    }
+}
+
+inline static void drive_store_zero(drive_context_t *drv, unsigned int addr, uint8_t value)
+{
+    uint8_t *p = drv->cpud->store_direct_ptr[0];
+
+    if (p != NULL) {
+        p[addr & 0xff] = value;
+    } else {
+        (*drv->cpud->store_func_ptr[0])(drv, (uint16_t)addr, value);
+    }
+}
+
+#define LOAD(a)           drive_load(drv, (unsigned int)(a))
+#define LOAD_ZERO(a)      drive_load_zero(drv, (unsigned int)(a))
 #define LOAD_ADDR(a)      (LOAD((a)) | (LOAD((a) + 1) << 8))
 #define LOAD_ZERO_ADDR(a) (LOAD_ZERO((a)) | (LOAD_ZERO((a) + 1) << 8))
-#define STORE(a, b)       (*drv->cpud->store_func_ptr[(a) >> 8])(drv, (uint16_t)(a), (uint8_t)(b))
-#define STORE_ZERO(a, b)  (*drv->cpud->store_func_ptr[0])(drv, (uint16_t)(a), (uint8_t)(b))
+#define STORE(a, b)       drive_store(drv, (unsigned int)(a), (uint8_t)(b))
+#define STORE_ZERO(a, b)  drive_store_zero(drv, (unsigned int)(a), (uint8_t)(b))
 
 #define JUMP(addr)                                                         \
     do {                                                                   \
@@ -49,6 +49,8 @@
 
 static drive_read_func_t *read_tab_watch[0x101];
 static drive_store_func_t *store_tab_watch[0x101];
+static uint8_t *read_direct_tab_watch[0x101];
+static uint8_t *store_direct_tab_watch[0x101];
 
 /* ------------------------------------------------------------------------- */
 /* Common memory access.  */
@@ -104,9 +106,13 @@ void drivemem_toggle_watchpoints(int flag, void *context)
     if (flag) {
         drv->cpud->read_func_ptr = read_tab_watch;
         drv->cpud->store_func_ptr = store_tab_watch;
+        drv->cpud->read_direct_ptr = read_direct_tab_watch;
+        drv->cpud->store_direct_ptr = store_direct_tab_watch;
     } else {
         drv->cpud->read_func_ptr = drv->cpud->read_tab[0];
         drv->cpud->store_func_ptr = drv->cpud->store_tab[0];
+        drv->cpud->read_direct_ptr = drv->cpud->read_direct_tab[0];
+        drv->cpud->store_direct_ptr = drv->cpud->store_direct_tab[0];
     }
 }
 
@@ -143,6 +149,25 @@ void drivemem_set_func(drivecpud_context_t *cpud,
     for (i = start; i < stop; i++) {
         cpud->read_base_tab[0][i] = base ? (base - (start << 8)) : NULL;
         cpud->read_limit_tab[0][i] = limit;
+        cpud->read_direct_tab[0][i] = NULL;
+        cpud->store_direct_tab[0][i] = NULL;
+    }
+}
+
+/* Let the CPU read pages `start' to `stop' - 1 directly from `mem[addr & mask]'
+   instead of calling the read function, and store there too if `writable'.
+   Only valid for plain RAM and ROM, must be called after `drivemem_set_func()'
+   for the same range.  */
+void drivemem_set_direct(drivecpud_context_t *cpud,
+                         unsigned int start, unsigned int stop,
+                         uint8_t *mem, unsigned int mask,
+                         int writable)
+{
+    unsigned int i;
+
+    for (i = start; i < stop; i++) {
+        cpud->read_direct_tab[0][i] = mem + ((i << 8) & mask) - (i << 8);
+        cpud->store_direct_tab[0][i] = writable ? cpud->read_direct_tab[0][i] : NULL;
     }
 }
 
@@ -193,6 +218,8 @@ void drivemem_init(drive_context_t *drv, unsigned int type)
     drv->cpud->read_tab[0][0x100] = drv->cpud->read_tab[0][0];
     drv->cpud->store_tab[0][0x100] = drv->cpud->store_tab[0][0];
     drv->cpud->peek_tab[0][0x100] = drv->cpud->peek_tab[0][0];
+    drv->cpud->read_direct_tab[0][0x100] = NULL;
+    drv->cpud->store_direct_tab[0][0x100] = NULL;
 
     drv->cpud->read_func_ptr = drv->cpud->read_tab[0];
     drv->cpud->store_func_ptr = drv->cpud->store_tab[0];
@@ -200,6 +227,8 @@ void drivemem_init(drive_context_t *drv, unsigned int type)
 
     drv->cpud->read_base_tab_ptr = drv->cpud->read_base_tab[0];
     drv->cpud->read_limit_tab_ptr = drv->cpud->read_limit_tab[0];
+    drv->cpud->read_direct_ptr = drv->cpud->read_direct_tab[0];
+    drv->cpud->store_direct_ptr = drv->cpud->store_direct_tab[0];
 }
 
 mem_ioreg_list_t *drivemem_ioreg_list_get(void *context)
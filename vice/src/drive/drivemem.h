@@ -45,6 +45,10 @@ extern void drivemem_set_func(struct drivecpud_context_s *cpud,
                               drive_store_func_t *store_func,
                               drive_peek_func_t *peek_func,
                               uint8_t *base, uint32_t limit);
+extern void drivemem_set_direct(struct drivecpud_context_s *cpud,
+                                unsigned int start, unsigned int stop,
+                                uint8_t *mem, unsigned int mask,
+                                int writable);
 
 extern struct mem_ioreg_list_s *drivemem_ioreg_list_get(void *context);
 
@@ -119,6 +119,8 @@ typedef struct drivecpud_context_s {
     drive_peek_func_ptr_t *peek_func_ptr;
     uint8_t **read_base_tab_ptr;
     uint32_t *read_limit_tab_ptr;
+    uint8_t **read_direct_ptr;
+    uint8_t **store_direct_ptr;
 
     /* Memory read and write tables.  */
     drive_read_func_t *read_tab[1][0x101];
@@ -127,6 +129,11 @@ typedef struct drivecpud_context_s {
     uint8_t *read_base_tab[1][0x101];
     uint32_t read_limit_tab[1][0x101];
 
+    /* Pages without read/store side effects, NULL if the read or store
+       function must be called.  */
+    uint8_t *read_direct_tab[1][0x101];
+    uint8_t *store_direct_tab[1][0x101];
+
     int sync_factor;
 } drivecpud_context_t;
 
@@ -93,82 +93,108 @@ void memiec_init(struct drive_context_s *drv, unsigned int type)
     case DRIVE_TYPE_1541II:
         drv->cpu->pageone = drv->drive->drive_ram + 0x100;
         drivemem_set_func(cpud, 0x00, 0x01, drive_read_zero, drive_store_zero, NULL, drv->drive->drive_ram, 0x000007fd);
+        drivemem_set_direct(cpud, 0x00, 0x01, drv->drive->drive_ram, 0x7ff, 1);
         drivemem_set_func(cpud, 0x01, 0x08, drive_read_1541ram, drive_store_1541ram, NULL, &drv->drive->drive_ram[0x0100], 0x000007fd);
+        drivemem_set_direct(cpud, 0x01, 0x08, drv->drive->drive_ram, 0x7ff, 1);
         drivemem_set_func(cpud, 0x18, 0x1c, via1d1541_read, via1d1541_store, via1d1541_peek, NULL, 0);
         drivemem_set_func(cpud, 0x1c, 0x20, via2d_read, via2d_store, via2d_peek, NULL, 0);
         if (drv->drive->drive_ram2_enabled) {
             drivemem_set_func(cpud, 0x20, 0x40, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x2000], 0x20003ffd);
+            drivemem_set_direct(cpud, 0x20, 0x40, drv->drive->drive_ram, 0xffff, 1);
         } else {
             drivemem_set_func(cpud, 0x20, 0x28, drive_read_1541ram, drive_store_1541ram, NULL, drv->drive->drive_ram, 0x200027fd);
+            drivemem_set_direct(cpud, 0x20, 0x28, drv->drive->drive_ram, 0x7ff, 1);
             drivemem_set_func(cpud, 0x38, 0x3c, via1d1541_read, via1d1541_store, via1d1541_peek, NULL, 0);
             drivemem_set_func(cpud, 0x3c, 0x40, via2d_read, via2d_store, via2d_peek, NULL, 0);
         }
         if (drv->drive->drive_ram4_enabled) {
             drivemem_set_func(cpud, 0x40, 0x60, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x4000], 0x40005ffd);
+            drivemem_set_direct(cpud, 0x40, 0x60, drv->drive->drive_ram, 0xffff, 1);
         } else {
             drivemem_set_func(cpud, 0x40, 0x48, drive_read_1541ram, drive_store_1541ram, NULL, drv->drive->drive_ram, 0x400047fd);
+            drivemem_set_direct(cpud, 0x40, 0x48, drv->drive->drive_ram, 0x7ff, 1);
             drivemem_set_func(cpud, 0x58, 0x5c, via1d1541_read, via1d1541_store, via1d1541_peek, NULL, 0);
             drivemem_set_func(cpud, 0x5c, 0x60, via2d_read, via2d_store, via2d_peek, NULL, 0);
         }
         if (drv->drive->drive_ram6_enabled) {
             drivemem_set_func(cpud, 0x60, 0x80, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x6000], 0x60007ffd);
+            drivemem_set_direct(cpud, 0x60, 0x80, drv->drive->drive_ram, 0xffff, 1);
         } else {
             drivemem_set_func(cpud, 0x60, 0x68, drive_read_1541ram, drive_store_1541ram, NULL, drv->drive->drive_ram, 0x600067fd);
+            drivemem_set_direct(cpud, 0x60, 0x68, drv->drive->drive_ram, 0x7ff, 1);
             drivemem_set_func(cpud, 0x78, 0x7c, via1d1541_read, via1d1541_store, via1d1541_peek, NULL, 0);
             drivemem_set_func(cpud, 0x7c, 0x80, via2d_read, via2d_store, via2d_peek, NULL, 0);
         }
         if (drv->drive->drive_ram8_enabled) {
             drivemem_set_func(cpud, 0x80, 0xa0, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x8000], 0x80009ffd);
+            drivemem_set_direct(cpud, 0x80, 0xa0, drv->drive->drive_ram, 0xffff, 1);
         } else {
             drivemem_set_func(cpud, 0x80, 0xa0, drive_read_rom, NULL, NULL, drv->drive->trap_rom, 0x80009ffd);
+            drivemem_set_direct(cpud, 0x80, 0xa0, drv->drive->rom, 0x7fff, 0);
         }
         if (drv->drive->drive_rama_enabled) {
             drivemem_set_func(cpud, 0xa0, 0xc0, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0xa000], 0xa000bffd);
+            drivemem_set_direct(cpud, 0xa0, 0xc0, drv->drive->drive_ram, 0xffff, 1);
         } else {
             drivemem_set_func(cpud, 0xa0, 0xc0, drive_read_rom, NULL, NULL, &drv->drive->trap_rom[0x2000], 0xa000bffd);
+            drivemem_set_direct(cpud, 0xa0, 0xc0, drv->drive->rom, 0x7fff, 0);
         }
         drivemem_set_func(cpud, 0xc0, 0x100, drive_read_rom, NULL, NULL, &drv->drive->trap_rom[0x4000], 0xc000fffd);
+        drivemem_set_direct(cpud, 0xc0, 0x100, drv->drive->rom, 0x7fff, 0);
         break;
     case DRIVE_TYPE_1570:
     case DRIVE_TYPE_1571:
     case DRIVE_TYPE_1571CR:
         drv->cpu->pageone = drv->drive->drive_ram + 0x100;
         drivemem_set_func(cpud, 0x00, 0x01, drive_read_zero, drive_store_zero, NULL, drv->drive->drive_ram, 0x000007fd);
+        drivemem_set_direct(cpud, 0x00, 0x01, drv->drive->drive_ram, 0x7ff, 1);
         drivemem_set_func(cpud, 0x01, 0x08, drive_read_1541ram, drive_store_1541ram, NULL, &drv->drive->drive_ram[0x0100], 0x000007fd);
+        drivemem_set_direct(cpud, 0x01, 0x08, drv->drive->drive_ram, 0x7ff, 1);
         drivemem_set_func(cpud, 0x08, 0x10, drive_read_1541ram, drive_store_1541ram, NULL, drv->drive->drive_ram, 0x08000ffd);
+        drivemem_set_direct(cpud, 0x08, 0x10, drv->drive->drive_ram, 0x7ff, 1);
         drivemem_set_func(cpud, 0x18, 0x1c, via1d1541_read, via1d1541_store, via1d1541_peek, NULL, 0);
         drivemem_set_func(cpud, 0x1c, 0x20, via2d_read, via2d_store, via2d_peek, NULL, 0);
         drivemem_set_func(cpud, 0x20, 0x30, wd1770d_read, wd1770d_store, wd1770d_peek, NULL, 0);
         if (drv->drive->drive_ram4_enabled) {
             drivemem_set_func(cpud, 0x40, 0x48, cia1571_read, cia1571_store, cia1571_peek, NULL, 0);
             drivemem_set_func(cpud, 0x48, 0x60, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x4000], 0x48005ffd);
+            drivemem_set_direct(cpud, 0x48, 0x60, drv->drive->drive_ram, 0xffff, 1);
         } else {
             drivemem_set_func(cpud, 0x40, 0x60, cia1571_read, cia1571_store, cia1571_peek, NULL, 0);
         }
         if (drv->drive->drive_ram6_enabled) {
             drivemem_set_func(cpud, 0x60, 0x80, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x6000], 0x60007ffd);
+            drivemem_set_direct(cpud, 0x60, 0x80, drv->drive->drive_ram, 0xffff, 1);
         } else {
             drivemem_set_func(cpud, 0x60, 0x80, cia1571_read, cia1571_store, cia1571_peek, NULL, 0);
         }
         drivemem_set_func(cpud, 0x80, 0x100, drive_read_rom, NULL, NULL, drv->drive->trap_rom, 0x8000fffd);
+        drivemem_set_direct(cpud, 0x80, 0x100, drv->drive->rom, 0x7fff, 0);
         break;
     case DRIVE_TYPE_1581:
         drv->cpu->pageone = drv->drive->drive_ram + 0x100;
         drivemem_set_func(cpud, 0x00, 0x01, drive_read_zero, drive_store_zero, NULL, drv->drive->drive_ram, 0x00001ffd);
+        drivemem_set_direct(cpud, 0x00, 0x01, drv->drive->drive_ram, 0x7ff, 1);
         drivemem_set_func(cpud, 0x01, 0x20, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x0100], 0x00001ffd);
+        drivemem_set_direct(cpud, 0x01, 0x20, drv->drive->drive_ram, 0xffff, 1);
         drivemem_set_func(cpud, 0x40, 0x60, cia1581_read, cia1581_store, cia1581_peek, NULL, 0);
         drivemem_set_func(cpud, 0x60, 0x80, wd1770d_read, wd1770d_store, wd1770d_peek, NULL, 0);
         drivemem_set_func(cpud, 0x80, 0x100, drive_read_rom, NULL, NULL, drv->drive->trap_rom, 0x8000fffd);
+        drivemem_set_direct(cpud, 0x80, 0x100, drv->drive->rom, 0x7fff, 0);
         break;
     case DRIVE_TYPE_2000:
     case DRIVE_TYPE_4000:
         drv->cpu->pageone = drv->drive->drive_ram + 0x100;
         drivemem_set_func(cpud, 0x00, 0x01, drive_read_zero, drive_store_zero, NULL, drv->drive->drive_ram, 0x00003ffd);
+        drivemem_set_direct(cpud, 0x00, 0x01, drv->drive->drive_ram, 0x7ff, 1);
         drivemem_set_func(cpud, 0x01, 0x40, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x0100], 0x00003ffd);
+        drivemem_set_direct(cpud, 0x01, 0x40, drv->drive->drive_ram, 0xffff, 1);
         drivemem_set_func(cpud, 0x40, 0x4c, via4000_read, via4000_store, via4000_peek, NULL, 0);
         drivemem_set_func(cpud, 0x4e, 0x50, pc8477d_read, pc8477d_store, pc8477d_peek, NULL, 0);
         drivemem_set_func(cpud, 0x50, 0x80, drive_read_ram, drive_store_ram, NULL, &drv->drive->drive_ram[0x5000], 0x50007ffd);
+        drivemem_set_direct(cpud, 0x50, 0x80, drv->drive->drive_ram, 0xffff, 1);
         drivemem_set_func(cpud, 0x80, 0x100, drive_read_rom, NULL, NULL, drv->drive->trap_rom, 0x8000fffd);
+        drivemem_set_direct(cpud, 0x80, 0x100, drv->drive->rom, 0x7fff, 0);
         /* for performance reasons it's only this page */
         drivemem_set_func(cpud, 0xf0, 0xf1, drive_read_rom_ds1216, NULL, NULL, &drv->drive->trap_rom[0x7000], 0x8000fffd);
         break;
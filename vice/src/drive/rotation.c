@@ -43,6 +43,12 @@
 
 #define ROTATION_TABLE_SIZE 0x1000
 
+/* Non-zero to pass over the UE7 carries which do not clock the shifter in
+   one step, doc/rotationtest.c compares this against stepping every carry */
+#ifndef ROTATION_BATCH_CARRIES
+#define ROTATION_BATCH_CARRIES 1
+#endif
+
 
 struct rotation_s {
     uint32_t accum;
@@ -291,6 +297,17 @@ void rotation_begins(drive_t *dptr)
     rotation[dnr].cycle_index = 0;
 }
 
+/* Reference cycles until the next UE7 carry that clocks the UF4 shifter */
+inline static unsigned int ue7_cycles_to_shift(rotation_t *rptr)
+{
+    unsigned int carries = (2 - rptr->uf4_counter) & 3;
+
+    if (carries == 0) {
+        carries = 4;
+    }
+    return (16 - rptr->ue7_counter) + (carries - 1) * (16 - rptr->ue7_dcba);
+}
+
 /*******************************************************************************
  * 1541 circuit simulation for GCR-based images (.g64),
  * see 1541 circuit description in this file for details
@@ -299,7 +316,7 @@ static void rotation_1541_gcr(drive_t *dptr, int ref_cycles)
 {
     rotation_t *rptr;
     int clk_ref_per_rev, cyc_act_frv;
-    unsigned int todo;
+    unsigned int todo, ue7_todo, ue7_skip;
     int32_t delta;
     uint32_t count_new_bitcell, cyc_sum_frv /*, sum_new_bitcell*/;
     unsigned int dnr = dptr->mynumber;
@@ -341,15 +358,13 @@ static void rotation_1541_gcr(drive_t *dptr, int ref_cycles)
         while (ref_cycles > 0) {
             /* calculate how much cycles can we do in one single pass */
             todo = 1;
+            ue7_skip = 0;
             delta = count_new_bitcell - rptr->accum;
             if ((delta > 0) && ((cyc_sum_frv << 1) <= (uint32_t)delta)) {
                 todo = delta / cyc_sum_frv;
                 if (ref_cycles < (int)todo) {
                     todo = ref_cycles;
                 }
-                if ((rptr->ue7_counter < 16) && ((16 - rptr->ue7_counter) < (int)todo)) {
-                    todo = 16 - rptr->ue7_counter;
-                }
                 if ((rptr->filter_counter < 40) && ((40 - rptr->filter_counter) < (int)todo)) {
                     todo = 40 - rptr->filter_counter;
                 }
@@ -359,6 +374,23 @@ static void rotation_1541_gcr(drive_t *dptr, int ref_cycles)
                 if ((rptr->so_delay > 0) && (rptr->so_delay < (int)todo)) {
                     todo = rptr->so_delay;
                 }
+                if ((rptr->ue7_counter < 16) && ((16 - rptr->ue7_counter) < (int)todo)) {
+                    /* while no flux reversal is pending, the UE7 carries which
+                     * do not clock the shifter only advance UF4, so run up to
+                     * the next shifter edge in one pass
+                     */
+                    ue7_todo = ue7_cycles_to_shift(rptr);
+                    if (ue7_todo < todo) {
+                        todo = ue7_todo;
+                    }
+                    if (!ROTATION_BATCH_CARRIES
+                        || (rptr->filter_last_state != rptr->filter_state) || (rptr->fr_randcount == todo)) {
+                        todo = 16 - rptr->ue7_counter;
+                    } else {
+                        ue7_todo = todo - (16 - rptr->ue7_counter);
+                        ue7_skip = (ue7_todo + (15 - rptr->ue7_dcba)) / (16 - rptr->ue7_dcba);
+                    }
+                }
             }
 
             /* so signal handling */
@@ -391,6 +423,12 @@ static void rotation_1541_gcr(drive_t *dptr, int ref_cycles)
                 }
             }
 
+            /* carries passed over without clocking the shifter */
+            if (ue7_skip) {
+                rptr->uf4_counter = (rptr->uf4_counter + ue7_skip) & 0xf;
+                rptr->ue7_counter -= ue7_skip * (16 - rptr->ue7_dcba);
+            }
+
             /* divide the reference clock with UE7 */
             rptr->ue7_counter += todo;
             if (rptr->ue7_counter == 16) {
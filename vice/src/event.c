@@ -72,6 +72,7 @@ struct event_image_list_s {
 typedef struct event_image_list_s event_image_list_t;
 
 static event_list_state_t *event_list = NULL;
+static event_list_state_t *input_list = NULL;
 static event_image_list_t *event_image_list_base = NULL;
 static int image_number;
 
@@ -95,6 +96,57 @@ static char *event_snapshot_path_str = NULL;
 static int event_start_mode;
 static int event_image_include;
 
+/* Keyframes are snapshots of the machine, stored as EVENT_KEYFRAME events
+   every `event_keyframe_interval' seconds of a recording, that let the
+   playback seek without running from the start.  To keep the history
+   small, a keyframe is stored as the difference to the one before.  The
+   event data is:
+
+   0      flags, KEYFRAME_DELTA if the previous keyframe is the base
+   1-3    unused
+   4-7    size of the snapshot, little endian
+   8-11   number of frame hashes recorded before the keyframe
+   12-    runs of <unchanged byte count> <changed byte count> <changed
+          bytes XORed with the base>, the counts as 7-bit varints
+
+   The previous keyframe, unpacked, is kept while recording.  */
+#define KEYFRAME_DELTA          0x01
+#define KEYFRAME_HEADER_SIZE    12
+
+static int event_keyframe_interval;
+static uint8_t *keyframe_prev = NULL;
+static size_t keyframe_prev_size = 0;
+
+/* Snapshots for keyframes and frame hashes are written to this buffer,
+   which is kept between frames.  */
+static snapshot_memory_t *event_snapshot_mem = NULL;
+
+/* With `event_frame_hash', the CRC32 of each snapshot module (CPU, RAM,
+   VIC-II, CIAs, SID, drives...) is taken at the end of every frame of a
+   recording.  `frame_hash_table' holds one record per frame, the number
+   of modules followed by their CRCs, and is saved as the EVENTHASH
+   snapshot module next to the event list.  Playback compares the frames
+   in order and stops at the first one that differs; `frame_hash_pos' is
+   the offset of the next record to compare, `frame_hash_frame' its frame
+   number.  */
+static int event_frame_hash;
+static unsigned int frame_hash_count = 0;
+static unsigned int frame_hash_max = 0;
+static uint32_t *frame_hash_crc = NULL;
+static char (*frame_hash_name)[SNAPSHOT_MODULE_NAME_LEN + 1] = NULL;
+static uint32_t *frame_hash_table = NULL;
+static unsigned int frame_hash_table_len = 0;
+static unsigned int frame_hash_table_size = 0;
+static unsigned int frame_hash_frames = 0;
+static unsigned int frame_hash_pos = 0;
+static unsigned int frame_hash_frame = 0;
+
+/* Warp until `seek_target' seconds of playback.  */
+static int seek_active = 0;
+static int seek_warp;
+static unsigned int seek_target;
+static int seek_on_start = -1;
+
 static char *event_snapshot_path(const char *snapshot_file)
 {
     lib_free(event_snapshot_path_str);
@@ -281,17 +333,11 @@ error:
 }
 
 
-void event_record_in_list(event_list_state_t *list, unsigned int type,
-                          void *data, unsigned int size)
+static void event_append_to_list(event_list_state_t *list, unsigned int type,
+                                 void *data, unsigned int size)
 {
     void *event_data = NULL;
 
-    /*log_debug("EVENT RECORD %i CLK %i", type, maincpu_clk);*/
-
-    if (type == EVENT_RESETCPU) {
-        next_timestamp_clk -= maincpu_clk;
-    }
-
     switch (type) {
         case EVENT_RESETCPU:            /* fall through */
         case EVENT_KEYBOARD_MATRIX:     /* fall through */
@@ -304,6 +350,7 @@ void event_record_in_list(event_list_state_t *list, unsigned int type,
         case EVENT_ATTACHIMAGE:         /* fall through */
         case EVENT_INITIAL:             /* fall through */
         case EVENT_SYNC_TEST:           /* fall through */
+        case EVENT_KEYFRAME:            /* fall through */
         case EVENT_RESOURCE:
             event_data = lib_malloc(size);
             memcpy(event_data, data, size);
@@ -326,13 +373,400 @@ void event_record_in_list(event_list_state_t *list, unsigned int type,
     list->current->type = EVENT_LIST_END;
 }
 
+void event_record_in_list(event_list_state_t *list, unsigned int type,
+                          void *data, unsigned int size)
+{
+    /*log_debug("EVENT RECORD %i CLK %i", type, maincpu_clk);*/
+
+    if (type == EVENT_RESETCPU) {
+        next_timestamp_clk -= maincpu_clk;
+    }
+
+    event_append_to_list(list, type, data, size);
+}
+
 void event_record(unsigned int type, void *data, unsigned int size)
 {
     if (record_active == 1) {
         event_record_in_list(event_list, type, data, size);
     }
+
+    if (input_list != NULL) {
+        switch (type) {
+            case EVENT_KEYBOARD_MATRIX:
+            case EVENT_KEYBOARD_RESTORE:
+            case EVENT_JOYSTICK_VALUE:
+            case EVENT_DATASETTE:
+            case EVENT_RESETCPU:
+                event_append_to_list(input_list, type, data, size);
+                break;
+        }
+    }
 }
 
+/* While set, the host input is also recorded into `list', independent of
+   the event history.  Used by reverse execution in the monitor.  */
+void event_record_input_list(event_list_state_t *list)
+{
+    input_list = list;
+}
+
+/* Play back an event from the list given to event_record_input_list().  */
+void event_playback_input(event_list_t *event)
+{
+    switch (event->type) {
+        case EVENT_KEYBOARD_MATRIX:
+            keyboard_event_playback(0, event->data);
+            break;
+        case EVENT_KEYBOARD_RESTORE:
+            keyboard_restore_event_playback(0, event->data);
+            break;
+        case EVENT_JOYSTICK_VALUE:
+            joystick_event_playback(0, event->data);
+            break;
+        case EVENT_DATASETTE:
+            datasette_event_playback(0, event->data);
+            break;
+        case EVENT_RESETCPU:
+            machine_reset_event_playback(0, event->data);
+            break;
+    }
+}
+
+
+/*-----------------------------------------------------------------------*/
+
+static uint8_t *keyframe_put_count(uint8_t *p, size_t count)
+{
+    while (count >= 0x80) {
+        *p++ = (uint8_t)(count | 0x80);
+        count >>= 7;
+    }
+    *p++ = (uint8_t)count;
+    return p;
+}
+
+static const uint8_t *keyframe_get_count(const uint8_t *p, const uint8_t *end, size_t *count)
+{
+    unsigned int shift = 0;
+
+    *count = 0;
+    while (p < end) {
+        *count |= (size_t)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80)) {
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+static uint8_t keyframe_base(const uint8_t *base, size_t base_size, size_t i)
+{
+    return (i < base_size) ? base[i] : 0;
+}
+
+/* Pack `snap' as the difference to `base' (which may be NULL).  */
+static uint8_t *keyframe_pack(const uint8_t *snap, size_t size,
+                              const uint8_t *base, size_t base_size,
+                              unsigned int *packed_size)
+{
+    uint8_t *data, *p;
+    size_t i, start, run;
+
+    /* worst case: one varint pair per changed byte run */
+    data = lib_malloc(KEYFRAME_HEADER_SIZE + size + (size / 2 + 1) * 6);
+    data[0] = (base != NULL) ? KEYFRAME_DELTA : 0;
+    data[1] = data[2] = data[3] = 0;
+    util_dword_to_le_buf(&data[4], (uint32_t)size);
+    util_dword_to_le_buf(&data[8], (uint32_t)frame_hash_frames);
+    p = &data[KEYFRAME_HEADER_SIZE];
+
+    i = 0;
+    while (i < size) {
+        start = i;
+        while (i < size && snap[i] == keyframe_base(base, base_size, i)) {
+            i++;
+        }
+        p = keyframe_put_count(p, i - start);
+
+        start = i;
+        run = 0;
+        /* stop the changed run at the first 4 unchanged bytes */
+        while (i < size && run < 4) {
+            run = (snap[i] == keyframe_base(base, base_size, i)) ? run + 1 : 0;
+            i++;
+        }
+        if (run > 0 && i - run >= start) {
+            i -= run;
+        }
+        p = keyframe_put_count(p, i - start);
+        for (; start < i; start++) {
+            *p++ = snap[start] ^ keyframe_base(base, base_size, start);
+        }
+    }
+
+    *packed_size = (unsigned int)(p - data);
+    return lib_realloc(data, *packed_size);
+}
+
+/* Unpack a keyframe; `base' is the unpacked keyframe before it.  */
+static uint8_t *keyframe_unpack(const uint8_t *data, unsigned int packed_size,
+                                const uint8_t *base, size_t base_size,
+                                size_t *size)
+{
+    const uint8_t *p, *end;
+    uint8_t *snap;
+    size_t i, count;
+
+    if (packed_size < KEYFRAME_HEADER_SIZE) {
+        return NULL;
+    }
+    if (!(data[0] & KEYFRAME_DELTA)) {
+        base = NULL;
+        base_size = 0;
+    } else if (base == NULL) {
+        return NULL;
+    }
+
+    *size = util_le_buf_to_dword((uint8_t *)&data[4]);
+    snap = lib_malloc(*size);
+    p = &data[KEYFRAME_HEADER_SIZE];
+    end = data + packed_size;
+
+    i = 0;
+    while (i < *size) {
+        p = keyframe_get_count(p, end, &count);
+        if (p == NULL || count > *size - i) {
+            break;
+        }
+        for (; count > 0; count--, i++) {
+            snap[i] = keyframe_base(base, base_size, i);
+        }
+
+        p = keyframe_get_count(p, end, &count);
+        if (p == NULL || count > *size - i || count > (size_t)(end - p)) {
+            break;
+        }
+        for (; count > 0; count--, i++) {
+            snap[i] = *p++ ^ keyframe_base(base, base_size, i);
+        }
+    }
+
+    if (i < *size) {
+        lib_free(snap);
+        return NULL;
+    }
+    return snap;
+}
+
+static void keyframe_forget(void)
+{
+    lib_free(keyframe_prev);
+    keyframe_prev = NULL;
+    keyframe_prev_size = 0;
+}
+
+/* Write a snapshot of the machine, without ROMs and the event history,
+   into memory.  */
+static const uint8_t *event_snapshot_to_memory(int save_disks, unsigned int *size)
+{
+    if (event_snapshot_mem == NULL) {
+        event_snapshot_mem = snapshot_memory_create();
+    }
+
+    if (machine_write_snapshot_memory(event_snapshot_mem, 0, save_disks, 0) < 0) {
+        return NULL;
+    }
+
+    return snapshot_memory_get_data(event_snapshot_mem, size);
+}
+
+static void event_record_keyframe_trap(uint16_t addr, void *data)
+{
+    const uint8_t *snap;
+    uint8_t *packed;
+    unsigned int size, packed_size;
+
+    if (record_active == 0) {
+        return;
+    }
+
+    snap = event_snapshot_to_memory(1, &size);
+    if (snap == NULL) {
+        log_error(event_log, "Cannot write keyframe.");
+        return;
+    }
+
+    packed = keyframe_pack(snap, size, keyframe_prev, keyframe_prev_size, &packed_size);
+    event_record(EVENT_KEYFRAME, packed, packed_size);
+    lib_free(packed);
+
+    keyframe_prev = lib_realloc(keyframe_prev, size);
+    memcpy(keyframe_prev, snap, size);
+    keyframe_prev_size = size;
+}
+
+/*-----------------------------------------------------------------------*/
+
+static void frame_hash_module(const char *name, const uint8_t *data,
+                              unsigned int size, void *param)
+{
+    if (frame_hash_count == frame_hash_max) {
+        frame_hash_max = frame_hash_max ? frame_hash_max * 2 : 32;
+        frame_hash_crc = lib_realloc(frame_hash_crc, frame_hash_max * sizeof(uint32_t));
+        frame_hash_name = lib_realloc(frame_hash_name, frame_hash_max * sizeof(*frame_hash_name));
+    }
+
+    strcpy(frame_hash_name[frame_hash_count], name);
+    frame_hash_crc[frame_hash_count] = (uint32_t)crc32_buf((const char *)data, size);
+    frame_hash_count++;
+}
+
+static int frame_hash_compute(void)
+{
+    const uint8_t *snap;
+    unsigned int size;
+
+    frame_hash_count = 0;
+
+    snap = event_snapshot_to_memory(0, &size);
+    if (snap == NULL) {
+        return -1;
+    }
+
+    return snapshot_module_walk(snap, size, frame_hash_module, NULL);
+}
+
+static void frame_hash_table_clear(void)
+{
+    frame_hash_table_len = 0;
+    frame_hash_frames = 0;
+    frame_hash_pos = 0;
+    frame_hash_frame = 0;
+}
+
+static void frame_hash_table_append(void)
+{
+    unsigned int len = frame_hash_table_len + 1 + frame_hash_count;
+
+    if (len > frame_hash_table_size) {
+        while (len > frame_hash_table_size) {
+            frame_hash_table_size = frame_hash_table_size ? frame_hash_table_size * 2 : 0x1000;
+        }
+        frame_hash_table = lib_realloc(frame_hash_table, frame_hash_table_size * sizeof(uint32_t));
+    }
+
+    frame_hash_table[frame_hash_table_len] = frame_hash_count;
+    memcpy(&frame_hash_table[frame_hash_table_len + 1], frame_hash_crc,
+           frame_hash_count * sizeof(uint32_t));
+    frame_hash_table_len = len;
+    frame_hash_frames++;
+}
+
+/* Offset of the record of `frame' in the table.  */
+static unsigned int frame_hash_table_offset(unsigned int frame)
+{
+    unsigned int offset = 0;
+
+    while (frame > 0 && offset < frame_hash_table_len) {
+        offset += 1 + frame_hash_table[offset];
+        frame--;
+    }
+    return (offset < frame_hash_table_len) ? offset : frame_hash_table_len;
+}
+
+/* Make the playback compare from `frame' on.  */
+static void frame_hash_table_seek(unsigned int frame)
+{
+    frame_hash_pos = frame_hash_table_offset(frame);
+    frame_hash_frame = frame;
+}
+
+static void frame_hash_check(void)
+{
+    const uint32_t *rec = &frame_hash_table[frame_hash_pos];
+    unsigned int i, num = rec[0];
+    const char *first = NULL;
+
+    for (i = 0; i < frame_hash_count && i < num; i++) {
+        if (frame_hash_crc[i] != rec[1 + i]) {
+            if (first == NULL) {
+                log_error(event_log, "Playback out of sync at %u seconds, frame %u, clock %u:",
+                          current_timestamp, frame_hash_frame, (unsigned int)maincpu_clk);
+                first = frame_hash_name[i];
+            }
+            log_error(event_log, "  module %s differs.", frame_hash_name[i]);
+        }
+    }
+
+    if (num != frame_hash_count) {
+        log_error(event_log, "Playback out of sync at %u seconds: %u modules, %u recorded.",
+                  current_timestamp, frame_hash_count, num);
+        if (first == NULL) {
+            first = "the module list";
+        }
+    }
+
+    frame_hash_pos += 1 + num;
+    frame_hash_frame++;
+
+    if (first != NULL) {
+        ui_error("Playback out of sync at %u seconds, %s differs.", current_timestamp, first);
+        event_playback_stop();
+    }
+}
+
+static void event_frame_hash_trap(uint16_t addr, void *data)
+{
+    if (record_active) {
+        if (event_frame_hash && frame_hash_compute() >= 0) {
+            frame_hash_table_append();
+        }
+        return;
+    }
+
+    if (playback_active == 0 || frame_hash_pos >= frame_hash_table_len) {
+        return;
+    }
+
+    if (frame_hash_compute() >= 0) {
+        frame_hash_check();
+    }
+}
+
+/* Called at the end of every frame.  */
+void event_vsync_hook(void)
+{
+    if ((record_active && event_frame_hash)
+        || (playback_active && frame_hash_pos < frame_hash_table_len)) {
+        interrupt_maincpu_trigger_trap(event_frame_hash_trap, (void *)0);
+    }
+}
+
+/* CRC32 over all snapshot modules, for the netplay sync test; 0 if frame
+   hashes are disabled.  */
+uint32_t event_state_hash(void)
+{
+    uint8_t *buf;
+    uint32_t crc;
+    unsigned int i;
+
+    if (event_frame_hash == 0 || frame_hash_compute() <= 0) {
+        return 0;
+    }
+
+    buf = lib_malloc(frame_hash_count * 4);
+    for (i = 0; i < frame_hash_count; i++) {
+        util_dword_to_le_buf(&buf[i * 4], frame_hash_crc[i]);
+    }
+    crc = (uint32_t)crc32_buf((const char *)buf, frame_hash_count * 4);
+    lib_free(buf);
+
+    return crc;
+}
+
+/*-----------------------------------------------------------------------*/
 
 static void next_alarm_set(void)
 {
@@ -362,6 +796,10 @@ static void event_alarm_handler(CLOCK offset, void *data)
         ui_display_event_time(current_timestamp++, 0);
         next_timestamp_clk = next_timestamp_clk + machine_get_cycles_per_second();
         alarm_set(event_alarm, next_timestamp_clk);
+        if (event_keyframe_interval > 0
+            && current_timestamp % event_keyframe_interval == 0) {
+            interrupt_maincpu_trigger_trap(event_record_keyframe_trap, (void *)0);
+        }
         return;
     }
 
@@ -407,11 +845,16 @@ static void event_alarm_handler(CLOCK offset, void *data)
             break;
         case EVENT_TIMESTAMP:
             ui_display_event_time(current_timestamp++, playback_time);
+            if (seek_active && current_timestamp >= seek_target) {
+                seek_active = 0;
+                resources_set_int("WarpMode", seek_warp);
+            }
             break;
         case EVENT_LIST_END:
             event_playback_stop();
             break;
         case EVENT_OVERFLOW:
+        case EVENT_KEYFRAME:
             break;
         default:
             log_error(event_log, "Unknow event type %i.", event_list->current->type);
@@ -432,6 +875,7 @@ void event_playback_event_list(event_list_state_t *list)
     while (current->type != EVENT_LIST_END) {
         switch (current->type) {
             case EVENT_SYNC_TEST:
+            case EVENT_KEYFRAME:
                 break;
             case EVENT_KEYBOARD_DELAY:
                 keyboard_register_delay(*(unsigned int*)current->data);
@@ -650,6 +1094,7 @@ static void event_record_start_trap(uint16_t addr, void *data)
             }
             destroy_list();
             create_list();
+            frame_hash_table_clear();
             record_active = 1;
             event_initial_write();
             next_timestamp_clk = maincpu_clk;
@@ -671,6 +1116,7 @@ static void event_record_start_trap(uint16_t addr, void *data)
             machine_trigger_reset(MACHINE_RESET_MODE_HARD);
             destroy_list();
             create_list();
+            frame_hash_table_clear();
             record_active = 1;
             event_initial_write();
             next_timestamp_clk = 0;
@@ -682,6 +1128,8 @@ static void event_record_start_trap(uint16_t addr, void *data)
             event_list->current->type = EVENT_LIST_END;
             event_destroy_image_list();
             event_write_version();
+            frame_hash_table_len = frame_hash_pos;
+            frame_hash_frames = frame_hash_frame;
             record_active = 1;
             next_timestamp_clk = maincpu_clk;
             break;
@@ -701,6 +1149,8 @@ static void event_record_start_trap(uint16_t addr, void *data)
 
 int event_record_start(void)
 {
+    keyframe_forget();
+
     if (event_start_mode == EVENT_START_MODE_PLAYBACK) {
         if (playback_active != 0) {
             event_playback_stop();
@@ -854,6 +1304,7 @@ static void event_playback_start_trap(uint16_t addr, void *data)
         next_alarm_set();
     }
 
+    frame_hash_table_seek(0);
     playback_active = 1;
     current_timestamp = 0;
 
@@ -862,6 +1313,11 @@ static void event_playback_start_trap(uint16_t addr, void *data)
 #ifdef  DEBUG
     debug_start_playback();
 #endif
+
+    if (seek_on_start >= 0) {
+        event_playback_seek((unsigned int)seek_on_start);
+        seek_on_start = -1;
+    }
 }
 
 
@@ -886,6 +1342,11 @@ int event_playback_stop(void)
 
     alarm_unset(event_alarm);
 
+    if (seek_active) {
+        seek_active = 0;
+        resources_set_int("WarpMode", seek_warp);
+    }
+
     ui_display_playback(0, NULL);
 
 #ifdef  DEBUG
@@ -895,6 +1356,143 @@ int event_playback_stop(void)
     return 0;
 }
 
+/* Replay the events from `from' up to `to' that change state the keyframe
+   snapshots do not hold: attached images and resources.  The datasette
+   state is part of the snapshot.  */
+static void event_playback_replay_state(event_list_t *from, event_list_t *to)
+{
+    event_list_t *curr;
+
+    for (curr = from; curr != NULL && curr != to; curr = curr->next) {
+        switch (curr->type) {
+            case EVENT_ATTACHIMAGE:
+                event_playback_attach_image(curr->data, curr->size);
+                break;
+            case EVENT_ATTACHDISK:
+            case EVENT_ATTACHTAPE:
+                {
+                    unsigned int unit;
+                    const char *filename;
+
+                    unit = (unsigned int)((char*)curr->data)[0];
+                    filename = &((char*)curr->data)[1];
+
+                    if (unit == 1) {
+                        tape_image_event_playback(unit, filename);
+                    } else {
+                        file_system_event_playback(unit, filename);
+                    }
+                }
+                break;
+            case EVENT_RESOURCE:
+                resources_set_value_event(curr->data, curr->size);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/* Restore the last keyframe at or before `seek_target' seconds, unless
+   the current position is closer, and warp from there.  */
+static void event_playback_seek_trap(uint16_t addr, void *data)
+{
+    event_list_t *curr, *key = NULL, *kbd = NULL, *joy = NULL, *restore = NULL;
+    event_list_t *key_kbd = NULL, *key_joy = NULL, *key_restore = NULL;
+    uint8_t *snap = NULL, *next;
+    size_t snap_size = 0, next_size;
+    unsigned int seconds = 0, key_seconds = 0;
+
+    if (playback_active == 0) {
+        return;
+    }
+
+    if (event_snapshot_mem == NULL) {
+        event_snapshot_mem = snapshot_memory_create();
+    }
+
+    /* The keyframes can only be unpacked in order.  */
+    curr = event_list->base;
+    while (curr != NULL && curr->type != EVENT_LIST_END && seconds <= seek_target) {
+        if (curr->type == EVENT_TIMESTAMP) {
+            seconds++;
+        } else if (curr->type == EVENT_KEYBOARD_MATRIX) {
+            kbd = curr;
+        } else if (curr->type == EVENT_KEYBOARD_RESTORE) {
+            restore = curr;
+        } else if (curr->type == EVENT_JOYSTICK_VALUE) {
+            joy = curr;
+        } else if (curr->type == EVENT_KEYFRAME) {
+            next = keyframe_unpack(curr->data, curr->size, snap, snap_size, &next_size);
+            if (next == NULL) {
+                log_error(event_log, "Broken keyframe at %u seconds.", seconds);
+                break;
+            }
+            lib_free(snap);
+            snap = next;
+            snap_size = next_size;
+            key = curr;
+            key_seconds = seconds;
+            key_kbd = kbd;
+            key_joy = joy;
+            key_restore = restore;
+        }
+        curr = curr->next;
+    }
+
+    if (key != NULL && (key_seconds > current_timestamp || seek_target < current_timestamp)) {
+        /* Going back, the images and resources are set up again from the
+           start of the history.  */
+        event_playback_replay_state(key_seconds > current_timestamp
+                                    ? event_list->current : event_list->base, key);
+
+        snapshot_memory_set_data(event_snapshot_mem, snap, (unsigned int)snap_size);
+        if (machine_read_snapshot_memory(event_snapshot_mem, 0) < 0) {
+            ui_error("Cannot restore the keyframe at %u seconds.", key_seconds);
+        } else {
+            alarm_unset(event_alarm);
+            event_list->current = key->next;
+            frame_hash_table_seek(util_le_buf_to_dword((uint8_t *)key->data + 8));
+            current_timestamp = key_seconds;
+            if (key_kbd != NULL) {
+                keyboard_event_playback(0, key_kbd->data);
+            }
+            if (key_restore != NULL) {
+                keyboard_restore_event_playback(0, key_restore->data);
+            }
+            if (key_joy != NULL) {
+                joystick_event_playback(0, key_joy->data);
+            }
+            ui_display_event_time(current_timestamp, playback_time);
+            next_alarm_set();
+        }
+    } else if (seek_target < current_timestamp) {
+        /* no keyframe before the target, start over */
+        event_playback_start_trap(addr, data);
+    }
+    lib_free(snap);
+
+    if (playback_active != 0 && seek_target > current_timestamp) {
+        if (!seek_active) {
+            resources_get_int("WarpMode", &seek_warp);
+        }
+        seek_active = 1;
+        resources_set_int("WarpMode", 1);
+    }
+}
+
+int event_playback_seek(unsigned int seconds)
+{
+    if (playback_active == 0) {
+        return -1;
+    }
+
+    seek_target = seconds;
+    interrupt_maincpu_trigger_trap(event_playback_seek_trap, (void *)0);
+
+    return 0;
+}
+
 static void event_record_set_milestone_trap(uint16_t addr, void *data)
 {
     if (machine_write_snapshot(event_snapshot_path(event_end_snapshot), 1, 1, 1) < 0) {
@@ -933,6 +1531,7 @@ static void event_record_reset_milestone_trap(uint16_t addr, void *data)
         return;
     }
     warp_end_list();
+    keyframe_forget();
     record_active = 1;
     if (milestone_timestamp_alarm > 0) {
         alarm_set(event_alarm, milestone_timestamp_alarm);
@@ -974,6 +1573,80 @@ int event_playback_active(void)
 
 /*-----------------------------------------------------------------------*/
 
+static int frame_hash_snapshot_write_module(snapshot_t *s)
+{
+    snapshot_module_t *m;
+
+    if (frame_hash_table_len == 0) {
+        return 0;
+    }
+
+    m = snapshot_module_create(s, "EVENTHASH", 0, 0);
+    if (m == NULL) {
+        return -1;
+    }
+
+    if (SMW_DW(m, (uint32_t)frame_hash_frames) < 0
+        || SMW_DW(m, (uint32_t)frame_hash_table_len) < 0
+        || SMW_DWA(m, frame_hash_table, frame_hash_table_len) < 0) {
+        snapshot_module_close(m);
+        return -1;
+    }
+
+    return snapshot_module_close(m);
+}
+
+static int frame_hash_snapshot_read_module(snapshot_t *s)
+{
+    snapshot_module_t *m;
+    uint8_t major_version, minor_version;
+    unsigned int frames, len, offset, i;
+
+    frame_hash_table_clear();
+
+    m = snapshot_module_open(s, "EVENTHASH", &major_version, &minor_version);
+
+    /* This module is not mandatory.  */
+    if (m == NULL) {
+        return 0;
+    }
+
+    if (SMR_DW_UINT(m, &frames) < 0
+        || SMR_DW_UINT(m, &len) < 0) {
+        snapshot_module_close(m);
+        return -1;
+    }
+
+    if (len > frame_hash_table_size) {
+        frame_hash_table_size = len;
+        frame_hash_table = lib_realloc(frame_hash_table, len * sizeof(uint32_t));
+    }
+
+    if (SMR_DWA(m, frame_hash_table, len) < 0) {
+        snapshot_module_close(m);
+        return -1;
+    }
+    snapshot_module_close(m);
+
+    /* the records must fill the table exactly */
+    offset = 0;
+    for (i = 0; i < frames && offset < len; i++) {
+        if (frame_hash_table[offset] >= len - offset) {
+            break;
+        }
+        offset += 1 + frame_hash_table[offset];
+    }
+    if (i != frames || offset != len) {
+        log_error(event_log, "Broken frame hashes, ignoring them.");
+        return 0;
+    }
+
+    frame_hash_table_len = len;
+    frame_hash_frames = frames;
+
+    return 0;
+}
+
 int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
 {
     snapshot_module_t *m;
@@ -1085,7 +1758,7 @@ int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
 
     snapshot_module_close(m);
 
-    return 0;
+    return frame_hash_snapshot_read_module(s);
 }
 
 int event_snapshot_write_module(struct snapshot_s *s, int event_mode)
@@ -1122,7 +1795,7 @@ int event_snapshot_write_module(struct snapshot_s *s, int event_mode)
         return -1;
     }
 
-    return 0;
+    return frame_hash_snapshot_write_module(s);
 }
 
 /*-----------------------------------------------------------------------*/
@@ -1184,6 +1857,24 @@ static int set_event_image_include(int enable, void *param)
     return 0;
 }
 
+static int set_event_frame_hash(int enable, void *param)
+{
+    event_frame_hash = enable ? 1 : 0;
+
+    return 0;
+}
+
+static int set_event_keyframe_interval(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+
+    event_keyframe_interval = val;
+
+    return 0;
+}
+
 static const resource_string_t resources_string[] = {
     { "EventSnapshotDir",
       FSDEVICE_DEFAULT_DIR FSDEV_DIR_SEP_STR, RES_EVENT_NO, NULL,
@@ -1200,6 +1891,10 @@ static const resource_int_t resources_int[] = {
       &event_start_mode, set_event_start_mode, NULL },
     { "EventImageInclude", 1, RES_EVENT_NO, NULL,
       &event_image_include, set_event_image_include, NULL },
+    { "EventKeyframeInterval", 2, RES_EVENT_NO, NULL,
+      &event_keyframe_interval, set_event_keyframe_interval, NULL },
+    { "EventFrameHash", 0, RES_EVENT_NO, NULL,
+      &event_frame_hash, set_event_frame_hash, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -1220,6 +1915,19 @@ void event_shutdown(void)
     lib_free(event_snapshot_path_str);
     event_snapshot_path_str = NULL;
     destroy_list();
+
+    keyframe_forget();
+    lib_free(frame_hash_crc);
+    frame_hash_crc = NULL;
+    lib_free(frame_hash_name);
+    frame_hash_name = NULL;
+    frame_hash_count = frame_hash_max = 0;
+    lib_free(frame_hash_table);
+    frame_hash_table = NULL;
+    frame_hash_table_size = 0;
+    frame_hash_table_clear();
+    snapshot_memory_destroy(event_snapshot_mem);
+    event_snapshot_mem = NULL;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -1229,6 +1937,22 @@ static int cmdline_help(const char *param, void *extra_param)
     return event_playback_start();
 }
 
+static int cmdline_seek(const char *param, void *extra_param)
+{
+    int val = atoi(param);
+
+    if (val < 0) {
+        return -1;
+    }
+
+    if (event_playback_seek((unsigned int)val) < 0) {
+        /* wait for -playback */
+        seek_on_start = val;
+    }
+
+    return 0;
+}
+
 static const cmdline_option_t cmdline_options[] = {
     { "-playback", CALL_FUNCTION, 0,
       cmdline_help, NULL, NULL, NULL,
@@ -1255,6 +1979,26 @@ static const cmdline_option_t cmdline_options[] = {
       USE_PARAM_ID, USE_DESCRIPTION_ID,
       IDCLS_P_MODE, IDCLS_SET_EVENT_START_MODE,
       NULL, NULL },
+    { "-eventkeyframes", SET_RESOURCE, 1,
+      NULL, NULL, "EventKeyframeInterval", NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      N_("<seconds>"), N_("Store a keyframe for seeking every <seconds> of a recorded event history (0: never)") },
+    { "-eventseek", CALL_FUNCTION, 1,
+      cmdline_seek, NULL, NULL, NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      N_("<seconds>"), N_("Seek to <seconds> when playing back an event history") },
+    { "-eventframehash", SET_RESOURCE, 0,
+      NULL, NULL, "EventFrameHash", (resource_value_t)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, N_("Store a hash of the machine state for every frame of a recorded event history") },
+    { "+eventframehash", SET_RESOURCE, 0,
+      NULL, NULL, "EventFrameHash", (resource_value_t)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, N_("Do not store frame hashes in recorded event histories") },
     { "-eventimageinc", SET_RESOURCE, 0,
       NULL, NULL, "EventImageInclude", (resource_value_t)1,
       USE_PARAM_STRING, USE_DESCRIPTION_ID,
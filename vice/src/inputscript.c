@@ -0,0 +1,828 @@
+/*
+ * inputscript.c - Frame accurate scripted input and assertions.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+
+/*
+ * An input script is a text file with one input change per line:
+
+     <time> <command> [<args>]
+
+ * <time> counts frames since the script was started, or CPU cycles when
+ * it is prefixed with `c'.  The lines are processed in file order, each
+ * one waits until its time is reached.  Empty lines and lines starting
+ * with `#' are ignored.  Commands:
+
+     joy <port> <value>        joystick port 1-5, bits as in the event
+                               history (1 up, 2 down, 4 left, 8 right,
+                               16 fire)
+     key <row> <col> <0|1>     release/press a key of the keyboard matrix
+     restore <0|1>             release/press RESTORE
+     release                   release all keys and joysticks
+     mouse <x> <y>             move the mouse, the pointer starts at 0/0
+     paddles <x> <y>           set the paddle POT values (0-255)
+     exit <code>               quit the emulator with exit code <code>
+
+ * The following commands check the machine state for headless regression
+ * runs.  Failed checks are logged with a diff, and the run goes on:
+
+     screen <file>             compare the screen RAM with <file>
+     memory <addr> <len> <file>
+                               compare <len> bytes of memory at <addr>
+                               with <file>
+     frame <file> [<canvas>]   compare the draw buffer of the last frame,
+                               as palette indices, with <file>; <canvas>
+                               selects the video chip on machines with two
+     wait <addr> <value> <n>   hold the script until <addr> holds <value>,
+                               checked whenever the CPU accesses <addr>;
+                               fails after <n> frames unless <n> is 0
+     finish                    quit with exit code 1 if a check failed,
+                               0 otherwise
+
+ * A script with checks also quits this way when it ends.  Reference files
+ * are raw bytes, relative names are taken from the directory of the
+ * script.  Missing reference files stop the script before it starts,
+ * unless -inputscriptcreate is given; then they are written from the
+ * current state and the check counts as failed.
+ *
+ * Keyboard and joystick changes go through the same functions as event
+ * history playback, so they are recorded when an event history is
+ * recorded at the same time.  Everything is timed in emulated cycles and
+ * works the same in warp mode.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "archdep.h"
+#include "clkguard.h"
+#include "cmdline.h"
+#include "inputscript.h"
+#include "joystick.h"
+#include "keyboard.h"
+#include "lib.h"
+#include "log.h"
+#include "machine-video.h"
+#include "maincpu.h"
+#include "mem.h"
+#include "monitor.h"
+#include "mouse.h"
+#include "screenshot.h"
+#include "translate.h"
+#include "types.h"
+#include "util.h"
+#include "vice-event.h"
+
+#define INPUTSCRIPT_LINE_MAX    256
+
+/* Number of differences logged for one failed check */
+#define INPUTSCRIPT_DIFF_MAX    16
+
+enum {
+    INPUTSCRIPT_JOY,
+    INPUTSCRIPT_KEY,
+    INPUTSCRIPT_RESTORE,
+    INPUTSCRIPT_RELEASE,
+    INPUTSCRIPT_MOUSE,
+    INPUTSCRIPT_PADDLES,
+    INPUTSCRIPT_EXIT,
+    INPUTSCRIPT_SCREEN,
+    INPUTSCRIPT_MEMORY,
+    INPUTSCRIPT_FRAME,
+    INPUTSCRIPT_WAIT,
+    INPUTSCRIPT_FINISH
+};
+
+typedef struct inputscript_command_s {
+    const char *name;
+    int command;
+    /* one character per argument: `n' number, `f' file name, `o' optional
+       number, defaults to its minimum */
+    const char *args;
+    long min[3];
+    long max[3];
+} inputscript_command_t;
+
+static const inputscript_command_t inputscript_commands[] = {
+    { "joy", INPUTSCRIPT_JOY, "nn",
+      { 1, 0, 0 }, { JOYSTICK_NUM, 255, 0 } },
+    { "key", INPUTSCRIPT_KEY, "nnn",
+      { 0, 0, 0 }, { KBD_ROWS - 1, KBD_COLS - 1, 1 } },
+    { "restore", INPUTSCRIPT_RESTORE, "n",
+      { 0, 0, 0 }, { 1, 0, 0 } },
+    { "release", INPUTSCRIPT_RELEASE, "",
+      { 0, 0, 0 }, { 0, 0, 0 } },
+    { "mouse", INPUTSCRIPT_MOUSE, "nn",
+      { -32768, -32768, 0 }, { 32767, 32767, 0 } },
+    { "paddles", INPUTSCRIPT_PADDLES, "nn",
+      { 0, 0, 0 }, { 255, 255, 0 } },
+    { "exit", INPUTSCRIPT_EXIT, "n",
+      { 0, 0, 0 }, { 255, 0, 0 } },
+    { "screen", INPUTSCRIPT_SCREEN, "f",
+      { 0, 0, 0 }, { 0, 0, 0 } },
+    { "memory", INPUTSCRIPT_MEMORY, "nnf",
+      { 0, 1, 0 }, { 0xffff, 0x10000, 0 } },
+    { "frame", INPUTSCRIPT_FRAME, "fo",
+      { 0, 0, 0 }, { 0, 1, 0 } },
+    { "wait", INPUTSCRIPT_WAIT, "nnn",
+      { 0, 0, 0 }, { 0xffff, 255, 0x7fffffff } },
+    { "finish", INPUTSCRIPT_FINISH, "",
+      { 0, 0, 0 }, { 0, 0, 0 } },
+    { NULL, 0, NULL, { 0, 0, 0 }, { 0, 0, 0 } }
+};
+
+typedef struct inputscript_entry_s {
+    /* nonzero if `time' counts cycles instead of frames */
+    int cycles;
+    CLOCK time;
+    int command;
+    int arg[3];
+    /* reference file of a check, NULL for input changes */
+    char *filename;
+} inputscript_entry_t;
+
+static log_t inputscript_log = LOG_ERR;
+
+static alarm_t *inputscript_alarm = NULL;
+
+static char *inputscript_name = NULL;
+static inputscript_entry_t *inputscript_entries = NULL;
+static unsigned int inputscript_num_entries = 0;
+static unsigned int inputscript_cursor = 0;
+
+/* Set at the first frame after loading, times count from there */
+static int inputscript_started = 0;
+static CLOCK inputscript_start_clk = 0;
+static CLOCK inputscript_frame = 0;
+
+/* Frame at which the pending `wait' started, -1 if none is pending */
+static long inputscript_wait_start = -1;
+
+/* Set when the address of the pending `wait' was accessed */
+static int inputscript_wait_accessed = 0;
+
+/* Set while the script itself reads the address, the peek goes through
+   the same memory tables */
+static int inputscript_wait_peeking = 0;
+
+/* Write missing reference files instead of stopping */
+static int inputscript_create = 0;
+
+/* Number of checks done and failed */
+static unsigned int inputscript_checks = 0;
+static unsigned int inputscript_failures = 0;
+
+/* Input state fed to the keyboard and joystick event playback */
+static int inputscript_keyarr[KBD_ROWS];
+static uint8_t inputscript_joystick[JOYSTICK_NUM + 1];
+
+/* ------------------------------------------------------------------------- */
+
+static const inputscript_command_t *inputscript_find_command(const char *name)
+{
+    const inputscript_command_t *cmd;
+
+    for (cmd = inputscript_commands; cmd->name != NULL; cmd++) {
+        if (strcmp(cmd->name, name) == 0) {
+            return cmd;
+        }
+    }
+    return NULL;
+}
+
+static int inputscript_parse_number(const char *s, long min, long max,
+                                    long *value)
+{
+    char *end;
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    *value = strtol(s, &end, 0);
+    if (end == s || *end != '\0' || *value < min || *value > max) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Returns 1 for empty lines and comments, -1 on errors.  */
+static int inputscript_parse_line(char *line, const char *dir,
+                                  inputscript_entry_t *entry)
+{
+    const inputscript_command_t *cmd;
+    char *token;
+    char *end;
+    unsigned long time;
+    long value;
+    int i;
+
+    token = strtok(line, " \t");
+    if (token == NULL || *token == '#') {
+        return 1;
+    }
+
+    entry->cycles = (*token == 'c' || *token == 'C');
+    if (entry->cycles) {
+        token++;
+    }
+    time = strtoul(token, &end, 0);
+    if (end == token || *end != '\0') {
+        return -1;
+    }
+    entry->time = (CLOCK)time;
+
+    token = strtok(NULL, " \t");
+    if (token == NULL) {
+        return -1;
+    }
+    cmd = inputscript_find_command(token);
+    if (cmd == NULL) {
+        return -1;
+    }
+    entry->command = cmd->command;
+
+    for (i = 0; i < 3; i++) {
+        entry->arg[i] = 0;
+    }
+    entry->filename = NULL;
+    for (i = 0; cmd->args[i] != '\0'; i++) {
+        token = strtok(NULL, " \t");
+        if (cmd->args[i] == 'f') {
+            if (token == NULL) {
+                return -1;
+            }
+            if (dir != NULL && archdep_path_is_relative(token)) {
+                entry->filename = util_concat(dir, FSDEV_DIR_SEP_STR, token,
+                                              NULL);
+            } else {
+                entry->filename = lib_stralloc(token);
+            }
+        } else if (cmd->args[i] == 'o' && token == NULL) {
+            entry->arg[i] = (int)cmd->min[i];
+            break;
+        } else {
+            if (inputscript_parse_number(token, cmd->min[i], cmd->max[i],
+                                         &value) < 0) {
+                lib_free(entry->filename);
+                return -1;
+            }
+            entry->arg[i] = (int)value;
+        }
+    }
+
+    if (strtok(NULL, " \t") != NULL) {
+        lib_free(entry->filename);
+        return -1;
+    }
+    return 0;
+}
+
+static void inputscript_free_entries(inputscript_entry_t *entries,
+                                     unsigned int num_entries)
+{
+    unsigned int i;
+
+    for (i = 0; i < num_entries; i++) {
+        lib_free(entries[i].filename);
+    }
+    lib_free(entries);
+}
+
+static void inputscript_free(void)
+{
+    if (inputscript_alarm != NULL) {
+        alarm_unset(inputscript_alarm);
+    }
+    if (inputscript_wait_start >= 0) {
+        monitor_watch_access(-1, NULL);
+        inputscript_wait_start = -1;
+    }
+
+    inputscript_free_entries(inputscript_entries, inputscript_num_entries);
+    inputscript_entries = NULL;
+    inputscript_num_entries = 0;
+    inputscript_cursor = 0;
+    lib_free(inputscript_name);
+    inputscript_name = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint8_t *inputscript_load_reference(const char *filename, size_t *size)
+{
+    FILE *fd;
+    uint8_t *data;
+
+    fd = fopen(filename, MODE_READ);
+    if (fd == NULL) {
+        return NULL;
+    }
+
+    *size = util_file_length(fd);
+    data = lib_malloc(*size + 1);
+    if (fread(data, 1, *size, fd) != *size) {
+        lib_free(data);
+        data = NULL;
+    }
+    fclose(fd);
+
+    return data;
+}
+
+/* Compare `actual' with the reference file of `entry'.  Differences are
+   logged as x/y positions in rows of `width' bytes, or as addresses if
+   `width' is 0.  */
+static void inputscript_check(const inputscript_entry_t *entry,
+                              const char *what, uint8_t *actual,
+                              size_t size, unsigned int width)
+{
+    uint8_t *expected;
+    size_t expected_size, i;
+    unsigned int diffs = 0;
+
+    inputscript_checks++;
+
+    expected = inputscript_load_reference(entry->filename, &expected_size);
+    if (expected == NULL) {
+        if (!inputscript_create) {
+            log_error(inputscript_log, "Frame %u, %s: cannot read `%s'.",
+                      (unsigned int)inputscript_frame, what, entry->filename);
+        } else if (util_file_save(entry->filename, actual, (int)size) < 0) {
+            log_error(inputscript_log, "Frame %u, %s: cannot write `%s'.",
+                      (unsigned int)inputscript_frame, what, entry->filename);
+        } else {
+            log_error(inputscript_log,
+                      "Frame %u, %s: no reference, created `%s'.",
+                      (unsigned int)inputscript_frame, what, entry->filename);
+        }
+        inputscript_failures++;
+        return;
+    }
+
+    if (expected_size != size) {
+        log_error(inputscript_log,
+                  "Frame %u, %s: `%s' has %lu bytes instead of %lu.",
+                  (unsigned int)inputscript_frame, what, entry->filename,
+                  (unsigned long)expected_size, (unsigned long)size);
+        lib_free(expected);
+        inputscript_failures++;
+        return;
+    }
+
+    for (i = 0; i < size; i++) {
+        if (expected[i] == actual[i]) {
+            continue;
+        }
+        if (diffs < INPUTSCRIPT_DIFF_MAX) {
+            if (width > 0) {
+                log_error(inputscript_log,
+                          "Frame %u, %s: x %u y %u is $%02x, expected $%02x.",
+                          (unsigned int)inputscript_frame, what,
+                          (unsigned int)(i % width), (unsigned int)(i / width),
+                          actual[i], expected[i]);
+            } else {
+                log_error(inputscript_log,
+                          "Frame %u, %s: $%04x is $%02x, expected $%02x.",
+                          (unsigned int)inputscript_frame, what,
+                          (unsigned int)((entry->arg[0] + i) & 0xffff),
+                          actual[i], expected[i]);
+            }
+        }
+        diffs++;
+    }
+    lib_free(expected);
+
+    if (diffs > 0) {
+        log_error(inputscript_log,
+                  "Frame %u, %s: %u of %lu bytes differ from `%s'.",
+                  (unsigned int)inputscript_frame, what, diffs,
+                  (unsigned long)size, entry->filename);
+        inputscript_failures++;
+    } else {
+        log_message(inputscript_log, "Frame %u, %s: matches `%s'.",
+                    (unsigned int)inputscript_frame, what, entry->filename);
+    }
+}
+
+static void inputscript_check_screen(const inputscript_entry_t *entry)
+{
+    uint16_t base;
+    uint8_t rows, cols;
+    int bank;
+    uint8_t *data;
+    unsigned int i;
+
+    mem_get_screen_parameter(&base, &rows, &cols, &bank);
+
+    data = lib_malloc(rows * cols + 1);
+    for (i = 0; i < (unsigned int)(rows * cols); i++) {
+        data[i] = mem_bank_peek(bank, (uint16_t)(base + i), NULL);
+    }
+    inputscript_check(entry, "screen", data, rows * cols, cols);
+    lib_free(data);
+}
+
+static void inputscript_check_memory(const inputscript_entry_t *entry)
+{
+    uint8_t *data;
+    size_t size = (size_t)entry->arg[1], i;
+
+    data = lib_malloc(size + 1);
+    for (i = 0; i < size; i++) {
+        data[i] = mem_bank_peek(0, (uint16_t)(entry->arg[0] + i), NULL);
+    }
+    inputscript_check(entry, "memory", data, size, 0);
+    lib_free(data);
+}
+
+/* The draw buffer is filled by the video chip emulation for every frame,
+   also the ones skipped by the video renderer.  */
+static void inputscript_check_frame(const inputscript_entry_t *entry)
+{
+    struct video_canvas_s *canvas;
+    uint8_t *data = NULL;
+    unsigned int width, height;
+
+    canvas = machine_video_canvas_get((unsigned int)entry->arg[1]);
+    if (canvas != NULL) {
+        data = screenshot_get_indexed(canvas, &width, &height);
+    }
+    if (data == NULL) {
+        log_error(inputscript_log, "Frame %u, frame: no draw buffer for canvas %d.",
+                  (unsigned int)inputscript_frame, entry->arg[1]);
+        inputscript_checks++;
+        inputscript_failures++;
+        return;
+    }
+    inputscript_check(entry, "frame", data, width * height, width);
+    lib_free(data);
+}
+
+static void inputscript_finish(void)
+{
+    if (inputscript_failures > 0) {
+        log_error(inputscript_log, "%u of %u checks failed.",
+                  inputscript_failures, inputscript_checks);
+    } else {
+        log_message(inputscript_log, "All %u checks passed.",
+                    inputscript_checks);
+    }
+}
+
+static void inputscript_apply(const inputscript_entry_t *entry, CLOCK offset)
+{
+    uint32_t restore;
+
+    switch (entry->command) {
+        case INPUTSCRIPT_JOY:
+            inputscript_joystick[entry->arg[0]] = (uint8_t)entry->arg[1];
+            joystick_event_playback(offset, inputscript_joystick);
+            event_record(EVENT_JOYSTICK_VALUE, (void *)joystick_value,
+                         sizeof(joystick_value));
+            break;
+        case INPUTSCRIPT_KEY:
+            if (entry->arg[2]) {
+                inputscript_keyarr[entry->arg[0]] |= 1 << entry->arg[1];
+            } else {
+                inputscript_keyarr[entry->arg[0]] &= ~(1 << entry->arg[1]);
+            }
+            keyboard_event_playback(offset, inputscript_keyarr);
+            event_record(EVENT_KEYBOARD_MATRIX, (void *)keyarr, sizeof(keyarr));
+            break;
+        case INPUTSCRIPT_RESTORE:
+            restore = (uint32_t)entry->arg[0];
+            keyboard_restore_event_playback(offset, &restore);
+            event_record(EVENT_KEYBOARD_RESTORE, (void *)&restore,
+                         sizeof(uint32_t));
+            break;
+        case INPUTSCRIPT_RELEASE:
+            memset(inputscript_keyarr, 0, sizeof(inputscript_keyarr));
+            memset(inputscript_joystick, 0, sizeof(inputscript_joystick));
+            keyboard_event_playback(offset, inputscript_keyarr);
+            event_record(EVENT_KEYBOARD_MATRIX, (void *)keyarr, sizeof(keyarr));
+            joystick_event_playback(offset, inputscript_joystick);
+            event_record(EVENT_JOYSTICK_VALUE, (void *)joystick_value,
+                         sizeof(joystick_value));
+            break;
+        case INPUTSCRIPT_MOUSE:
+            mouse_script_set_position(entry->arg[0], entry->arg[1]);
+            break;
+        case INPUTSCRIPT_PADDLES:
+            mouse_script_set_paddles((uint8_t)entry->arg[0],
+                                     (uint8_t)entry->arg[1]);
+            break;
+        case INPUTSCRIPT_EXIT:
+            log_message(inputscript_log, "Exit with code %d.", entry->arg[0]);
+            exit(entry->arg[0]);
+            break;
+        case INPUTSCRIPT_SCREEN:
+            inputscript_check_screen(entry);
+            break;
+        case INPUTSCRIPT_MEMORY:
+            inputscript_check_memory(entry);
+            break;
+        case INPUTSCRIPT_FRAME:
+            inputscript_check_frame(entry);
+            break;
+        case INPUTSCRIPT_FINISH:
+            inputscript_finish();
+            exit(inputscript_failures > 0 ? 1 : 0);
+            break;
+    }
+}
+
+/* Called by the monitor before the CPU accesses the address of the pending
+   `wait'.  The value is checked after the instruction.  */
+static void inputscript_wait_access(void)
+{
+    if (inputscript_wait_peeking) {
+        return;
+    }
+    inputscript_wait_accessed = 1;
+    alarm_set(inputscript_alarm, maincpu_clk);
+}
+
+static void inputscript_wait_end(void)
+{
+    monitor_watch_access(-1, NULL);
+    inputscript_wait_start = -1;
+}
+
+/* Check the condition of a `wait', returns nonzero when the script can go
+   on.  The memory is only looked at when the wait starts and after the CPU
+   accessed the address.  */
+static int inputscript_wait_done(const inputscript_entry_t *entry)
+{
+    uint16_t addr = (uint16_t)entry->arg[0];
+    uint8_t value;
+
+    if (inputscript_wait_start < 0 || inputscript_wait_accessed) {
+        inputscript_wait_accessed = 0;
+        inputscript_wait_peeking = 1;
+        value = mem_bank_peek(0, addr, NULL);
+        inputscript_wait_peeking = 0;
+        if (value == entry->arg[1]) {
+            log_message(inputscript_log, "Frame %u, wait: $%04x is $%02x.",
+                        (unsigned int)inputscript_frame, addr, entry->arg[1]);
+            inputscript_checks++;
+            if (inputscript_wait_start >= 0) {
+                inputscript_wait_end();
+            }
+            return 1;
+        }
+    }
+
+    if (inputscript_wait_start < 0) {
+        inputscript_wait_start = (long)inputscript_frame;
+        monitor_watch_access(addr, inputscript_wait_access);
+    } else if (entry->arg[2] > 0
+               && (long)inputscript_frame - inputscript_wait_start >= entry->arg[2]) {
+        log_error(inputscript_log,
+                  "Frame %u, wait: $%04x did not become $%02x within %d frames.",
+                  (unsigned int)inputscript_frame, addr, entry->arg[1],
+                  entry->arg[2]);
+        inputscript_checks++;
+        inputscript_failures++;
+        inputscript_wait_end();
+        return 1;
+    }
+    return 0;
+}
+
+/* Apply all entries whose time has come and wait for the next one.  */
+static void inputscript_run(CLOCK offset)
+{
+    const inputscript_entry_t *entry;
+
+    while (inputscript_cursor < inputscript_num_entries) {
+        entry = &inputscript_entries[inputscript_cursor];
+
+        if (entry->cycles) {
+            if (maincpu_clk - inputscript_start_clk < entry->time) {
+                alarm_set(inputscript_alarm,
+                          inputscript_start_clk + entry->time);
+                return;
+            }
+        } else if (inputscript_frame < entry->time) {
+            /* inputscript_vsync_hook() checks again */
+            return;
+        }
+
+        if (entry->command == INPUTSCRIPT_WAIT && !inputscript_wait_done(entry)) {
+            return;
+        }
+
+        inputscript_cursor++;
+        inputscript_apply(entry, offset);
+    }
+
+    log_message(inputscript_log, "`%s' finished after %u frames.",
+                inputscript_name, (unsigned int)inputscript_frame);
+    if (inputscript_checks > 0) {
+        inputscript_finish();
+        exit(inputscript_failures > 0 ? 1 : 0);
+    }
+    inputscript_free();
+}
+
+static void inputscript_alarm_triggered(CLOCK offset, void *data)
+{
+    alarm_unset(inputscript_alarm);
+
+    inputscript_run(offset);
+}
+
+/* Returns the number of reference files that are missing.  */
+static unsigned int inputscript_check_references(void)
+{
+    unsigned int i, missing = 0;
+    const char *filename;
+
+    for (i = 0; i < inputscript_num_entries; i++) {
+        filename = inputscript_entries[i].filename;
+        if (filename != NULL && !util_file_exists(filename)) {
+            log_error(inputscript_log, "Reference file `%s' is missing.",
+                      filename);
+            missing++;
+        }
+    }
+    return missing;
+}
+
+/* Called once per frame from vsync_do_vsync().  */
+void inputscript_vsync_hook(void)
+{
+    if (inputscript_entries == NULL || inputscript_alarm == NULL) {
+        return;
+    }
+
+    if (!inputscript_started) {
+        if (!inputscript_create && inputscript_check_references() > 0) {
+            log_error(inputscript_log,
+                      "`%s' not started, use -inputscriptcreate to write the missing references.",
+                      inputscript_name);
+            exit(1);
+        }
+        inputscript_started = 1;
+        inputscript_start_clk = maincpu_clk;
+        inputscript_frame = 0;
+    } else {
+        inputscript_frame++;
+    }
+
+    inputscript_run(0);
+}
+
+static void clk_overflow_callback(CLOCK sub, void *data)
+{
+    inputscript_start_clk -= sub;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int inputscript_load(const char *filename)
+{
+    FILE *fd;
+    char buf[INPUTSCRIPT_LINE_MAX];
+    inputscript_entry_t entry;
+    inputscript_entry_t *entries = NULL;
+    unsigned int num_entries = 0, max_entries = 0;
+    char *dir;
+    int line = 0, retval;
+
+    fd = fopen(filename, MODE_READ_TEXT);
+    if (fd == NULL) {
+        log_error(inputscript_log, "Cannot open `%s'.", filename);
+        return -1;
+    }
+
+    util_fname_split(filename, &dir, NULL);
+
+    while (util_get_line(buf, sizeof(buf), fd) >= 0) {
+        line++;
+        retval = inputscript_parse_line(buf, dir, &entry);
+        if (retval < 0) {
+            log_error(inputscript_log, "%s:%d: Invalid input script line.",
+                      filename, line);
+            inputscript_free_entries(entries, num_entries);
+            lib_free(dir);
+            fclose(fd);
+            return -1;
+        }
+        if (retval > 0) {
+            continue;
+        }
+        if (num_entries == max_entries) {
+            max_entries = max_entries ? max_entries * 2 : 256;
+            entries = lib_realloc(entries,
+                                  max_entries * sizeof(inputscript_entry_t));
+        }
+        entries[num_entries++] = entry;
+    }
+    lib_free(dir);
+    fclose(fd);
+
+    inputscript_stop();
+
+    inputscript_name = lib_stralloc(filename);
+    inputscript_entries = entries;
+    inputscript_num_entries = num_entries;
+    inputscript_cursor = 0;
+    inputscript_started = 0;
+    inputscript_wait_start = -1;
+    inputscript_checks = 0;
+    inputscript_failures = 0;
+    memset(inputscript_keyarr, 0, sizeof(inputscript_keyarr));
+    memset(inputscript_joystick, 0, sizeof(inputscript_joystick));
+
+    log_message(inputscript_log, "Loaded %u entries from `%s'.",
+                num_entries, filename);
+    return 0;
+}
+
+void inputscript_stop(void)
+{
+    if (inputscript_entries == NULL) {
+        return;
+    }
+
+    inputscript_free();
+    mouse_script_release();
+}
+
+int inputscript_active(void)
+{
+    return inputscript_entries != NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_inputscript(const char *param, void *extra_param)
+{
+    return inputscript_load(param);
+}
+
+static int cmdline_inputscript_create(const char *param, void *extra_param)
+{
+    inputscript_create = 1;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-inputscript", CALL_FUNCTION, 1,
+      cmdline_inputscript, NULL, NULL, NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      N_("<Name>"), N_("Play back the input script <Name> from the first frame on") },
+    { "-inputscriptcreate", CALL_FUNCTION, 0,
+      cmdline_inputscript_create, NULL, NULL, NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, N_("Write missing reference files of the input script instead of stopping") },
+    CMDLINE_LIST_END
+};
+
+int inputscript_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void inputscript_init(void)
+{
+    inputscript_log = log_open("InputScript");
+
+    inputscript_alarm = alarm_new(maincpu_alarm_context, "InputScript",
+                                  inputscript_alarm_triggered, NULL);
+
+    clk_guard_add_callback(maincpu_clk_guard, clk_overflow_callback, NULL);
+}
+
+void inputscript_shutdown(void)
+{
+    inputscript_free();
+}
@@ -0,0 +1,39 @@
+/*
+ * inputscript.h - Frame accurate scripted input and assertions.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+
+#ifndef VICE_INPUTSCRIPT_H
+#define VICE_INPUTSCRIPT_H
+
+extern int inputscript_cmdline_options_init(void);
+
+extern void inputscript_init(void);
+extern void inputscript_shutdown(void);
+
+extern int inputscript_load(const char *filename);
+extern void inputscript_stop(void);
+extern int inputscript_active(void);
+
+extern void inputscript_vsync_hook(void);
+
+#endif
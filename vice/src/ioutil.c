@@ -193,6 +193,22 @@ int ioutil_stat(const char *file_name, unsigned int *len, unsigned int *isdir)
     return archdep_stat(file_name, len, isdir);
 }
 
+/* Modification time of a file, -1 if it cannot be determined.  */
+int ioutil_mtime(const char *file_name, unsigned long *mtime)
+{
+#ifdef HAVE_SYS_STAT_H
+    struct stat statbuf;
+
+    if (stat(file_name, &statbuf) < 0) {
+        return -1;
+    }
+    *mtime = (unsigned long)statbuf.st_mtime;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
 /* ------------------------------------------------------------------------- */
 /* IO helper functions.  */
 char *ioutil_current_dir(void)
@@ -176,6 +176,21 @@ int mouse_type = MOUSE_TYPE_PADDLE;
       with the largest delta
 */
 
+/* Position set by an input script, used instead of the host mouse */
+static int mouse_scripted = 0;
+static int mouse_script_x = 0;
+static int mouse_script_y = 0;
+
+static int mouse_get_x(void)
+{
+    return mouse_scripted ? mouse_script_x : mousedrv_get_x();
+}
+
+static int mouse_get_y(void)
+{
+    return mouse_scripted ? mouse_script_y : mousedrv_get_y();
+}
+
 static int update_limit = 512;
 static int last_mouse_x = 0;
 static int last_mouse_y = 0;
@@ -246,8 +261,8 @@ static void neos_get_new_movement(void)
 {
     uint8_t new_x, new_y;
 
-    new_x = (uint8_t)(mousedrv_get_x() >> 1);
-    new_y = (uint8_t)(mousedrv_get_y() >> 1);
+    new_x = (uint8_t)(mouse_get_x() >> 1);
+    new_y = (uint8_t)(mouse_get_y() >> 1);
     neos_x = (uint8_t)(neos_lastx - new_x);
     neos_lastx = new_x;
 
@@ -374,13 +389,28 @@ uint8_t mouse_poll(void)
     int diff_x, diff_y;
 
     /* get new mouse values */
-    new_x = (int16_t)mousedrv_get_x();
-    new_y = (int16_t)mousedrv_get_y();
+    new_x = (int16_t)mouse_get_x();
+    new_y = (int16_t)mouse_get_y();
     /* range of new_x and new_y are [0,63] */
     /* fetch now for both emu and os */
     os_now = mousedrv_get_timestamp();
     emu_now = maincpu_clk;
 
+    if (mouse_scripted && (new_x != latest_x || new_y != latest_y)) {
+        /* scripted moves don't depend on host timing, step there as fast
+           as the quadrature emulation goes */
+        diff_x = (int16_t)(new_x - last_mouse_x);
+        diff_y = (int16_t)(new_y - last_mouse_y);
+        sx = (diff_x > 0) - (diff_x < 0);
+        sy = (diff_y < 0) - (diff_y > 0);
+        update_x_emu_iv = (CLOCK)update_limit;
+        update_y_emu_iv = (CLOCK)update_limit;
+        next_update_x_emu_ts = emu_now;
+        next_update_y_emu_ts = emu_now;
+        latest_x = new_x;
+        latest_y = new_y;
+    }
+
     /* update x-wheel until we're ahead */
     while (((latest_x ^ last_mouse_x) & 0xffff) && next_update_x_emu_ts <= emu_now) {
         last_mouse_x += sx;
@@ -394,7 +424,9 @@ uint8_t mouse_poll(void)
     }
 
     /* check if the new values belong to a new mouse reading */
-    if (latest_os_ts == 0) {
+    if (mouse_scripted) {
+        /* set up above */
+    } else if (latest_os_ts == 0) {
         /* only first time, init stuff */
         last_mouse_x = latest_x = new_x;
         last_mouse_y = latest_y = new_y;
@@ -575,7 +607,7 @@ static inline uint8_t mouse_paddle_update(uint8_t paddle_v, int16_t *old_v, int1
 static uint8_t mouse_get_paddle_x(void)
 {
     if (_mouse_enabled) {
-        paddle_val[2] = mouse_paddle_update(paddle_val[2], &(paddle_old[2]), (int16_t)mousedrv_get_x());
+        paddle_val[2] = mouse_paddle_update(paddle_val[2], &(paddle_old[2]), (int16_t)mouse_get_x());
         return (uint8_t)(0xff - paddle_val[2]);
     }
     return 0xff;
@@ -584,12 +616,72 @@ static uint8_t mouse_get_paddle_x(void)
 static uint8_t mouse_get_paddle_y(void)
 {
     if (_mouse_enabled) {
-        paddle_val[3] = mouse_paddle_update(paddle_val[3], &(paddle_old[3]), (int16_t)mousedrv_get_y());
+        paddle_val[3] = mouse_paddle_update(paddle_val[3], &(paddle_old[3]), (int16_t)mouse_get_y());
         return (uint8_t)(0xff - paddle_val[3]);
     }
     return 0xff;
 }
 
+/* --------------------------------------------------------- */
+/* Input script support */
+
+/* Positions sent by an input script replace the host mouse until
+   mouse_script_release() is called.  The pointer starts at 0/0, so
+   script coordinates don't depend on where the host mouse was.  */
+static void mouse_script_begin(void)
+{
+    if (mouse_scripted) {
+        return;
+    }
+
+    mouse_scripted = 1;
+    mouse_script_x = 0;
+    mouse_script_y = 0;
+    latest_x = 0;
+    last_mouse_x = 0;
+    latest_y = 0;
+    last_mouse_y = 0;
+    neos_lastx = 0;
+    neos_lasty = 0;
+    paddle_old[2] = 0;
+    paddle_old[3] = 0;
+}
+
+void mouse_script_set_position(int x, int y)
+{
+    mouse_script_begin();
+
+    mouse_script_x = x;
+    mouse_script_y = y;
+}
+
+void mouse_script_set_paddles(uint8_t x, uint8_t y)
+{
+    mouse_script_begin();
+
+    /* the values are what the POT registers read */
+    paddle_val[2] = (uint8_t)(0xff - x);
+    paddle_val[3] = (uint8_t)(0xff - y);
+}
+
+void mouse_script_release(void)
+{
+    if (!mouse_scripted) {
+        return;
+    }
+
+    mouse_scripted = 0;
+    latest_x = (int16_t)mouse_get_x();
+    last_mouse_x = latest_x;
+    latest_y = (int16_t)mouse_get_y();
+    last_mouse_y = latest_y;
+    neos_lastx = (uint8_t)(mouse_get_x() >> 1);
+    neos_lasty = (uint8_t)(mouse_get_y() >> 1);
+    paddle_old[2] = (int16_t)mouse_get_x();
+    paddle_old[3] = (int16_t)mouse_get_y();
+    latest_os_ts = 0;
+}
+
 /*--------------------------------------------------------------------------*/
 
 typedef struct mt_id_s {
@@ -639,12 +731,12 @@ static int joyport_mouse_enable(int port, int val)
     int mt;
 
     mousedrv_mouse_changed();
-    latest_x = (int16_t)mousedrv_get_x();
+    latest_x = (int16_t)mouse_get_x();
     last_mouse_x = latest_x;
-    latest_y = (int16_t)mousedrv_get_y();
+    latest_y = (int16_t)mouse_get_y();
     last_mouse_y = latest_y;
-    neos_lastx = (uint8_t)(mousedrv_get_x() >> 1);
-    neos_lasty = (uint8_t)(mousedrv_get_y() >> 1);
+    neos_lastx = (uint8_t)(mouse_get_x() >> 1);
+    neos_lasty = (uint8_t)(mouse_get_y() >> 1);
     latest_os_ts = 0;
 
     if (!val) {
@@ -965,12 +1057,12 @@ static int set_mouse_enabled(int val, void *param)
 
     _mouse_enabled = val ? 1 : 0;
     mousedrv_mouse_changed();
-    latest_x = (int16_t)mousedrv_get_x();
+    latest_x = (int16_t)mouse_get_x();
     last_mouse_x = latest_x;
-    latest_y = (int16_t)mousedrv_get_y();
+    latest_y = (int16_t)mouse_get_y();
     last_mouse_y = latest_y;
-    neos_lastx = (uint8_t)(mousedrv_get_x() >> 1);
-    neos_lasty = (uint8_t)(mousedrv_get_y() >> 1);
+    neos_lastx = (uint8_t)(mouse_get_x() >> 1);
+    neos_lasty = (uint8_t)(mouse_get_y() >> 1);
     latest_os_ts = 0;
     if (mouse_type != -1) {
         joyport_display_joyport(mt_to_id(mouse_type), 0);
@@ -57,6 +57,10 @@ extern void smart_mouse_store(uint8_t val);
 extern uint8_t smart_mouse_read(void);
 extern uint8_t micromys_mouse_read(void);
 
+extern void mouse_script_set_position(int x, int y);
+extern void mouse_script_set_paddles(uint8_t x, uint8_t y);
+extern void mouse_script_release(void);
+
 #define MOUSE_TYPE_1351     0
 #define MOUSE_TYPE_NEOS     1
 #define MOUSE_TYPE_AMIGA    2
@@ -34,6 +34,7 @@
 #include "archdep.h"
 #include "attach.h"
 #include "autostart.h"
+#include "bootsnapshot.h"
 #include "clkguard.h"
 #include "cmdline.h"
 #include "console.h"
@@ -43,6 +44,7 @@
 #include "fliplist.h"
 #include "fsdevice.h"
 #include "gfxoutput.h"
+#include "inputscript.h"
 #include "interrupt.h"
 #include "kbdbuf.h"
 #include "keyboard.h"
@@ -53,12 +55,14 @@
 #include "maincpu.h"
 #include "mem.h"
 #include "monitor.h"
+#include "monitor_binary.h"
 #include "monitor_network.h"
 #include "network.h"
 #include "printer.h"
 #include "resources.h"
 #include "romset.h"
 #include "screenshot.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "sysfile.h"
 #include "tape.h"
@@ -109,9 +113,12 @@ unsigned int machine_jam(const char *format, ...)
     va_end(ap);
 
     log_message(LOG_DEFAULT, "*** %s", str);
+    monitor_binary_event_jam(str);
 
     if (jam_action == MACHINE_JAM_ACTION_DIALOG) {
-        if (monitor_is_remote()) {
+        if (monitor_is_binary()) {
+            ret = monitor_binary_ui_jam_dialog(str);
+        } else if (monitor_is_remote()) {
             ret = monitor_network_ui_jam_dialog(str);
         } else {
             ret = ui_jam_dialog(str);
@@ -182,7 +189,10 @@ void machine_reset_event_playback(CLOCK offset, void *data)
 
 void machine_reset(void)
 {
+    int powerup = 0;
+
     log_message(LOG_DEFAULT, "Main CPU: RESET.");
+    monitor_binary_event_reset();
 
     ignore_jam = 0;
 
@@ -190,12 +200,15 @@ void machine_reset(void)
     if (!mem_initialized) {
         mem_powerup();
         mem_initialized = 1;
+        powerup = 1;
     }
 
     machine_specific_reset();
 
     autostart_reset();
 
+    bootsnapshot_reset(powerup);
+
     mem_initialize_memory();
 
     event_reset_ack();
@@ -203,6 +216,31 @@ void machine_reset(void)
     vsync_suspend_speed_eval();
 }
 
+/* The machine specific snapshot code only knows about files, so the
+   snapshot functions are told to use the memory buffer instead.  */
+int machine_write_snapshot_memory(snapshot_memory_t *mem, int save_roms,
+                                  int save_disks, int event_mode)
+{
+    int retval;
+
+    snapshot_memory_redirect(mem);
+    retval = machine_write_snapshot("", save_roms, save_disks, event_mode);
+    snapshot_memory_redirect(NULL);
+
+    return retval;
+}
+
+int machine_read_snapshot_memory(snapshot_memory_t *mem, int event_mode)
+{
+    int retval;
+
+    snapshot_memory_redirect(mem);
+    retval = machine_read_snapshot("", event_mode);
+    snapshot_memory_redirect(NULL);
+
+    return retval;
+}
+
 static void machine_maincpu_clk_overflow_callback(CLOCK sub, void *data)
 {
     alarm_context_time_warp(maincpu_alarm_context, sub, -1);
@@ -236,6 +274,11 @@ int machine_init(void)
     file_system_init();
     mem_initialize_memory();
 
+    if (machine_class != VICE_MACHINE_VSID) {
+        bootsnapshot_init();
+        inputscript_init();
+    }
+
     return machine_specific_init();
 }
 
@@ -298,6 +341,7 @@ void machine_shutdown(void)
 
     traps_shutdown();
 
+    inputscript_shutdown();
     kbdbuf_shutdown();
     keyboard_shutdown();
 
@@ -328,6 +372,7 @@ void machine_shutdown(void)
     network_shutdown();
 
     autostart_resources_shutdown();
+    bootsnapshot_resources_shutdown();
     sound_resources_shutdown();
     video_resources_shutdown();
     machine_resources_shutdown();
@@ -341,6 +386,7 @@ void machine_shutdown(void)
     romset_resources_shutdown();
 #ifdef HAVE_NETWORK
     monitor_network_resources_shutdown();
+    monitor_binary_resources_shutdown();
 #endif
     archdep_shutdown();
 
@@ -396,6 +442,9 @@ int machine_common_resources_init(void)
         if (resources_register_string(resources_string) < 0) {
            return -1;
         }
+        if (bootsnapshot_resources_init() < 0) {
+           return -1;
+        }
     }
     return resources_register_int(resources_int);
 }
@@ -426,6 +475,12 @@ static const cmdline_option_t cmdline_options_vsid[] = {
 int machine_common_cmdline_options_init(void)
 {
     if (machine_class != VICE_MACHINE_VSID) {
+        if (bootsnapshot_cmdline_options_init() < 0) {
+            return -1;
+        }
+        if (inputscript_cmdline_options_init() < 0) {
+            return -1;
+        }
         return cmdline_register_options(cmdline_options);
     } else {
         return cmdline_register_options(cmdline_options_vsid);
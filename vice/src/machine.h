@@ -142,6 +142,14 @@ extern int machine_write_snapshot(const char *name, int save_roms,
 /* Read a snapshot.  */
 extern int machine_read_snapshot(const char *name, int even_mode);
 
+/* Write or read a snapshot kept in memory instead of a file.  */
+struct snapshot_memory_s;
+extern int machine_write_snapshot_memory(struct snapshot_memory_s *mem,
+                                         int save_roms, int save_disks,
+                                         int event_mode);
+extern int machine_read_snapshot_memory(struct snapshot_memory_s *mem,
+                                        int event_mode);
+
 /* handle pending interrupts - needed by libsid.a.  */
 extern void machine_handle_pending_alarms(int num_write_cycles);
 
@@ -32,6 +32,7 @@
 
 #include "6510core.h"
 #include "alarm.h"
+#include "c64mem.h"
 
 #ifdef FEATURE_CPUMEMHISTORY
 #include "c64pla.h"
@@ -286,10 +287,25 @@ static uint8_t memmap_mem_read(unsigned int addr)
 
 inline static uint8_t mem_read_check_ba(unsigned int addr)
 {
+    uint8_t *p;
+
     check_ba();
+    p = _mem_read_direct_tab_ptr[(addr) >> 8];
+    if (p != NULL) {
+        return p[addr];
+    }
     return (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
 }
 
+inline static uint8_t mem_read_zero_check_ba(unsigned int addr)
+{
+    check_ba();
+    if (addr > 1 && _mem_read_direct_zero_ptr != NULL) {
+        return _mem_read_direct_zero_ptr[addr];
+    }
+    return (*_mem_read_tab_ptr[0])((uint16_t)(addr));
+}
+
 #ifndef STORE
 #define STORE(addr, value) \
     (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value))
@@ -314,7 +330,7 @@ inline static uint8_t mem_read_check_ba(unsigned int addr)
 
 #ifndef LOAD_ZERO
 #define LOAD_ZERO(addr) \
-    mem_read_check_ba((addr) & 0xff)
+    mem_read_zero_check_ba((addr) & 0xff)
 #endif
 
 /* Route stack operations through read/write handlers */
@@ -39,7 +39,10 @@ enum mon_int {
     MI_NONE = 0,
     MI_BREAK = 1 << 0,
     MI_WATCH = 1 << 1,
-    MI_STEP = 1 << 2
+    MI_STEP = 1 << 2,
+    MI_REVERSE = 1 << 3,
+    MI_COVERAGE = 1 << 4,
+    MI_ACCESS = 1 << 5
 };
 
 enum t_memspace {
@@ -153,11 +156,13 @@ extern int monitor_force_import(MEMSPACE mem);
 extern void monitor_check_icount(uint16_t a);
 extern void monitor_check_icount_interrupt(void);
 extern void monitor_check_watchpoints(unsigned int lastpc, unsigned int pc);
+extern int monitor_check_reverse(void);
 
 extern void monitor_cpu_type_set(const char *cpu_type);
 
 extern void monitor_watch_push_load_addr(uint16_t addr, MEMSPACE mem);
 extern void monitor_watch_push_store_addr(uint16_t addr, MEMSPACE mem);
+extern void monitor_watch_access(int addr, void (*func)(void));
 
 extern monitor_interface_t *monitor_interface_new(void);
 extern void monitor_interface_destroy(monitor_interface_t *monitor_interface);
@@ -215,6 +220,22 @@ extern void monitor_cpuhistory_store(unsigned int addr, unsigned int op, unsigne
 extern void monitor_cpuhistory_fix_p2(unsigned int p2);
 extern void monitor_memmap_store(unsigned int addr, unsigned int type);
 
+/* Binary CPU trace, see monitor/mon_cputrace.c */
+extern int monitor_cputrace_enabled;
+extern void monitor_cputrace_store(CLOCK clk, int mem, unsigned int addr,
+                                   unsigned int op, unsigned int p1, unsigned int p2,
+                                   uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
+                                   uint8_t reg_sp, unsigned int reg_st);
+
+/* Coverage maps, see monitor/mon_coverage.c */
+#define MON_COVERAGE_BANK_RAM   0
+#define MON_COVERAGE_BANK_ROM   1
+#define MON_COVERAGE_BANK_IO    2
+#define MON_COVERAGE_BANK_CART  16  /* + cartridge bank */
+
+extern void monitor_coverage_exec(MEMSPACE mem, uint16_t addr);
+extern void monitor_coverage_set_bank_func(MEMSPACE mem, int (*func)(uint16_t addr, int store));
+
 /* memmap defines */
 #define MEMMAP_I_O_R    (1 << 8)
 #define MEMMAP_I_O_W    (1 << 7)
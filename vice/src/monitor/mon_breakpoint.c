@@ -38,6 +38,7 @@
 #include "mon_breakpoint.h"
 #include "mon_disassemble.h"
 #include "mon_util.h"
+#include "monitor_binary.h"
 #include "montypes.h"
 #include "uimon.h"
 
@@ -50,6 +51,7 @@ struct checkpoint_s {
     int hit_count;
     int ignore_count;
     cond_node_t *condition;
+    cond_code_t *condition_code;
     char *command;
     bool stop;
     bool enabled;
@@ -71,6 +73,14 @@ static checkpoint_list_t *breakpoints[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_load[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_store[NUM_MEMSPACES];
 
+/* One bit per address which is covered by a checkpoint in the lists above,
+   so addresses without checkpoint are dismissed with a single bit test.  */
+#define CHECKPOINT_MAP_SIZE (0x10000 / 8)
+
+static uint8_t breakpoints_map[NUM_MEMSPACES][CHECKPOINT_MAP_SIZE];
+static uint8_t watchpoints_load_map[NUM_MEMSPACES][CHECKPOINT_MAP_SIZE];
+static uint8_t watchpoints_store_map[NUM_MEMSPACES][CHECKPOINT_MAP_SIZE];
+
 
 void mon_breakpoint_init(void)
 {
@@ -140,14 +150,52 @@ static checkpoint_t *find_checkpoint(int brknum)
     return NULL;
 }
 
+static void update_checkpoint_map(checkpoint_list_t *head, uint8_t *map)
+{
+    unsigned int start, end, loc;
+
+    memset(map, 0, CHECKPOINT_MAP_SIZE);
+
+    while (head) {
+        start = addr_location(head->checkpt->start_addr);
+        if (mon_is_valid_addr(head->checkpt->end_addr)) {
+            end = addr_location(head->checkpt->end_addr);
+        } else {
+            end = start;
+        }
+
+        /* ranges with end < start wrap around at $ffff */
+        loc = start;
+        while (1) {
+            map[loc >> 3] |= 1 << (loc & 7);
+            if (loc == end) {
+                break;
+            }
+            loc = (loc + 1) & 0xffff;
+        }
+
+        head = head->next;
+    }
+}
+
 static void update_checkpoint_state(MEMSPACE mem)
 {
+    update_checkpoint_map(breakpoints[mem], breakpoints_map[mem]);
+    update_checkpoint_map(watchpoints_load[mem], watchpoints_load_map[mem]);
+    update_checkpoint_map(watchpoints_store[mem], watchpoints_store_map[mem]);
+
     if (watchpoints_load[mem] != NULL || watchpoints_store[mem] != NULL) {
         monitor_mask[mem] |= MI_WATCH;
+    } else {
+        monitor_mask[mem] &= ~MI_WATCH;
+    }
+
+    /* coverage maps and access hooks see the accesses through the watch
+       tables, too */
+    if (monitor_mask[mem] & (MI_WATCH | MI_COVERAGE | MI_ACCESS)) {
         mon_interfaces[mem]->toggle_watchpoints_func(
             1, mon_interfaces[mem]->context);
     } else {
-        monitor_mask[mem] &= ~MI_WATCH;
         mon_interfaces[mem]->toggle_watchpoints_func(
             0, mon_interfaces[mem]->context);
     }
@@ -158,13 +206,19 @@ static void update_checkpoint_state(MEMSPACE mem)
         monitor_mask[mem] &= ~MI_BREAK;
     }
 
-    if (monitor_mask[mem]) {
+    /* access hooks are called from the watch tables, not the CPU */
+    if (monitor_mask[mem] & ~MI_ACCESS) {
         interrupt_monitor_trap_on(mon_interfaces[mem]->int_status);
     } else {
         interrupt_monitor_trap_off(mon_interfaces[mem]->int_status);
     }
 }
 
+void mon_breakpoint_update_state(MEMSPACE mem)
+{
+    update_checkpoint_state(mem);
+}
+
 static void remove_checkpoint(checkpoint_t *cp)
 {
     MEMSPACE mem;
@@ -172,6 +226,7 @@ static void remove_checkpoint(checkpoint_t *cp)
     mem = addr_memspace(cp->start_addr);
 
     mon_delete_conditional(cp->condition);
+    mon_delete_compiled_conditional(cp->condition_code);
     lib_free(cp->command);
     cp->command = NULL;
 
@@ -322,7 +377,10 @@ void mon_breakpoint_set_checkpoint_condition(int cp_num,
         if (!cp) {
             mon_out("#%d not a valid checkpoint\n", cp_num);
         } else {
+            mon_delete_conditional(cp->condition);
+            mon_delete_compiled_conditional(cp->condition_code);
             cp->condition = cnode;
+            cp->condition_code = mon_compile_conditional(cnode);
 
             mon_out("Setting checkpoint %d condition to: ", cp_num);
             mon_print_conditional(cnode);
@@ -389,6 +447,59 @@ static int compare_checkpoints(checkpoint_t *bp1, checkpoint_t *bp2)
     return 0;
 }
 
+bool mon_breakpoint_is_checkpoint(MEMSPACE mem, unsigned int addr, MEMORY_OP op)
+{
+    const uint8_t *map;
+
+    switch (op) {
+        case e_load:
+            map = watchpoints_load_map[mem];
+            break;
+        case e_store:
+            map = watchpoints_store_map[mem];
+            break;
+        default: /* e_exec */
+            map = breakpoints_map[mem];
+            break;
+    }
+
+    addr &= 0xffff;
+    return (map[addr >> 3] >> (addr & 7)) & 1;
+}
+
+/* Return TRUE if an enabled breakpoint at `addr' would stop execution.
+   Unlike mon_breakpoint_check_checkpoint() this prints nothing and leaves
+   the hit and ignore counts alone.  */
+bool mon_breakpoint_is_stop_point(MEMSPACE mem, unsigned int addr)
+{
+    checkpoint_list_t *ptr;
+    checkpoint_t *cp;
+
+    if (!mon_breakpoint_is_checkpoint(mem, addr, e_exec)) {
+        return FALSE;
+    }
+
+    ptr = search_checkpoint_list(breakpoints[mem], addr);
+
+    while (ptr && mon_is_in_range(ptr->checkpt->start_addr, ptr->checkpt->end_addr, addr)) {
+        cp = ptr->checkpt;
+        ptr = ptr->next;
+        if (cp->enabled == e_ON && cp->stop) {
+            if (cp->condition_code) {
+                if (!mon_evaluate_compiled_conditional(cp->condition_code)) {
+                    continue;
+                }
+            } else if (cp->condition) {
+                if (!mon_evaluate_conditional(cp->condition)) {
+                    continue;
+                }
+            }
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned int lastpc, MEMORY_OP op)
 {
     checkpoint_list_t *ptr;
@@ -401,8 +512,13 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
     char is_loadstore = 0;
     const char *op_str;
     const char *action_str;
-    int monbank = mon_interfaces[mem]->current_bank;
+    int monbank;
 
+    if (!mon_breakpoint_is_checkpoint(mem, addr, op)) {
+        return FALSE;
+    }
+
+    monbank = mon_interfaces[mem]->current_bank;
     monitor_cpu = monitor_cpu_for_memspace[mem];
     instpc = new_addr(mem, (monitor_cpu->mon_register_get_val)(mem, e_PC));
     loadstorepc = new_addr(mem, lastpc);
@@ -433,7 +549,11 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
         ptr = ptr->next;
         if (cp && cp->enabled == e_ON) {
             /* If condition test fails, skip this checkpoint */
-            if (cp->condition) {
+            if (cp->condition_code) {
+                if (!mon_evaluate_compiled_conditional(cp->condition_code)) {
+                    continue;
+                }
+            } else if (cp->condition) {
                 if (!mon_evaluate_conditional(cp->condition)) {
                     continue;
                 }
@@ -446,6 +566,7 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
             }
 
             cp->hit_count++;
+            monitor_binary_event_checkpoint(cp->checknum);
 
             if (cp->stop) {
                 must_stop = TRUE;
@@ -543,6 +664,7 @@ int breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
     new_cp->hit_count = 0;
     new_cp->ignore_count = 0;
     new_cp->condition = NULL;
+    new_cp->condition_code = NULL;
     new_cp->command = NULL;
     new_cp->check_load = memory_op & e_load;
     new_cp->check_store = memory_op & e_store;
@@ -579,6 +701,42 @@ int mon_breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
     return breakpoint_add_checkpoint(start_addr, end_addr, stop, op, is_temp, TRUE);
 }
 
+int mon_breakpoint_add_checkpoint_quiet(MON_ADDR start_addr, MON_ADDR end_addr,
+                                        bool stop, MEMORY_OP op, bool is_temp)
+{
+    return breakpoint_add_checkpoint(start_addr, end_addr, stop, op, is_temp, FALSE);
+}
+
+/* Number of the last checkpoint added, deleted ones included.  */
+int mon_breakpoint_get_last_number(void)
+{
+    return breakpoint_count - 1;
+}
+
+bool mon_breakpoint_get_info(int cp_num, mon_checkpoint_info_t *info)
+{
+    checkpoint_t *cp;
+
+    cp = find_checkpoint(cp_num);
+    if (cp == NULL) {
+        return FALSE;
+    }
+
+    info->checknum = cp->checknum;
+    info->start_addr = cp->start_addr;
+    info->end_addr = cp->end_addr;
+    info->hit_count = cp->hit_count;
+    info->ignore_count = cp->ignore_count;
+    info->stop = cp->stop;
+    info->enabled = (cp->enabled == e_ON);
+    info->check_load = cp->check_load;
+    info->check_store = cp->check_store;
+    info->check_exec = cp->check_exec;
+    info->temporary = cp->temporary;
+    info->has_condition = (cp->condition != NULL);
+    return TRUE;
+}
+
 mon_breakpoint_type_t mon_breakpoint_is(MON_ADDR address)
 {
     MEMSPACE mem = addr_memspace(address);
@@ -623,6 +781,7 @@ void mon_breakpoint_unset(MON_ADDR address)
     if (ptr) {
         /* there's a breakpoint, so remove it */
         remove_checkpoint_from_list( &breakpoints[mem], ptr->checkpt );
+        update_checkpoint_state(mem);
     }
 }
 
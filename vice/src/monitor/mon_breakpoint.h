@@ -35,18 +35,42 @@ typedef enum mon_breakpoint_type_e {
     BP_ACTIVE
 } mon_breakpoint_type_t;
 
+/* Copy of the state of a checkpoint, for the binary remote monitor.  */
+typedef struct mon_checkpoint_info_s {
+    int checknum;
+    MON_ADDR start_addr;
+    MON_ADDR end_addr;
+    int hit_count;
+    int ignore_count;
+    bool stop;
+    bool enabled;
+    bool check_load;
+    bool check_store;
+    bool check_exec;
+    bool temporary;
+    bool has_condition;
+} mon_checkpoint_info_t;
+
 extern void mon_breakpoint_init(void);
 
 extern void mon_breakpoint_switch_checkpoint(int op, int breakpt_num);
+extern void mon_breakpoint_update_state(MEMSPACE mem);
 extern void mon_breakpoint_set_ignore_count(int breakpt_num, int count);
 extern void mon_breakpoint_print_checkpoints(void);
 extern void mon_breakpoint_delete_checkpoint(int brknum);
 extern void mon_breakpoint_set_checkpoint_condition(int brk_num, struct cond_node_s *cnode);
 extern void mon_breakpoint_set_checkpoint_command(int brk_num, char *cmd);
+extern bool mon_breakpoint_is_checkpoint(MEMSPACE mem, unsigned int addr,
+                                         MEMORY_OP op);
+extern bool mon_breakpoint_is_stop_point(MEMSPACE mem, unsigned int addr);
 extern bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr,
                                             unsigned int lastpc, MEMORY_OP op);
 extern int mon_breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
                                          bool stop, MEMORY_OP op, bool is_temp);
+extern int mon_breakpoint_add_checkpoint_quiet(MON_ADDR start_addr, MON_ADDR end_addr,
+                                               bool stop, MEMORY_OP op, bool is_temp);
+extern int mon_breakpoint_get_last_number(void);
+extern bool mon_breakpoint_get_info(int cp_num, mon_checkpoint_info_t *info);
 
 extern mon_breakpoint_type_t mon_breakpoint_is(MON_ADDR address);
 extern void mon_breakpoint_set(MON_ADDR address);
@@ -54,7 +78,8 @@ extern void mon_breakpoint_unset(MON_ADDR address);
 extern void mon_breakpoint_enable(MON_ADDR address);
 extern void mon_breakpoint_disable(MON_ADDR address);
 
-/* defined in mon_parse.y, and thus, in mon_parse.c */
-extern void parse_and_execute_line(char *input);
+/* defined in mon_parse.y, and thus, in mon_parse.c; returns nonzero
+   if the line could not be parsed */
+extern int parse_and_execute_line(char *input);
 
 #endif
@@ -109,6 +109,16 @@ static const mon_cmds_t mon_cmd_array[] = {
       IDGS_MON_CPUHISTORY_DESCRIPTION,
       NULL, NULL },
 
+    { "cputrace", "ctr",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      "[\"<filename>\"]",
+      "Write a binary trace of every instruction executed by the\n"
+      "computer and drive CPUs to the file, compressed if the name\n"
+      "ends in .gz. Without a filename the running trace is stopped." },
+
     { "dump", "",
       USE_PARAM_ID, USE_DESCRIPTION_ID,
       "\"<%s>\"", 1,
@@ -137,6 +147,15 @@ static const mon_cmds_t mon_cmd_array[] = {
       IDGS_MON_IO_DESCRIPTION,
       NULL, NULL },
 
+    { "lastchange", "lch",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      "<address>",
+      "Go back to the last instruction that changed the byte at the address.\n"
+      "Needs reverse execution to be enabled." },
+
     { "next", "n",
       USE_PARAM_STRING, USE_DESCRIPTION_ID,
       NULL, 0,
@@ -144,6 +163,15 @@ static const mon_cmds_t mon_cmd_array[] = {
       IDGS_MON_NEXT_DESCRIPTION,
       NULL, NULL },
 
+    { "rcontinue", "rc",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      NULL,
+      "Go back to the last point where a breakpoint would have stopped\n"
+      "execution. Needs reverse execution to be enabled." },
+
     { "registers", "r",
       USE_PARAM_ID, USE_DESCRIPTION_ID,
       "[<%s> = <%s> [, <%s> = <%s>]*]", 4,
@@ -165,6 +193,26 @@ static const mon_cmds_t mon_cmd_array[] = {
       IDGS_MON_RETURN_DESCRIPTION,
       NULL, NULL },
 
+    { "reverse", "rev",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      "[<interval> [<budget>]]",
+      "Keep a snapshot of the machine every <interval> cycles (in memory, up to\n"
+      "<budget> KB) so that execution can be reversed with rstep, rcontinue\n"
+      "and lastchange. An interval of 0 disables it. Without arguments the\n"
+      "current state is shown." },
+
+    { "rstep", "rz",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      "[<count>]",
+      "Step back <count> instructions (default 1).\n"
+      "Needs reverse execution to be enabled." },
+
     { "screen", "sc",
       USE_PARAM_STRING, USE_DESCRIPTION_ID,
       NULL, 0,
@@ -270,6 +318,40 @@ static const mon_cmds_t mon_cmd_array[] = {
       IDGS_MON_COMPARE_DESCRIPTION,
       NULL, NULL },
 
+    { "coverage", "cov",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      "[on|off|toggle]",
+      "Switch collecting coverage maps of the memory read, written and\n"
+      "executed by the computer and drive CPUs. Without argument, show\n"
+      "how much of every memory bank has been covered so far." },
+
+    { "coverageload", "covl",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      "\"<filename>\"",
+      "Merge the coverage maps saved in the file into the current ones." },
+
+    { "coveragesave", "covs",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      "\"<filename>\"",
+      "Save the current coverage maps to the file." },
+
+    { "coveragezap", "covz",
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      NULL, 0,
+      { IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED, IDGS_UNUSED },
+      IDGS_UNUSED,
+      NULL,
+      "Clear the coverage maps." },
+
     { "disass", "d",
       USE_PARAM_ID, USE_DESCRIPTION_ID,
       "[<%s> [<%s>]]", 2,
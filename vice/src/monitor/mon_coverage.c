@@ -0,0 +1,359 @@
+/*
+ * mon_coverage.c - The VICE built-in monitor, coverage maps.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Coverage maps record which addresses have been read, written and
+   executed, one map of 64K flag bytes per memspace and bank.  The bank is
+   told by a function the machine registers for the memspace, so that
+   e.g. the same address in different cartridge banks is kept apart;
+   memspaces without one have a single map.
+
+   Collecting is switched on at runtime.  Reads and writes are recorded
+   through the watchpoint memory tables and execution through the monitor
+   interrupt of the CPU, so there is no cost at all while it is off.
+
+   Files of several runs are merged by loading them one after another with
+   `coverageload'.  All files of a machine have the same size and layout,
+   so they can also be merged by OR'ing them byte by byte.  The format is:
+
+   0-12   "VICE COVERAGE"
+   13     format version (2)
+   14-15  number of maps, little endian
+   16-31  machine name, padded with 0
+
+   followed by every map of every memspace, memspaces in order (computer,
+   drive 8-11), banks in order; a memspace without a bank function has
+   one map, the others COVERAGE_NUM_BANKS.  Maps never touched are all 0.
+   A map is three bitmaps of 8192 bytes, addresses read, written and
+   executed, the bit for an address is (addr & 7) of byte (addr >> 3).  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "mon_breakpoint.h"
+#include "mon_coverage.h"
+#include "monitor.h"
+#include "montypes.h"
+#include "types.h"
+#include "util.h"
+
+#define COVERAGE_VERSION        2
+#define COVERAGE_HEADER_SIZE    32
+#define COVERAGE_MAP_SIZE       0x10000
+#define COVERAGE_BITMAP_SIZE    (COVERAGE_MAP_SIZE / 8)
+#define COVERAGE_CART_BANKS     256
+#define COVERAGE_NUM_BANKS      (MON_COVERAGE_BANK_CART + COVERAGE_CART_BANKS)
+
+static uint8_t *coverage_maps[NUM_MEMSPACES][COVERAGE_NUM_BANKS];
+static int (*coverage_bank_func[NUM_MEMSPACES])(uint16_t addr, int store);
+
+/* Merged into and written at shutdown, see -coverage.  */
+static char *coverage_file = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+static uint8_t *coverage_get_map(MEMSPACE mem, int bank)
+{
+    if (coverage_maps[mem][bank] == NULL) {
+        coverage_maps[mem][bank] = lib_calloc(1, COVERAGE_MAP_SIZE);
+    }
+    return coverage_maps[mem][bank];
+}
+
+void mon_coverage_store(MEMSPACE mem, uint16_t addr, unsigned int type)
+{
+    int bank = 0;
+
+    if (coverage_bank_func[mem] != NULL) {
+        bank = coverage_bank_func[mem](addr, (type & e_store) != 0);
+    }
+    coverage_get_map(mem, bank)[addr] |= (uint8_t)type;
+}
+
+void monitor_coverage_exec(MEMSPACE mem, uint16_t addr)
+{
+    mon_coverage_store(mem, addr, e_exec);
+}
+
+void monitor_coverage_set_bank_func(MEMSPACE mem, int (*func)(uint16_t addr, int store))
+{
+    coverage_bank_func[mem] = func;
+}
+
+static const char *coverage_bank_name(MEMSPACE mem, int bank)
+{
+    static char name[16];
+
+    if (coverage_bank_func[mem] == NULL) {
+        return "-";
+    }
+
+    switch (bank) {
+        case MON_COVERAGE_BANK_RAM:
+            return "ram";
+        case MON_COVERAGE_BANK_ROM:
+            return "rom";
+        case MON_COVERAGE_BANK_IO:
+            return "io";
+    }
+
+    sprintf(name, "cart %d", bank - MON_COVERAGE_BANK_CART);
+    return name;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void mon_coverage_switch(int op)
+{
+    int mem, on;
+
+    if (op == e_TOGGLE) {
+        on = !(monitor_mask[e_comp_space] & MI_COVERAGE);
+    } else {
+        on = (op == e_ON);
+    }
+
+    for (mem = FIRST_SPACE; mem <= LAST_SPACE; mem++) {
+        if (on) {
+            monitor_mask[mem] |= MI_COVERAGE;
+        } else {
+            monitor_mask[mem] &= ~MI_COVERAGE;
+        }
+        mon_breakpoint_update_state(mem);
+    }
+}
+
+void mon_coverage_show(void)
+{
+    int mem, bank;
+    unsigned int addr, reads, writes, execs;
+    const uint8_t *map;
+
+    mon_out("Coverage is %s.\n",
+            (monitor_mask[e_comp_space] & MI_COVERAGE) ? "on" : "off");
+
+    for (mem = FIRST_SPACE; mem <= LAST_SPACE; mem++) {
+        for (bank = 0; bank < COVERAGE_NUM_BANKS; bank++) {
+            map = coverage_maps[mem][bank];
+            if (map == NULL) {
+                continue;
+            }
+
+            reads = writes = execs = 0;
+            for (addr = 0; addr < COVERAGE_MAP_SIZE; addr++) {
+                reads += (map[addr] & e_load) ? 1 : 0;
+                writes += (map[addr] & e_store) ? 1 : 0;
+                execs += (map[addr] & e_exec) ? 1 : 0;
+            }
+            mon_out("%s: %-8s  read %5u  write %5u  exec %5u\n",
+                    mon_memspace_string[mem], coverage_bank_name(mem, bank),
+                    reads, writes, execs);
+        }
+    }
+}
+
+void mon_coverage_zap(void)
+{
+    int mem, bank;
+
+    for (mem = 0; mem < NUM_MEMSPACES; mem++) {
+        for (bank = 0; bank < COVERAGE_NUM_BANKS; bank++) {
+            lib_free(coverage_maps[mem][bank]);
+            coverage_maps[mem][bank] = NULL;
+        }
+    }
+}
+
+/* Number of maps written for `mem', see the format above.  */
+static int coverage_num_banks(int mem)
+{
+    return coverage_bank_func[mem] != NULL ? COVERAGE_NUM_BANKS : 1;
+}
+
+static void coverage_make_header(uint8_t *header)
+{
+    const char *name;
+    size_t len;
+    unsigned int maps = 0;
+    int mem;
+
+    for (mem = FIRST_SPACE; mem <= LAST_SPACE; mem++) {
+        maps += (unsigned int)coverage_num_banks(mem);
+    }
+
+    memset(header, 0, COVERAGE_HEADER_SIZE);
+    memcpy(header, "VICE COVERAGE", 13);
+    header[13] = COVERAGE_VERSION;
+    header[14] = (uint8_t)maps;
+    header[15] = (uint8_t)(maps >> 8);
+    name = machine_get_name();
+    len = strlen(name);
+    memcpy(header + 16, name, len < COVERAGE_HEADER_SIZE - 16 ? len : COVERAGE_HEADER_SIZE - 16);
+}
+
+static int coverage_write(const char *filename)
+{
+    FILE *f;
+    uint8_t header[COVERAGE_HEADER_SIZE];
+    uint8_t *bits;
+    const uint8_t *map;
+    int mem, bank, i;
+    unsigned int addr;
+    static const unsigned int flags[3] = { e_load, e_store, e_exec };
+
+    f = fopen(filename, MODE_WRITE);
+    if (f == NULL) {
+        return -1;
+    }
+
+    coverage_make_header(header);
+    if (fwrite(header, 1, sizeof(header), f) != sizeof(header)) {
+        fclose(f);
+        return -1;
+    }
+
+    bits = lib_malloc(COVERAGE_BITMAP_SIZE);
+    for (mem = FIRST_SPACE; mem <= LAST_SPACE; mem++) {
+        for (bank = 0; bank < coverage_num_banks(mem); bank++) {
+            map = coverage_maps[mem][bank];
+            for (i = 0; i < 3; i++) {
+                memset(bits, 0, COVERAGE_BITMAP_SIZE);
+                for (addr = 0; map != NULL && addr < COVERAGE_MAP_SIZE; addr++) {
+                    if (map[addr] & flags[i]) {
+                        bits[addr >> 3] |= (uint8_t)(1 << (addr & 7));
+                    }
+                }
+                if (fwrite(bits, 1, COVERAGE_BITMAP_SIZE, f) != COVERAGE_BITMAP_SIZE) {
+                    lib_free(bits);
+                    fclose(f);
+                    return -1;
+                }
+            }
+        }
+    }
+    lib_free(bits);
+
+    return fclose(f);
+}
+
+/* OR the maps of a coverage file into the current ones.  */
+static int coverage_read(const char *filename)
+{
+    FILE *f;
+    uint8_t header[COVERAGE_HEADER_SIZE], expected[COVERAGE_HEADER_SIZE];
+    uint8_t *bits, *map;
+    int mem, bank, i;
+    unsigned int addr;
+    int retval = 0;
+    static const unsigned int flags[3] = { e_load, e_store, e_exec };
+
+    f = fopen(filename, MODE_READ);
+    if (f == NULL) {
+        return -1;
+    }
+
+    /* only files of the same layout can be merged */
+    coverage_make_header(expected);
+    if (fread(header, 1, sizeof(header), f) != sizeof(header)
+        || memcmp(header, expected, sizeof(header)) != 0) {
+        fclose(f);
+        return -1;
+    }
+
+    bits = lib_malloc(COVERAGE_BITMAP_SIZE);
+    for (mem = FIRST_SPACE; mem <= LAST_SPACE && retval == 0; mem++) {
+        for (bank = 0; bank < coverage_num_banks(mem) && retval == 0; bank++) {
+            for (i = 0; i < 3; i++) {
+                if (fread(bits, 1, COVERAGE_BITMAP_SIZE, f) != COVERAGE_BITMAP_SIZE) {
+                    retval = -1;
+                    break;
+                }
+                map = coverage_maps[mem][bank];
+                for (addr = 0; addr < COVERAGE_MAP_SIZE; addr++) {
+                    if (bits[addr >> 3] & (1 << (addr & 7))) {
+                        if (map == NULL) {
+                            map = coverage_get_map(mem, bank);
+                        }
+                        map[addr] |= (uint8_t)flags[i];
+                    }
+                }
+            }
+        }
+    }
+    lib_free(bits);
+    fclose(f);
+
+    return retval;
+}
+
+void mon_coverage_save(char *filename)
+{
+    if (coverage_write(filename) < 0) {
+        mon_out("Cannot write `%s'.\n", filename);
+    }
+    lib_free(filename);
+}
+
+void mon_coverage_load(char *filename)
+{
+    if (coverage_read(filename) < 0) {
+        mon_out("Cannot read `%s'.\n", filename);
+    }
+    lib_free(filename);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int mon_coverage_set_file(const char *filename, void *extra_param)
+{
+    util_string_set(&coverage_file, filename);
+    return 0;
+}
+
+void mon_coverage_init(void)
+{
+    if (coverage_file != NULL) {
+        mon_coverage_switch(e_ON);
+    }
+}
+
+void mon_coverage_shutdown(void)
+{
+    if (coverage_file != NULL) {
+        /* add what earlier runs have found */
+        if (util_file_exists(coverage_file) && coverage_read(coverage_file) < 0) {
+            log_error(LOG_DEFAULT, "Cannot merge coverage file `%s'.", coverage_file);
+        } else if (coverage_write(coverage_file) < 0) {
+            log_error(LOG_DEFAULT, "Cannot write coverage file `%s'.", coverage_file);
+        }
+        lib_free(coverage_file);
+        coverage_file = NULL;
+    }
+
+    mon_coverage_zap();
+}
@@ -0,0 +1,41 @@
+/*
+ * mon_coverage.h - The VICE built-in monitor, coverage maps.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MON_COVERAGE_H
+#define VICE_MON_COVERAGE_H
+
+#include "montypes.h"
+
+extern void mon_coverage_store(MEMSPACE mem, uint16_t addr, unsigned int type);
+
+extern void mon_coverage_switch(int op);
+extern void mon_coverage_show(void);
+extern void mon_coverage_zap(void);
+extern void mon_coverage_save(char *filename);
+extern void mon_coverage_load(char *filename);
+
+extern int mon_coverage_set_file(const char *filename, void *extra_param);
+extern void mon_coverage_init(void);
+extern void mon_coverage_shutdown(void);
+
+#endif
@@ -0,0 +1,370 @@
+/*
+ * mon_cputrace.c - The VICE built-in monitor, binary CPU trace recorder.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The trace file starts with a 16 byte header:
+
+   0-13   "VICE CPU TRACE"
+   14     format version (2)
+   15     record size (20)
+
+   followed by one record per executed instruction, all values little
+   endian:
+
+   0-3    CPU clock before the instruction
+   4-5    PC
+   6      memspace of the CPU (1 = computer, 2-5 = drive 8-11)
+   7-9    opcode and operand bytes
+   10-14  A, X, Y, SP and status before the instruction
+   15     flags, bit 0 set if bytes 16-18 are valid
+   16-17  effective address of the memory operand
+   18     value at the effective address before the instruction
+   19     unused (0)
+
+   The effective address is worked out from the operand bytes, the index
+   registers and, for the indirect modes, the zero page pointer.  For
+   JMP ($nnnn) and JMP ($nnnn,X) it is the address of the pointer.  It is
+   not recorded for the DTV CPU, whose zero page can be moved.
+
+   Memory is read with the peek of the memspace, which does not
+   acknowledge interrupts or clear latches like a read does.  It is not
+   free of side effects for every chip though: peeking an I/O register
+   first brings the chip up to date, and peeking CIA2 of the C64 and C128
+   runs the drive CPUs up to the current cycle.  A traced run can
+   therefore call the drive CPUs at other times than an untraced one.
+
+   The file is gzip compressed if its name ends in .gz and VICE is built
+   with zlib.  Records are written from the emulation thread, one 1.25MB
+   block at a time.  Tracing a C64 with a 1541 in warp mode is 2.4 times
+   slower than without tracing when writing to /dev/null, 2.6 to 4.2
+   times when writing to a file, and about 16 times when compressing.
+   See doc/cputrace.c for a tool that disassembles, summarizes and
+   compares traces.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "archdep.h"
+#include "asm.h"
+#include "lib.h"
+#include "log.h"
+#include "mon_cputrace.h"
+#include "monitor.h"
+#include "montypes.h"
+#include "types.h"
+#include "util.h"
+
+#define CPUTRACE_VERSION        2
+#define CPUTRACE_RECORD_SIZE    20
+#define CPUTRACE_BUFFER_SIZE    (CPUTRACE_RECORD_SIZE * 0x10000)
+
+/* Checked by the CPU cores before every instruction.  */
+int monitor_cputrace_enabled = 0;
+
+static FILE *cputrace_fd = NULL;
+#ifdef HAVE_ZLIB
+static gzFile cputrace_gzfd = NULL;
+#endif
+
+static char *cputrace_name = NULL;
+static uint8_t *cputrace_buffer = NULL;
+static unsigned int cputrace_buffer_len = 0;
+static unsigned long cputrace_records = 0;
+
+/* Addressing mode of every opcode, ASM_ADDR_MODE_IMPLIED where no
+   effective address is recorded.  */
+static uint8_t cputrace_mode[NUM_MEMSPACES][0x100];
+static int cputrace_can_peek[NUM_MEMSPACES];
+
+static int cputrace_write(const uint8_t *data, unsigned int len)
+{
+#ifdef HAVE_ZLIB
+    if (cputrace_gzfd != NULL) {
+        return gzwrite(cputrace_gzfd, data, len) == (int)len ? 0 : -1;
+    }
+#endif
+    return fwrite(data, 1, len, cputrace_fd) == len ? 0 : -1;
+}
+
+static void cputrace_close(void)
+{
+#ifdef HAVE_ZLIB
+    if (cputrace_gzfd != NULL) {
+        gzclose(cputrace_gzfd);
+        cputrace_gzfd = NULL;
+    }
+#endif
+    if (cputrace_fd != NULL) {
+        fclose(cputrace_fd);
+        cputrace_fd = NULL;
+    }
+
+    lib_free(cputrace_buffer);
+    cputrace_buffer = NULL;
+    lib_free(cputrace_name);
+    cputrace_name = NULL;
+
+    monitor_cputrace_enabled = 0;
+}
+
+static int cputrace_flush(void)
+{
+    int retval;
+
+    retval = cputrace_write(cputrace_buffer, cputrace_buffer_len);
+    cputrace_buffer_len = 0;
+    return retval;
+}
+
+static uint8_t cputrace_peek(int mem, unsigned int addr)
+{
+    monitor_interface_t *mi = mon_interfaces[mem];
+
+    return mi->mem_bank_peek(0, (uint16_t)addr, mi->context);
+}
+
+static unsigned int cputrace_peek_ptr(int mem, unsigned int addr)
+{
+    return cputrace_peek(mem, addr) | (cputrace_peek(mem, (addr + 1) & 0xff) << 8);
+}
+
+void monitor_cputrace_store(CLOCK clk, int mem, unsigned int addr,
+                            unsigned int op, unsigned int p1, unsigned int p2,
+                            uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
+                            uint8_t reg_sp, unsigned int reg_st)
+{
+    uint8_t rec[CPUTRACE_RECORD_SIZE];
+    unsigned int ea = 0;
+    int has_ea = 1;
+
+    op &= 0xff;
+    p1 &= 0xff;
+    p2 &= 0xff;
+
+    if (cputrace_can_peek[mem]) {
+        /* The cores fetch the MSB of JSR only after pushing the return
+           address.  */
+        if (op == 0x20) {
+            p2 = cputrace_peek(mem, (addr + 2) & 0xffff);
+        }
+
+        switch (cputrace_mode[mem][op]) {
+            case ASM_ADDR_MODE_ZERO_PAGE:
+            case ASM_ADDR_MODE_ZERO_PAGE_RELATIVE:
+                ea = p1;
+                break;
+            case ASM_ADDR_MODE_ZERO_PAGE_X:
+                ea = (p1 + reg_x) & 0xff;
+                break;
+            case ASM_ADDR_MODE_ZERO_PAGE_Y:
+                ea = (p1 + reg_y) & 0xff;
+                break;
+            case ASM_ADDR_MODE_ABSOLUTE:
+            case ASM_ADDR_MODE_ABS_INDIRECT:
+                ea = p1 | (p2 << 8);
+                break;
+            case ASM_ADDR_MODE_ABSOLUTE_X:
+            case ASM_ADDR_MODE_ABS_INDIRECT_X:
+                ea = ((p1 | (p2 << 8)) + reg_x) & 0xffff;
+                break;
+            case ASM_ADDR_MODE_ABSOLUTE_Y:
+                ea = ((p1 | (p2 << 8)) + reg_y) & 0xffff;
+                break;
+            case ASM_ADDR_MODE_INDIRECT_X:
+                ea = cputrace_peek_ptr(mem, (p1 + reg_x) & 0xff);
+                break;
+            case ASM_ADDR_MODE_INDIRECT_Y:
+                ea = (cputrace_peek_ptr(mem, p1) + reg_y) & 0xffff;
+                break;
+            case ASM_ADDR_MODE_INDIRECT:
+                ea = cputrace_peek_ptr(mem, p1);
+                break;
+            default:
+                has_ea = 0;
+                break;
+        }
+    } else {
+        has_ea = 0;
+    }
+
+    rec[0] = (uint8_t)clk;
+    rec[1] = (uint8_t)(clk >> 8);
+    rec[2] = (uint8_t)(clk >> 16);
+    rec[3] = (uint8_t)(clk >> 24);
+    rec[4] = (uint8_t)addr;
+    rec[5] = (uint8_t)(addr >> 8);
+    rec[6] = (uint8_t)mem;
+    rec[7] = (uint8_t)op;
+    rec[8] = (uint8_t)p1;
+    rec[9] = (uint8_t)p2;
+    rec[10] = reg_a;
+    rec[11] = reg_x;
+    rec[12] = reg_y;
+    rec[13] = reg_sp;
+    rec[14] = (uint8_t)reg_st;
+    if (has_ea) {
+        rec[15] = 1;
+        rec[16] = (uint8_t)ea;
+        rec[17] = (uint8_t)(ea >> 8);
+        rec[18] = cputrace_peek(mem, ea);
+    } else {
+        rec[15] = 0;
+        rec[16] = 0;
+        rec[17] = 0;
+        rec[18] = 0;
+    }
+    rec[19] = 0;
+
+    /* Peeking I/O can run the drive CPUs, which trace into the same
+       buffer, so the record is only appended when complete.  */
+    if (cputrace_buffer == NULL) {
+        return;
+    }
+    if (cputrace_buffer_len == CPUTRACE_BUFFER_SIZE) {
+        if (cputrace_flush() < 0) {
+            log_error(LOG_DEFAULT, "Cannot write CPU trace `%s'.", cputrace_name);
+            cputrace_close();
+            return;
+        }
+    }
+    memcpy(cputrace_buffer + cputrace_buffer_len, rec, CPUTRACE_RECORD_SIZE);
+    cputrace_buffer_len += CPUTRACE_RECORD_SIZE;
+    cputrace_records++;
+}
+
+/* Look up the addressing modes of the 65xx CPUs, the cores only pass
+   the opcode bytes.  */
+static void cputrace_init_modes(void)
+{
+    int mem;
+    unsigned int op;
+
+    for (mem = 0; mem < NUM_MEMSPACES; mem++) {
+        monitor_cpu_type_t *cpu = monitor_cpu_for_memspace[mem];
+        int use_modes = 0;
+
+        cputrace_can_peek[mem] = (mon_interfaces[mem] != NULL
+                                  && mon_interfaces[mem]->mem_bank_peek != NULL);
+
+        if (cputrace_can_peek[mem] && cpu != NULL) {
+            switch (cpu->cpu_type) {
+                case CPU_6502:
+                case CPU_WDC65C02:
+                case CPU_R65C02:
+                case CPU_65SC02:
+                    use_modes = 1;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        for (op = 0; op < 0x100; op++) {
+            const asm_opcode_info_t *info = NULL;
+
+            if (use_modes) {
+                info = cpu->asm_opcode_info_get(op, 0, 0);
+            }
+            cputrace_mode[mem][op] = (uint8_t)(info != NULL ? info->addr_mode : ASM_ADDR_MODE_IMPLIED);
+        }
+    }
+}
+
+void mon_cputrace_start(char *filename)
+{
+    uint8_t header[16];
+#ifdef HAVE_ZLIB
+    char *ext;
+#endif
+    int failed;
+
+    if (cputrace_name != NULL) {
+        mon_out("CPU trace to `%s' already running.\n", cputrace_name);
+        lib_free(filename);
+        return;
+    }
+
+    /* Compressing takes about ten times as long as emulating the
+       instructions, so it is only done when asked for.  */
+#ifdef HAVE_ZLIB
+    ext = util_get_extension(filename);
+    if (ext != NULL && strcasecmp(ext, "gz") == 0) {
+        cputrace_gzfd = gzopen(filename, "wb1");
+        failed = (cputrace_gzfd == NULL);
+    } else
+#endif
+    {
+        cputrace_fd = fopen(filename, MODE_WRITE);
+        failed = (cputrace_fd == NULL);
+    }
+    if (failed) {
+        mon_out("Cannot create `%s'.\n", filename);
+        lib_free(filename);
+        return;
+    }
+
+    cputrace_name = filename;
+    cputrace_buffer = lib_malloc(CPUTRACE_BUFFER_SIZE);
+    cputrace_buffer_len = 0;
+    cputrace_records = 0;
+    cputrace_init_modes();
+
+    memcpy(header, "VICE CPU TRACE", 14);
+    header[14] = CPUTRACE_VERSION;
+    header[15] = CPUTRACE_RECORD_SIZE;
+    if (cputrace_write(header, sizeof(header)) < 0) {
+        mon_out("Cannot write `%s'.\n", filename);
+        cputrace_close();
+        return;
+    }
+
+    monitor_cputrace_enabled = 1;
+    mon_out("Tracing CPU to `%s'.\n", filename);
+}
+
+void mon_cputrace_stop(void)
+{
+    if (cputrace_name == NULL) {
+        mon_out("No CPU trace is running.\n");
+        return;
+    }
+
+    if (cputrace_flush() < 0) {
+        mon_out("Cannot write `%s'.\n", cputrace_name);
+    }
+    mon_out("Wrote %lu instructions to `%s'.\n", cputrace_records, cputrace_name);
+    cputrace_close();
+}
+
+void mon_cputrace_shutdown(void)
+{
+    if (cputrace_name != NULL) {
+        cputrace_flush();
+        cputrace_close();
+    }
+}
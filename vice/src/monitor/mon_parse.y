@@ -71,12 +71,15 @@ extern char *alloca();
 #include "machine.h"
 #include "mon_breakpoint.h"
 #include "mon_command.h"
+#include "mon_coverage.h"
+#include "mon_cputrace.h"
 #include "mon_disassemble.h"
 #include "mon_drive.h"
 #include "mon_file.h"
 #include "mon_memmap.h"
 #include "mon_memory.h"
 #include "mon_register.h"
+#include "mon_reverse.h"
 #include "mon_util.h"
 #include "montypes.h"
 #include "resources.h"
@@ -163,7 +166,9 @@ extern int cur_len, last_len;
 %token CMD_BACKTRACE CMD_SCREENSHOT CMD_PWD CMD_DIR
 %token CMD_RESOURCE_GET CMD_RESOURCE_SET CMD_LOAD_RESOURCES CMD_SAVE_RESOURCES
 %token CMD_ATTACH CMD_DETACH CMD_MON_RESET CMD_TAPECTRL CMD_CARTFREEZE
-%token CMD_CPUHISTORY CMD_MEMMAPZAP CMD_MEMMAPSHOW CMD_MEMMAPSAVE
+%token CMD_REVERSE CMD_REVERSE_STEP CMD_REVERSE_CONTINUE CMD_LAST_CHANGE
+%token CMD_CPUHISTORY CMD_CPUTRACE CMD_MEMMAPZAP CMD_MEMMAPSHOW CMD_MEMMAPSAVE
+%token CMD_COVERAGE CMD_COVERAGEZAP CMD_COVERAGESAVE CMD_COVERAGELOAD
 %token CMD_COMMENT CMD_LIST CMD_STOPWATCH RESET
 %token CMD_EXPORT CMD_AUTOSTART CMD_AUTOLOAD
 %token<str> CMD_LABEL_ASGN
@@ -249,8 +254,26 @@ machine_state_rules: CMD_BANK end_cmd
                      { mon_cpuhistory(-1); }
                    | CMD_CPUHISTORY opt_sep expression end_cmd
                      { mon_cpuhistory($3); }
+                   | CMD_CPUTRACE end_cmd
+                     { mon_cputrace_stop(); }
+                   | CMD_CPUTRACE filename end_cmd
+                     { mon_cputrace_start($2); }
                    | CMD_RETURN end_cmd
                      { mon_instruction_return(); }
+                   | CMD_REVERSE end_cmd
+                     { mon_reverse_set(-1, -1); }
+                   | CMD_REVERSE opt_sep expression end_cmd
+                     { mon_reverse_set($3, -1); }
+                   | CMD_REVERSE opt_sep expression opt_sep expression end_cmd
+                     { mon_reverse_set($3, $5); }
+                   | CMD_REVERSE_STEP end_cmd
+                     { mon_reverse_step(-1); }
+                   | CMD_REVERSE_STEP opt_sep expression end_cmd
+                     { mon_reverse_step($3); }
+                   | CMD_REVERSE_CONTINUE end_cmd
+                     { mon_reverse_continue(); }
+                   | CMD_LAST_CHANGE address end_cmd
+                     { mon_reverse_last_change($2); }
                    | CMD_DUMP filename end_cmd
                      { machine_write_snapshot($2,0,0,0); /* FIXME */ }
                    | CMD_UNDUMP filename end_cmd
@@ -372,6 +395,16 @@ memory_rules: CMD_MOVE address_range opt_sep address end_cmd
               { mon_memmap_show($3,$4[0],$4[1]); }
             | CMD_MEMMAPSAVE filename opt_sep expression end_cmd
               { mon_memmap_save($2,$4); }
+            | CMD_COVERAGE end_cmd
+              { mon_coverage_show(); }
+            | CMD_COVERAGE TOGGLE end_cmd
+              { mon_coverage_switch($2); }
+            | CMD_COVERAGEZAP end_cmd
+              { mon_coverage_zap(); }
+            | CMD_COVERAGESAVE filename end_cmd
+              { mon_coverage_save($2); }
+            | CMD_COVERAGELOAD filename end_cmd
+              { mon_coverage_load($2); }
             ;
 
 checkpoint_rules: CMD_BREAK opt_mem_op address_opt_range opt_if_cond_expr end_cmd
@@ -1051,7 +1084,7 @@ index_ureg:
 
 %%
 
-void parse_and_execute_line(char *input)
+int parse_and_execute_line(char *input)
 {
    char *temp_buf;
    int i, rc;
@@ -1126,6 +1159,7 @@ void parse_and_execute_line(char *input)
    }
    lib_free(temp_buf);
    free_buffer();
+   return rc;
 }
 
 static int yyerror(char *s)
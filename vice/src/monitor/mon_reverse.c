@@ -0,0 +1,652 @@
+/*
+ * mon_reverse.c - The VICE built-in monitor, reverse execution.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* While reverse execution is enabled, a snapshot of the machine (a
+   "keyframe") is kept in memory every `reverse_interval' cycles of the
+   computer CPU.  To go back in time, the last keyframe before the wanted
+   point is restored and the machine runs forward again, in warp mode,
+   until it gets there.  This relies on the emulation being deterministic.
+   The host input (keyboard, joystick, datasette keys, resets) is recorded
+   into `reverse_input' with the event history code and replayed at the
+   same clock.
+
+   Points in time are instruction boundaries, identified by the CPU clock.
+   The commands first scan the history one keyframe segment at a time,
+   newest first, to find the boundary they want, then replay to it.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "clkguard.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "mon_breakpoint.h"
+#include "mon_register.h"
+#include "mon_reverse.h"
+#include "monitor.h"
+#include "montypes.h"
+#include "resources.h"
+#include "snapshot.h"
+#include "types.h"
+#include "vice-event.h"
+
+#define REVERSE_DEFAULT_BUDGET  (64 * 1024)     /* KB */
+
+enum reverse_mode_e {
+    REVERSE_OFF,
+    REVERSE_RECORD,     /* running normally, keyframes are written */
+    REVERSE_SCAN,       /* scanning the segment after `scan_keyframe' */
+    REVERSE_REPLAY      /* running until `replay_target' */
+};
+
+enum reverse_scan_e {
+    SCAN_STEP,          /* find the boundary `step_count' instructions back */
+    SCAN_BREAK,         /* find the last breakpoint hit */
+    SCAN_CHANGE         /* find the last change of `change_addr' */
+};
+
+typedef struct keyframe_s {
+    CLOCK clk;
+    uint8_t *data;
+    size_t size;
+} keyframe_t;
+
+static int reverse_mode = REVERSE_OFF;
+static CLOCK reverse_interval;
+static size_t reverse_budget;
+static snapshot_memory_t *reverse_snapshot = NULL;
+static unsigned int reverse_read_count;
+static int reverse_restored;
+static int reverse_warp;
+static int reverse_guard_added = 0;
+
+/* Keyframes, oldest first.  */
+static keyframe_t *keyframes = NULL;
+static int keyframe_count = 0;
+static int keyframe_max = 0;
+static size_t keyframe_bytes = 0;
+static CLOCK last_keyframe_clk;
+
+static int scan_kind;
+static int scan_keyframe;
+static CLOCK scan_end;
+static CLOCK scan_origin;
+static CLOCK scan_found_clk;
+static int scan_found;
+
+/* Clocks of the last `step_ring_size' boundaries in the segment.  */
+static CLOCK *step_ring = NULL;
+static unsigned int step_ring_size;
+static unsigned int step_ring_pos;
+static unsigned int step_ring_fill;
+static unsigned int step_count;
+
+static uint16_t change_addr;
+static uint8_t change_value;
+static CLOCK change_clk;
+
+static CLOCK replay_target;
+
+/* Host input since the oldest keyframe; `replay_input' is the next event
+   to play back while scanning or replaying.  */
+static event_list_state_t reverse_input;
+static event_list_t *replay_input;
+static alarm_t *reverse_input_alarm = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+static void reverse_input_free(event_list_t *curr)
+{
+    event_list_t *next;
+
+    while (curr != NULL) {
+        next = curr->next;
+        lib_free(curr->data);
+        lib_free(curr);
+        curr = next;
+    }
+}
+
+/* Forget the input before `clk'; the oldest keyframe holds its effect.  */
+static void reverse_input_drop_before(CLOCK clk)
+{
+    event_list_t *curr;
+
+    while (reverse_input.base != reverse_input.current
+           && reverse_input.base->clk < clk) {
+        curr = reverse_input.base;
+        reverse_input.base = curr->next;
+        lib_free(curr->data);
+        lib_free(curr);
+    }
+}
+
+/* Forget the input after `clk', it belongs to another future now.  */
+static void reverse_input_drop_after(CLOCK clk)
+{
+    event_list_t *curr;
+
+    for (curr = reverse_input.base; curr != reverse_input.current; curr = curr->next) {
+        if (curr->clk > clk) {
+            reverse_input_free(curr->next);
+            lib_free(curr->data);
+            memset(curr, 0, sizeof(event_list_t));
+            curr->type = EVENT_LIST_END;
+            reverse_input.current = curr;
+            break;
+        }
+    }
+}
+
+static void reverse_input_clear(void)
+{
+    reverse_input_drop_before(CLOCK_MAX);
+}
+
+static void reverse_input_schedule(void)
+{
+    if (replay_input != reverse_input.current) {
+        alarm_set(reverse_input_alarm, replay_input->clk);
+    } else {
+        alarm_unset(reverse_input_alarm);
+    }
+}
+
+static void reverse_input_alarm_handler(CLOCK offset, void *data)
+{
+    alarm_unset(reverse_input_alarm);
+
+    while (replay_input != reverse_input.current
+           && replay_input->clk <= maincpu_clk - offset) {
+        event_playback_input(replay_input);
+        replay_input = replay_input->next;
+    }
+    reverse_input_schedule();
+}
+
+static void reverse_drop_keyframe(int i)
+{
+    keyframe_bytes -= keyframes[i].size;
+    lib_free(keyframes[i].data);
+    keyframe_count--;
+    memmove(&keyframes[i], &keyframes[i + 1],
+            (keyframe_count - i) * sizeof(keyframe_t));
+}
+
+static void reverse_clear_keyframes(void)
+{
+    while (keyframe_count > 0) {
+        reverse_drop_keyframe(keyframe_count - 1);
+    }
+    reverse_input_clear();
+}
+
+static int reverse_write_keyframe(void)
+{
+    const uint8_t *snap;
+    unsigned int size;
+    CLOCK clk = maincpu_clk;
+
+    if (machine_write_snapshot_memory(reverse_snapshot, 0, 0, 0) < 0) {
+        return -1;
+    }
+    snap = snapshot_memory_get_data(reverse_snapshot, &size);
+
+    /* anything recorded after this point belongs to another future now */
+    while (keyframe_count > 0 && keyframes[keyframe_count - 1].clk >= clk) {
+        reverse_drop_keyframe(keyframe_count - 1);
+    }
+
+    if (keyframe_count == keyframe_max) {
+        keyframe_max = keyframe_max ? keyframe_max * 2 : 64;
+        keyframes = lib_realloc(keyframes, keyframe_max * sizeof(keyframe_t));
+    }
+    keyframes[keyframe_count].clk = clk;
+    keyframes[keyframe_count].data = lib_malloc(size);
+    memcpy(keyframes[keyframe_count].data, snap, size);
+    keyframes[keyframe_count].size = size;
+    keyframe_count++;
+    keyframe_bytes += size;
+
+    while (keyframe_bytes > reverse_budget && keyframe_count > 1) {
+        reverse_drop_keyframe(0);
+    }
+    reverse_input_drop_before(keyframes[0].clk);
+
+    last_keyframe_clk = clk;
+    return 0;
+}
+
+static int reverse_restore(int i)
+{
+    snapshot_memory_set_data(reverse_snapshot, keyframes[i].data,
+                             (unsigned int)keyframes[i].size);
+    if (machine_read_snapshot_memory(reverse_snapshot, 0) < 0) {
+        mon_out("Cannot restore the machine state at clock %u.\n",
+                (unsigned int)keyframes[i].clk);
+        return -1;
+    }
+
+    reverse_restored = 1;
+    reverse_read_count = snapshot_get_read_count();
+    last_keyframe_clk = keyframes[i].clk;
+
+    /* The input at the keyframe clock was handled before it was written.
+       The host input must not get into the list while it is replayed.  */
+    event_record_input_list(NULL);
+    for (replay_input = reverse_input.base;
+         replay_input != reverse_input.current && replay_input->clk <= keyframes[i].clk;
+         replay_input = replay_input->next) {
+    }
+    reverse_input_schedule();
+
+    /* the interrupt state comes from the snapshot */
+    interrupt_monitor_trap_on(mon_interfaces[e_comp_space]->int_status);
+    return 0;
+}
+
+/* A snapshot that was not one of ours has been read, the history no longer
+   leads to the current state.  */
+static void reverse_check_history(void)
+{
+    if (snapshot_get_read_count() != reverse_read_count) {
+        reverse_clear_keyframes();
+        reverse_read_count = snapshot_get_read_count();
+        last_keyframe_clk = maincpu_clk - reverse_interval;
+    }
+}
+
+static void reverse_clk_overflow_callback(CLOCK sub, void *data)
+{
+    if (reverse_mode == REVERSE_OFF) {
+        return;
+    }
+
+    /* The keyframes still hold the old clock values.  */
+    if (keyframe_count > 0) {
+        log_message(LOG_DEFAULT, "Monitor: clock overflow, reverse execution history cleared.");
+    }
+    reverse_clear_keyframes();
+    last_keyframe_clk = maincpu_clk - reverse_interval;
+
+    if (reverse_mode != REVERSE_RECORD) {
+        reverse_mode = REVERSE_RECORD;
+        resources_set_int("WarpMode", reverse_warp);
+        alarm_unset(reverse_input_alarm);
+        event_record_input_list(&reverse_input);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static unsigned int reverse_get_pc(void)
+{
+    return (monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC);
+}
+
+/* Stop at the current boundary and enter the monitor.  */
+static void reverse_finish(void)
+{
+    reverse_mode = REVERSE_RECORD;
+    resources_set_int("WarpMode", reverse_warp);
+
+    alarm_unset(reverse_input_alarm);
+    reverse_input_drop_after(maincpu_clk);
+    event_record_input_list(&reverse_input);
+    reverse_restored = 1;
+
+    lib_free(step_ring);
+    step_ring = NULL;
+
+    monitor_disassemble_on_entry();
+    monitor_startup(e_comp_space);
+}
+
+static void reverse_goto(int i, CLOCK target)
+{
+    if (reverse_restore(i) < 0 || target <= keyframes[i].clk) {
+        reverse_finish();
+        return;
+    }
+
+    replay_target = target;
+    reverse_mode = REVERSE_REPLAY;
+}
+
+static void reverse_scan_boundary(CLOCK clk)
+{
+    uint8_t value;
+
+    switch (scan_kind) {
+        case SCAN_STEP:
+            step_ring[step_ring_pos] = clk;
+            step_ring_pos = (step_ring_pos + 1) % step_ring_size;
+            step_ring_fill++;
+            break;
+        case SCAN_BREAK:
+            if (mon_breakpoint_is_stop_point(e_comp_space, reverse_get_pc())) {
+                scan_found = 1;
+                scan_found_clk = clk;
+            }
+            break;
+        case SCAN_CHANGE:
+            value = mon_get_mem_val(e_comp_space, change_addr);
+            if (value != change_value) {
+                /* changed by the instruction at the previous boundary */
+                scan_found = 1;
+                scan_found_clk = change_clk;
+                change_value = value;
+            }
+            change_clk = clk;
+            break;
+    }
+}
+
+static int reverse_scan_segment(int i)
+{
+    if (reverse_restore(i) < 0) {
+        return -1;
+    }
+
+    scan_keyframe = i;
+    scan_found = 0;
+    step_ring_pos = 0;
+    step_ring_fill = 0;
+
+    if (scan_kind == SCAN_CHANGE) {
+        change_value = mon_get_mem_val(e_comp_space, change_addr);
+        change_clk = keyframes[i].clk;
+    } else {
+        reverse_scan_boundary(keyframes[i].clk);
+    }
+
+    reverse_mode = REVERSE_SCAN;
+    return 0;
+}
+
+/* Reached `scan_end', the boundary at which the previous segment starts.  */
+static void reverse_scan_done(CLOCK clk)
+{
+    int i;
+
+    if (scan_kind == SCAN_CHANGE) {
+        reverse_scan_boundary(clk);
+    } else if (scan_kind == SCAN_STEP) {
+        if (step_ring_fill >= step_count) {
+            scan_found = 1;
+            scan_found_clk = step_ring[(step_ring_pos + step_ring_size - step_count)
+                                       % step_ring_size];
+        } else {
+            step_count -= step_ring_fill;
+        }
+    }
+
+    if (scan_found) {
+        if (scan_kind == SCAN_CHANGE) {
+            mon_out("$%04x was last changed by this instruction:\n", change_addr);
+        }
+        reverse_goto(scan_keyframe, scan_found_clk);
+        return;
+    }
+
+    if (scan_keyframe > 0) {
+        scan_end = keyframes[scan_keyframe].clk;
+        if (reverse_scan_segment(scan_keyframe - 1) < 0) {
+            reverse_finish();
+        }
+        return;
+    }
+
+    switch (scan_kind) {
+        case SCAN_STEP:
+            mon_out("Reached the start of the history.\n");
+            reverse_goto(0, keyframes[0].clk);
+            return;
+        case SCAN_BREAK:
+            mon_out("No breakpoint was hit in the history.\n");
+            break;
+        case SCAN_CHANGE:
+            mon_out("$%04x did not change in the history.\n", change_addr);
+            break;
+    }
+
+    /* back to where the command was given */
+    for (i = keyframe_count - 1; i > 0 && keyframes[i].clk > scan_origin; i--) {
+    }
+    reverse_goto(i, scan_origin);
+}
+
+/* called by cpu core, returns non-zero if the CPU registers have to be
+   imported again */
+int monitor_check_reverse(void)
+{
+    CLOCK clk = maincpu_clk;
+
+    reverse_restored = 0;
+
+    switch (reverse_mode) {
+        case REVERSE_RECORD:
+            if (clk - last_keyframe_clk >= reverse_interval
+                || snapshot_get_read_count() != reverse_read_count) {
+                reverse_check_history();
+                if (reverse_write_keyframe() < 0) {
+                    log_error(LOG_DEFAULT, "Monitor: cannot write keyframe, reverse execution disabled.");
+                    mon_reverse_set(0, 0);
+                }
+            }
+            break;
+        case REVERSE_SCAN:
+            if (clk >= scan_end) {
+                reverse_scan_done(clk);
+            } else {
+                reverse_scan_boundary(clk);
+            }
+            break;
+        case REVERSE_REPLAY:
+            if (clk >= replay_target) {
+                if (clk != replay_target) {
+                    mon_out("Replay missed the target boundary, the emulation is not deterministic here.\n");
+                }
+                reverse_finish();
+            }
+            break;
+    }
+
+    return reverse_restored;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void reverse_show(void)
+{
+    if (reverse_mode == REVERSE_OFF) {
+        mon_out("Reverse execution is off.\n");
+        return;
+    }
+
+    mon_out("Keyframe every %u cycles, %d keyframes using %u of %u KB.\n",
+            (unsigned int)reverse_interval, keyframe_count,
+            (unsigned int)(keyframe_bytes / 1024), (unsigned int)(reverse_budget / 1024));
+    if (keyframe_count > 0) {
+        mon_out("History goes back %u cycles.\n",
+                (unsigned int)(maincpu_clk - keyframes[0].clk));
+    }
+}
+
+void mon_reverse_set(int interval, int budget)
+{
+    if (interval < 0) {
+        reverse_show();
+        return;
+    }
+
+    if (interval == 0) {
+        if (reverse_mode == REVERSE_OFF) {
+            return;
+        }
+        reverse_mode = REVERSE_OFF;
+        reverse_clear_keyframes();
+        monitor_mask[e_comp_space] &= ~MI_REVERSE;
+        if (!(monitor_mask[e_comp_space] & ~MI_ACCESS)) {
+            interrupt_monitor_trap_off(mon_interfaces[e_comp_space]->int_status);
+        }
+        event_record_input_list(NULL);
+        alarm_unset(reverse_input_alarm);
+        snapshot_memory_destroy(reverse_snapshot);
+        reverse_snapshot = NULL;
+        mon_out("Reverse execution disabled.\n");
+        return;
+    }
+
+    reverse_interval = (CLOCK)interval;
+    if (budget > 0) {
+        reverse_budget = (size_t)budget * 1024;
+    } else if (reverse_mode == REVERSE_OFF) {
+        reverse_budget = REVERSE_DEFAULT_BUDGET * 1024;
+    }
+
+    if (reverse_mode == REVERSE_OFF) {
+        if (!reverse_guard_added) {
+            clk_guard_add_callback(maincpu_clk_guard, reverse_clk_overflow_callback, NULL);
+            reverse_guard_added = 1;
+            event_register_event_list(&reverse_input);
+            reverse_input_alarm = alarm_new(maincpu_alarm_context, "MonitorReverseInput",
+                                            reverse_input_alarm_handler, NULL);
+        }
+        reverse_snapshot = snapshot_memory_create();
+        event_record_input_list(&reverse_input);
+        reverse_read_count = snapshot_get_read_count();
+        reverse_mode = REVERSE_RECORD;
+        /* before the first keyframe, the trap flag is part of the snapshot */
+        monitor_mask[e_comp_space] |= MI_REVERSE;
+        interrupt_monitor_trap_on(mon_interfaces[e_comp_space]->int_status);
+        if (reverse_write_keyframe() < 0) {
+            mon_out("Cannot write keyframe.\n");
+            mon_reverse_set(0, 0);
+            return;
+        }
+    }
+
+    reverse_show();
+}
+
+/* Start scanning backwards from the current boundary.  */
+static void reverse_begin(int kind)
+{
+    CLOCK clk = maincpu_clk;
+    int i;
+
+    if (reverse_mode == REVERSE_OFF) {
+        mon_out("Reverse execution is off, enable it with `reverse'.\n");
+        return;
+    }
+    if (default_memspace != e_comp_space) {
+        mon_out("Reverse execution only works for the computer CPU.\n");
+        return;
+    }
+
+    reverse_check_history();
+
+    for (i = keyframe_count - 1; i >= 0 && keyframes[i].clk >= clk; i--) {
+    }
+    if (i < 0) {
+        mon_out("No history before this point.\n");
+        return;
+    }
+
+    scan_kind = kind;
+    scan_origin = clk;
+    scan_end = clk;
+
+    resources_get_int("WarpMode", &reverse_warp);
+    resources_set_int("WarpMode", 1);
+
+    if (reverse_scan_segment(i) < 0) {
+        reverse_mode = REVERSE_RECORD;
+        resources_set_int("WarpMode", reverse_warp);
+        return;
+    }
+
+    exit_mon = 1;
+}
+
+void mon_reverse_step(int count)
+{
+    if (count < 1) {
+        count = 1;
+    }
+
+    lib_free(step_ring);
+    step_ring_size = (unsigned int)count;
+    step_ring = lib_malloc(step_ring_size * sizeof(CLOCK));
+    step_count = (unsigned int)count;
+
+    mon_out("Stepping back %d instruction(s).\n", count);
+    reverse_begin(SCAN_STEP);
+}
+
+void mon_reverse_continue(void)
+{
+    reverse_begin(SCAN_BREAK);
+}
+
+void mon_reverse_last_change(MON_ADDR addr)
+{
+    mon_evaluate_default_addr(&addr);
+    if (addr_memspace(addr) != e_comp_space) {
+        mon_out("Reverse execution only works for the computer CPU.\n");
+        return;
+    }
+
+    change_addr = addr_location(addr);
+    reverse_begin(SCAN_CHANGE);
+}
+
+int mon_reverse_is_replaying(void)
+{
+    return reverse_mode == REVERSE_SCAN || reverse_mode == REVERSE_REPLAY;
+}
+
+void mon_reverse_shutdown(void)
+{
+    reverse_clear_keyframes();
+    lib_free(keyframes);
+    keyframes = NULL;
+    keyframe_max = 0;
+    lib_free(step_ring);
+    step_ring = NULL;
+    if (reverse_guard_added) {
+        event_record_input_list(NULL);
+        reverse_input_free(reverse_input.base);
+        reverse_input.base = reverse_input.current = NULL;
+    }
+    snapshot_memory_destroy(reverse_snapshot);
+    reverse_snapshot = NULL;
+    reverse_mode = REVERSE_OFF;
+}
@@ -0,0 +1,36 @@
+/*
+ * mon_reverse.h - The VICE built-in monitor, reverse execution.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MON_REVERSE_H
+#define VICE_MON_REVERSE_H
+
+#include "montypes.h"
+
+extern void mon_reverse_set(int interval, int budget);
+extern void mon_reverse_step(int count);
+extern void mon_reverse_continue(void);
+extern void mon_reverse_last_change(MON_ADDR addr);
+extern int mon_reverse_is_replaying(void);
+extern void mon_reverse_shutdown(void);
+
+#endif
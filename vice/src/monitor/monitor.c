@@ -64,6 +64,8 @@
 #include "machine-video.h"
 #include "mem.h"
 #include "mon_breakpoint.h"
+#include "mon_coverage.h"
+#include "mon_cputrace.h"
 #include "mon_disassemble.h"
 #include "mon_memmap.h"
 #include "mon_memory.h"
@@ -75,9 +77,12 @@
 
 #include "mon_parse.h"
 #include "mon_register.h"
+#include "mon_reverse.h"
 #include "mon_ui.h"
 #include "mon_util.h"
 #include "monitor.h"
+#include "mos6510.h"
+#include "monitor_binary.h"
 #include "monitor_network.h"
 #include "montypes.h"
 #include "resources.h"
@@ -1152,6 +1157,7 @@ void monitor_init(monitor_interface_t *maincpu_interface_init,
     }
 
     mon_memmap_init();
+    mon_coverage_init();
 
     if (mon_init_break != -1) {
         mon_breakpoint_add_checkpoint((uint16_t)mon_init_break, BAD_ADDR, TRUE, e_exec, FALSE);
@@ -1187,6 +1193,9 @@ void monitor_shutdown(void)
     }
 
     mon_memmap_shutdown();
+    mon_cputrace_shutdown();
+    mon_reverse_shutdown();
+    mon_coverage_shutdown();
 }
 
 static int monitor_set_initial_breakpoint(const char *param, void *extra_param)
@@ -1246,6 +1255,11 @@ static const cmdline_option_t cmdline_options[] = {
       USE_PARAM_ID, USE_DESCRIPTION_ID,
       IDCLS_P_VALUE, IDCLS_SET_INITIAL_BREAKPOINT,
       NULL, NULL },
+    { "-coverage", CALL_FUNCTION, 1,
+      mon_coverage_set_file, NULL, NULL, NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      N_("<Name>"), N_("Collect coverage maps and merge them into file <Name> on exit") },
 #ifdef ARCHDEP_SEPERATE_MONITOR_WINDOW
     { "-keepmonopen", SET_RESOURCE, 0,
       NULL, NULL, "KeepMonitorOpen", (resource_value_t)1,
@@ -1952,6 +1966,321 @@ int mon_evaluate_conditional(cond_node_t *cnode)
 }
 
 
+/* Conditions of checkpoints are evaluated on every hit, so they are
+   compiled into a flat program for a small stack machine instead of
+   walking the tree.  */
+
+#define COND_STACK_SIZE 32
+
+enum cond_opcode_e {
+    COND_PUSH_CONST,    /* push `value' */
+    COND_PUSH_REG,      /* push register `regid' of `mem' */
+    COND_PUSH_REG8,     /* push the byte at `ptr' while `mem' runs `cpu' */
+    COND_PUSH_REG16,    /* push the word at `ptr' while `mem' runs `cpu' */
+    COND_PUSH_FLAGS,    /* push the status of the 6502 registers at `ptr' */
+    COND_PUSH_MEM,      /* push byte at `value' in bank `bank' */
+    COND_AND,           /* top is 0: jump to `value', else pop */
+    COND_OR,            /* top is not 0: set to 1 and jump, else pop */
+    COND_BOOL,          /* top = (top != 0) */
+    COND_EQU,           /* pop b, pop a, push (a op b) */
+    COND_NEQ,
+    COND_GT,
+    COND_LT,
+    COND_GTE,
+    COND_LTE
+};
+
+typedef struct cond_insn_s {
+    int opcode;
+    int value;
+    int bank;
+    MEMSPACE mem;
+    int regid;
+    const void *ptr;
+    const monitor_cpu_type_t *cpu;
+} cond_insn_t;
+
+struct cond_code_s {
+    cond_insn_t *insn;
+    int count;
+    int size;
+};
+
+static cond_insn_t *cond_emit(cond_code_t *code, int opcode)
+{
+    cond_insn_t *insn;
+
+    if (code->count == code->size) {
+        code->size = code->size ? code->size * 2 : 8;
+        code->insn = lib_realloc(code->insn, code->size * sizeof(cond_insn_t));
+    }
+    insn = &code->insn[code->count++];
+    insn->opcode = opcode;
+    insn->value = 0;
+    insn->bank = 0;
+    insn->mem = e_comp_space;
+    insn->regid = 0;
+    insn->ptr = NULL;
+    insn->cpu = NULL;
+    return insn;
+}
+
+/* Turn a COND_PUSH_REG into a direct read of the register variable.  Only
+   the 6502 registers of the computer are read like this, the drives answer
+   0 when their CPU is not emulated, and other CPUs keep their registers in
+   different structures.  */
+static void cond_resolve_reg(cond_insn_t *insn)
+{
+    const monitor_cpu_type_t *cpu = monitor_cpu_for_memspace[insn->mem];
+    mos6510_regs_t *regs;
+
+    if (insn->mem != e_comp_space || cpu == NULL || cpu->cpu_type != CPU_6502
+        || mon_interfaces[insn->mem] == NULL
+        || mon_interfaces[insn->mem]->cpu_regs == NULL) {
+        return;
+    }
+    regs = mon_interfaces[insn->mem]->cpu_regs;
+
+    switch (insn->regid) {
+        case e_A:
+            insn->opcode = COND_PUSH_REG8;
+            insn->ptr = &regs->a;
+            break;
+        case e_X:
+            insn->opcode = COND_PUSH_REG8;
+            insn->ptr = &regs->x;
+            break;
+        case e_Y:
+            insn->opcode = COND_PUSH_REG8;
+            insn->ptr = &regs->y;
+            break;
+        case e_SP:
+            insn->opcode = COND_PUSH_REG8;
+            insn->ptr = &regs->sp;
+            break;
+        case e_PC:
+            insn->opcode = COND_PUSH_REG16;
+            insn->ptr = &regs->pc;
+            break;
+        case e_FLAGS:
+            insn->opcode = COND_PUSH_FLAGS;
+            insn->ptr = regs;
+            break;
+        default:
+            return;
+    }
+    insn->cpu = cpu;
+}
+
+/* Append the code for `cnode'.  Returns the stack depth needed, or -1 if
+   the tree cannot be compiled.  */
+static int cond_compile_node(cond_code_t *code, cond_node_t *cnode)
+{
+    int depth1, depth2, opcode, jump;
+    cond_insn_t *insn;
+
+    if (cnode->operation == e_INV) {
+        if (cnode->is_reg) {
+            insn = cond_emit(code, COND_PUSH_REG);
+            insn->mem = reg_memspace(cnode->reg_num);
+            insn->regid = reg_regid(cnode->reg_num);
+            cond_resolve_reg(insn);
+        } else if (cnode->banknum >= 0) {
+            insn = cond_emit(code, COND_PUSH_MEM);
+            insn->value = addr_location(cnode->value);
+            insn->bank = cnode->banknum;
+        } else {
+            insn = cond_emit(code, COND_PUSH_CONST);
+            insn->value = cnode->value;
+        }
+        return 1;
+    }
+
+    if (!(cnode->child1 && cnode->child2)) {
+        return -1;
+    }
+
+    switch (cnode->operation) {
+        case e_AND:
+        case e_OR:
+            /* the operands have no side effects, so a short cut is fine */
+            depth1 = cond_compile_node(code, cnode->child1);
+            if (depth1 < 0) {
+                return -1;
+            }
+            jump = code->count;
+            cond_emit(code, cnode->operation == e_AND ? COND_AND : COND_OR);
+            depth2 = cond_compile_node(code, cnode->child2);
+            if (depth2 < 0) {
+                return -1;
+            }
+            cond_emit(code, COND_BOOL);
+            code->insn[jump].value = code->count;
+            return depth1 > depth2 ? depth1 : depth2;
+        case e_EQU:
+            opcode = COND_EQU;
+            break;
+        case e_NEQ:
+            opcode = COND_NEQ;
+            break;
+        case e_GT:
+            opcode = COND_GT;
+            break;
+        case e_LT:
+            opcode = COND_LT;
+            break;
+        case e_GTE:
+            opcode = COND_GTE;
+            break;
+        case e_LTE:
+            opcode = COND_LTE;
+            break;
+        default:
+            return -1;
+    }
+
+    depth1 = cond_compile_node(code, cnode->child1);
+    depth2 = cond_compile_node(code, cnode->child2);
+    if (depth1 < 0 || depth2 < 0) {
+        return -1;
+    }
+    cond_emit(code, opcode);
+    return depth1 > depth2 + 1 ? depth1 : depth2 + 1;
+}
+
+/* Compile `cnode'.  Returns NULL if the tree cannot be compiled, the
+   caller then falls back to mon_evaluate_conditional().  */
+cond_code_t *mon_compile_conditional(cond_node_t *cnode)
+{
+    cond_code_t *code;
+    int depth;
+
+    if (cnode == NULL) {
+        return NULL;
+    }
+
+    code = lib_calloc(1, sizeof(cond_code_t));
+    depth = cond_compile_node(code, cnode);
+    if (depth < 0 || depth > COND_STACK_SIZE) {
+        mon_delete_compiled_conditional(code);
+        return NULL;
+    }
+    return code;
+}
+
+void mon_delete_compiled_conditional(cond_code_t *code)
+{
+    if (code != NULL) {
+        lib_free(code->insn);
+        lib_free(code);
+    }
+}
+
+int mon_evaluate_compiled_conditional(cond_code_t *code)
+{
+    int stack[COND_STACK_SIZE];
+    int sp = -1;
+    int pc = 0;
+
+    while (pc < code->count) {
+        const cond_insn_t *insn = &code->insn[pc++];
+
+        switch (insn->opcode) {
+            case COND_PUSH_CONST:
+                stack[++sp] = insn->value;
+                break;
+            case COND_PUSH_REG8:
+                if (monitor_cpu_for_memspace[insn->mem] == insn->cpu) {
+                    stack[++sp] = *(const uint8_t *)insn->ptr;
+                    break;
+                }
+                /* the CPU of the memspace was changed */
+                stack[++sp] = (monitor_cpu_for_memspace[insn->mem]->mon_register_get_val)
+                                  (insn->mem, insn->regid);
+                break;
+            case COND_PUSH_REG16:
+                if (monitor_cpu_for_memspace[insn->mem] == insn->cpu) {
+                    stack[++sp] = *(const uint16_t *)insn->ptr;
+                    break;
+                }
+                stack[++sp] = (monitor_cpu_for_memspace[insn->mem]->mon_register_get_val)
+                                  (insn->mem, insn->regid);
+                break;
+            case COND_PUSH_FLAGS:
+                if (monitor_cpu_for_memspace[insn->mem] == insn->cpu) {
+                    const mos6510_regs_t *regs = insn->ptr;
+
+                    stack[++sp] = MOS6510_REGS_GET_FLAGS(regs)
+                                  | MOS6510_REGS_GET_SIGN(regs)
+                                  | (MOS6510_REGS_GET_ZERO(regs) << 1);
+                    break;
+                }
+                stack[++sp] = (monitor_cpu_for_memspace[insn->mem]->mon_register_get_val)
+                                  (insn->mem, insn->regid);
+                break;
+            case COND_PUSH_REG:
+                stack[++sp] = (monitor_cpu_for_memspace[insn->mem]->mon_register_get_val)
+                                  (insn->mem, insn->regid);
+                break;
+            case COND_PUSH_MEM:
+                {
+                    int old_sidefx = sidefx;
+
+                    /* peek, like mon_evaluate_conditional() */
+                    sidefx = 0;
+                    stack[++sp] = mon_get_mem_val_ex(e_comp_space, insn->bank,
+                                                     (uint16_t)insn->value);
+                    sidefx = old_sidefx;
+                }
+                break;
+            case COND_AND:
+                if (stack[sp] == 0) {
+                    pc = insn->value;
+                } else {
+                    sp--;
+                }
+                break;
+            case COND_OR:
+                if (stack[sp] != 0) {
+                    stack[sp] = 1;
+                    pc = insn->value;
+                } else {
+                    sp--;
+                }
+                break;
+            case COND_BOOL:
+                stack[sp] = (stack[sp] != 0);
+                break;
+            case COND_EQU:
+                sp--;
+                stack[sp] = (stack[sp] == stack[sp + 1]);
+                break;
+            case COND_NEQ:
+                sp--;
+                stack[sp] = (stack[sp] != stack[sp + 1]);
+                break;
+            case COND_GT:
+                sp--;
+                stack[sp] = (stack[sp] > stack[sp + 1]);
+                break;
+            case COND_LT:
+                sp--;
+                stack[sp] = (stack[sp] < stack[sp + 1]);
+                break;
+            case COND_GTE:
+                sp--;
+                stack[sp] = (stack[sp] >= stack[sp + 1]);
+                break;
+            case COND_LTE:
+                sp--;
+                stack[sp] = (stack[sp] <= stack[sp + 1]);
+                break;
+        }
+    }
+
+    return stack[0];
+}
+
 void mon_delete_conditional(cond_node_t *cnode)
 {
     if (!cnode) {
@@ -1972,6 +2301,10 @@ void mon_delete_conditional(cond_node_t *cnode)
 
 /* *** WATCHPOINTS *** */
 
+/* Computer memory address watched by monitor_watch_access() */
+static uint16_t watch_access_addr;
+static void (*watch_access_func)(void) = NULL;
+
 
 void monitor_watch_push_load_addr(uint16_t addr, MEMSPACE mem)
 {
@@ -1979,10 +2312,22 @@ void monitor_watch_push_load_addr(uint16_t addr, MEMSPACE mem)
         return;
     }
 
+    if (monitor_mask[mem] & MI_COVERAGE) {
+        mon_coverage_store(mem, addr, e_load);
+    }
+
+    if ((monitor_mask[mem] & MI_ACCESS) && addr == watch_access_addr) {
+        watch_access_func();
+    }
+
     if (watch_load_count[mem] == 9) {
         return;
     }
 
+    if (!mon_breakpoint_is_checkpoint(mem, addr, e_load)) {
+        return;
+    }
+
     watch_load_occurred = TRUE;
     watch_load_array[watch_load_count[mem]][mem] = addr;
     watch_load_count[mem]++;
@@ -1994,15 +2339,43 @@ void monitor_watch_push_store_addr(uint16_t addr, MEMSPACE mem)
         return;
     }
 
+    if (monitor_mask[mem] & MI_COVERAGE) {
+        mon_coverage_store(mem, addr, e_store);
+    }
+
+    if ((monitor_mask[mem] & MI_ACCESS) && addr == watch_access_addr) {
+        watch_access_func();
+    }
+
     if (watch_store_count[mem] == 9) {
         return;
     }
 
+    if (!mon_breakpoint_is_checkpoint(mem, addr, e_store)) {
+        return;
+    }
+
     watch_store_occurred = TRUE;
     watch_store_array[watch_store_count[mem]][mem] = addr;
     watch_store_count[mem]++;
 }
 
+/* Call `func' whenever the computer CPU reads or writes `addr', before the
+   access is done.  Unlike checkpoints this does not enter the monitor.
+   An `addr' of -1 removes the hook.  */
+void monitor_watch_access(int addr, void (*func)(void))
+{
+    if (addr < 0 || func == NULL) {
+        watch_access_func = NULL;
+        monitor_mask[e_comp_space] &= ~MI_ACCESS;
+    } else {
+        watch_access_addr = (uint16_t)addr;
+        watch_access_func = func;
+        monitor_mask[e_comp_space] |= MI_ACCESS;
+    }
+    mon_breakpoint_update_state(e_comp_space);
+}
+
 static bool watchpoints_check_loads(MEMSPACE mem, unsigned int lastpc, unsigned int pc)
 {
     bool trap = FALSE;
@@ -2096,13 +2469,20 @@ void monitor_check_icount(uint16_t pc)
         monitor_mask[default_memspace] &= ~MI_STEP;
         disassemble_on_entry = 1;
     }
-    if (!monitor_mask[default_memspace]) {
+    if (!(monitor_mask[default_memspace] & ~MI_ACCESS)) {
         interrupt_monitor_trap_off(mon_interfaces[default_memspace]->int_status);
     }
 
     monitor_startup(e_default_space);
 }
 
+/* Show the current instruction with the registers when the monitor is
+   entered next, like after a single step.  */
+void monitor_disassemble_on_entry(void)
+{
+    disassemble_on_entry = 1;
+}
+
 /* called by cpu core */
 void monitor_check_icount_interrupt(void)
 {
@@ -2123,6 +2503,9 @@ void monitor_check_icount_interrupt(void)
  */
 int monitor_check_breakpoints(MEMSPACE mem, uint16_t addr)
 {
+    if (mon_reverse_is_replaying()) {
+        return 0;
+    }
     return mon_breakpoint_check_checkpoint(mem, addr, 0, e_exec); /* FIXME */
 }
 
@@ -2131,6 +2514,16 @@ void monitor_check_watchpoints(unsigned int lastpc, unsigned int pc)
 {
     unsigned int dnr;
 
+    if (mon_reverse_is_replaying()) {
+        for (dnr = 0; dnr < NUM_MEMSPACES; dnr++) {
+            watch_load_count[dnr] = 0;
+            watch_store_count[dnr] = 0;
+        }
+        watch_load_occurred = FALSE;
+        watch_store_occurred = FALSE;
+        return;
+    }
+
     if (watch_load_occurred) {
         if (watchpoints_check_loads(e_comp_space, lastpc, pc)) {
             monitor_startup(e_comp_space);
@@ -2398,6 +2791,19 @@ void monitor_startup(MEMSPACE mem)
         default_memspace = mem;
     }
 
+    if (monitor_is_binary()) {
+        /* the binary remote monitor takes the place of the console */
+        inside_monitor = TRUE;
+        monitor_trap_triggered = FALSE;
+        disassemble_on_entry = 0;
+        vsync_suspend_speed_eval();
+        monitor_binary_stopped(default_memspace);
+        inside_monitor = FALSE;
+        vsync_suspend_speed_eval();
+        exit_mon = 0;
+        return;
+    }
+
     monitor_open();
     while (!exit_mon) {
         make_prompt(prompt);
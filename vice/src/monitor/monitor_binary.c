@@ -0,0 +1,1177 @@
+/*
+ * monitor_binary.c - Monitor implementation - binary remote protocol.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/*
+    The binary remote monitor listens on its own socket (BinaryMonitorServer,
+    BinaryMonitorServerAddress), next to the text based remote monitor.
+
+    Every request looks like this, all values little endian:
+
+    byte 0:      STX (0x02)
+    byte 1:      API version (0x01)
+    byte 2-5:    length of the body
+    byte 6-9:    request ID, returned in the response
+    byte 10:     command
+    byte 11-:    body
+
+    Every response looks like this:
+
+    byte 0:      STX (0x02)
+    byte 1:      API version (0x01)
+    byte 2-5:    length of the body
+    byte 6:      response type, usually the command of the request
+    byte 7:      error code
+    byte 8-11:   request ID, 0xffffffff for events
+    byte 12-:    body
+
+    Memspaces are 0 for the computer and 1-4 for drive 8-11.  Requests
+    are answered in the order they were sent.  While the machine runs, the
+    socket is polled about every millisecond of emulated time, and requests
+    are handled at the next instruction boundary of the computer CPU after
+    they were received, and the machine keeps running.  Responses are
+    queued and sent without blocking the emulation; a client that stops
+    reading falls behind, and the connection is broken once more than
+    MON_BIN_MAX_SEND bytes are waiting.  When the machine stops (the stop
+    command, a breakpoint or any other reason to enter the monitor), a
+    "stopped" event is sent instead of opening the monitor, and requests
+    are handled until the exit or advance command resumes it.
+
+    Commands (request body -> response body):
+
+    0x01 mem get:      side effects (1), start (2), end (2), memspace (1),
+                       bank (2) -> the bytes from start to end
+    0x02 mem set:      side effects (1), start (2), end (2), memspace (1),
+                       bank (2), the bytes from start to end -> nothing
+                       The side effects byte is reserved and ignored:
+                       the bytes are always written like the monitor's
+                       own commands do, with the side effects of a store.
+    0x11 cp get:       checkpoint number (4) -> checkpoint info
+    0x12 cp set:       start (2), end (2), stop (1), enabled (1),
+                       operation (1: load, 2: store, 4: exec, may be
+                       combined), temporary (1), memspace (1)
+                       -> checkpoint info
+    0x13 cp delete:    checkpoint number (4) -> nothing
+    0x14 cp list:      nothing -> one checkpoint info response for every
+                       checkpoint, then the number of checkpoints (4)
+    0x15 cp toggle:    checkpoint number (4), enabled (1) -> nothing
+    0x22 condition:    checkpoint number (4), length (1), condition as in
+                       the "condition" monitor command -> nothing
+    0x31 regs get:     memspace (1) -> count (2), then for every register
+                       item size (1, always 3), register ID (1), value (2)
+    0x32 regs set:     memspace (1), count (2), then for every register
+                       item size (1, always 3), register ID (1), value (2)
+                       -> as regs get
+    0x71 advance:      step over subroutines (1), count (2) -> nothing
+    0x81 ping:         nothing -> nothing
+    0x82 banks:        memspace (1) -> count (2), then for every bank
+                       item size (1), bank (2), name length (1), name
+    0x83 registers:    memspace (1) -> count (2), then for every register
+                       item size (1), register ID (1), size in bits (1),
+                       name length (1), name
+    0xaa exit:         nothing -> nothing, resumes the machine
+    0xab stop:         nothing -> nothing, stops the machine
+    0xcc reset:        0 soft, 1 hard (1) -> nothing
+
+    A checkpoint info is: number (4), start (2), end (2), stop (1),
+    enabled (1), operation (1), temporary (1), hit count (4), ignore
+    count (4), has condition (1), memspace (1).
+
+    Events:
+
+    0x11 checkpoint info, for every checkpoint hit
+    0x61 JAM, the message
+    0x62 stopped, PC (2) and memspace (1)
+    0x63 resumed, PC (2) and memspace (1)
+    0x64 reset, nothing
+
+    Error codes:
+
+    0x00 ok
+    0x01 the checkpoint does not exist
+    0x02 invalid memspace
+    0x80 the body has the wrong length for the command
+    0x81 an invalid parameter
+    0x82 unsupported API version
+    0x83 unknown command
+    0x84 the command needs the machine to be stopped
+    0x8f the command failed
+*/
+
+#include "vice.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "mon_breakpoint.h"
+#include "mon_register.h"
+#include "monitor.h"
+#include "monitor_binary.h"
+#include "montypes.h"
+#include "resources.h"
+#include "translate.h"
+#include "ui.h"
+#include "uiapi.h"
+#include "util.h"
+#include "vicesocket.h"
+#include "vsyncapi.h"
+
+#ifdef HAVE_NETWORK
+
+#define ASC_STX 0x02
+
+#define MON_BIN_API_VERSION     0x01
+#define MON_BIN_REQUEST_HEADER  11
+#define MON_BIN_RESPONSE_HEADER 12
+#define MON_BIN_EVENT_ID        0xffffffffu
+
+/* largest request body: a mem set of the whole address space */
+#define MON_BIN_MAX_BODY        (8 + 0x10000)
+
+/* responses waiting for a client that does not read */
+#define MON_BIN_MAX_SEND        (16 * 1024 * 1024)
+
+#define MON_BIN_CMD_MEM_GET             0x01
+#define MON_BIN_CMD_MEM_SET             0x02
+#define MON_BIN_CMD_CHECKPOINT_GET      0x11
+#define MON_BIN_CMD_CHECKPOINT_SET      0x12
+#define MON_BIN_CMD_CHECKPOINT_DELETE   0x13
+#define MON_BIN_CMD_CHECKPOINT_LIST     0x14
+#define MON_BIN_CMD_CHECKPOINT_TOGGLE   0x15
+#define MON_BIN_CMD_CONDITION_SET       0x22
+#define MON_BIN_CMD_REGISTERS_GET       0x31
+#define MON_BIN_CMD_REGISTERS_SET       0x32
+#define MON_BIN_CMD_ADVANCE             0x71
+#define MON_BIN_CMD_PING                0x81
+#define MON_BIN_CMD_BANKS_AVAILABLE     0x82
+#define MON_BIN_CMD_REGISTERS_AVAILABLE 0x83
+#define MON_BIN_CMD_EXIT                0xaa
+#define MON_BIN_CMD_STOP                0xab
+#define MON_BIN_CMD_RESET               0xcc
+
+#define MON_BIN_EVENT_JAM       0x61
+#define MON_BIN_EVENT_STOPPED   0x62
+#define MON_BIN_EVENT_RESUMED   0x63
+#define MON_BIN_EVENT_RESET     0x64
+
+#define MON_BIN_ERR_OK                  0x00
+#define MON_BIN_ERR_OBJECT_MISSING      0x01
+#define MON_BIN_ERR_INVALID_MEMSPACE    0x02
+#define MON_BIN_ERR_CMD_INVALID_LENGTH  0x80
+#define MON_BIN_ERR_INVALID_PARAMETER   0x81
+#define MON_BIN_ERR_INVALID_API_VERSION 0x82
+#define MON_BIN_ERR_UNKNOWN_COMMAND     0x83
+#define MON_BIN_ERR_NOT_STOPPED         0x84
+#define MON_BIN_ERR_CMD_FAILURE         0x8f
+
+#define CHECKPOINT_INFO_SIZE    22
+
+static vice_network_socket_t *listen_socket = NULL;
+static vice_network_socket_t *connected_socket = NULL;
+
+static char *binary_server_address = NULL;
+static int binary_enabled = 0;
+
+/* Received data, possibly ending with an incomplete request.  */
+static uint8_t *recv_buffer = NULL;
+static unsigned int recv_len = 0;
+
+/* Responses not yet taken by the socket.  */
+static uint8_t *send_buffer = NULL;
+static unsigned int send_len = 0;
+static unsigned int send_size = 0;
+
+/* Polls the socket while the machine runs.  */
+static alarm_t *binary_poll_alarm = NULL;
+static int binary_poll_pending = 0;
+
+static int binary_trap_pending = 0;
+static int binary_stop_requested = 0;
+static int binary_stopped = 0;
+
+static void put_uint16(uint8_t *p, unsigned int value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put_uint32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static unsigned int get_uint16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_uint32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void monitor_binary_quit(void)
+{
+    if (connected_socket != NULL) {
+        vice_network_socket_close(connected_socket);
+        connected_socket = NULL;
+    }
+
+    lib_free(recv_buffer);
+    recv_buffer = NULL;
+    recv_len = 0;
+    lib_free(send_buffer);
+    send_buffer = NULL;
+    send_len = 0;
+    send_size = 0;
+    binary_stop_requested = 0;
+}
+
+/* Send what the socket takes right now.  */
+static void monitor_binary_flush(void)
+{
+    int count;
+
+    while (connected_socket != NULL && send_len > 0) {
+        count = vice_network_send_nonblocking(connected_socket, send_buffer, send_len);
+        if (count < 0) {
+            log_message(LOG_DEFAULT, "monitor_binary: cannot send, breaking connection");
+            monitor_binary_quit();
+            return;
+        }
+        if (count == 0) {
+            return;
+        }
+        memmove(send_buffer, send_buffer + count, send_len - count);
+        send_len -= count;
+    }
+}
+
+static void monitor_binary_queue(const uint8_t *data, uint32_t length)
+{
+    if (send_len + length > MON_BIN_MAX_SEND) {
+        log_message(LOG_DEFAULT, "monitor_binary: client does not read, breaking connection");
+        monitor_binary_quit();
+        return;
+    }
+
+    if (send_len + length > send_size) {
+        while (send_len + length > send_size) {
+            send_size = send_size ? send_size * 2 : 4096;
+        }
+        send_buffer = lib_realloc(send_buffer, send_size);
+    }
+    memcpy(send_buffer + send_len, data, length);
+    send_len += length;
+}
+
+static void monitor_binary_response(uint8_t type, uint8_t error, uint32_t request_id,
+                                    const uint8_t *body, uint32_t length)
+{
+    uint8_t header[MON_BIN_RESPONSE_HEADER];
+
+    if (connected_socket == NULL) {
+        return;
+    }
+
+    header[0] = ASC_STX;
+    header[1] = MON_BIN_API_VERSION;
+    put_uint32(&header[2], length);
+    header[6] = type;
+    header[7] = error;
+    put_uint32(&header[8], request_id);
+
+    monitor_binary_queue(header, sizeof header);
+    if (length > 0 && connected_socket != NULL) {
+        monitor_binary_queue(body, length);
+    }
+    monitor_binary_flush();
+}
+
+static void monitor_binary_error(uint8_t type, uint8_t error, uint32_t request_id)
+{
+    monitor_binary_response(type, error, request_id, NULL, 0);
+}
+
+static int monitor_binary_memspace(uint8_t value, MEMSPACE *mem)
+{
+    switch (value) {
+        case 0: *mem = e_comp_space; break;
+        case 1: *mem = e_disk8_space; break;
+        case 2: *mem = e_disk9_space; break;
+        case 3: *mem = e_disk10_space; break;
+        case 4: *mem = e_disk11_space; break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+static uint8_t monitor_binary_memspace_id(MEMSPACE mem)
+{
+    return (mem == e_comp_space) ? 0 : (uint8_t)(monitor_diskspace_dnr(mem) + 1);
+}
+
+static unsigned int monitor_binary_get_pc(MEMSPACE mem)
+{
+    return (monitor_cpu_for_memspace[mem]->mon_register_get_val)(mem, e_PC);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void monitor_binary_checkpoint_response(const mon_checkpoint_info_t *info,
+                                               uint32_t request_id)
+{
+    uint8_t body[CHECKPOINT_INFO_SIZE];
+    MEMSPACE mem = addr_memspace(info->start_addr);
+
+    put_uint32(&body[0], info->checknum);
+    put_uint16(&body[4], addr_location(info->start_addr));
+    put_uint16(&body[6], addr_location(info->end_addr));
+    body[8] = info->stop;
+    body[9] = info->enabled;
+    body[10] = (info->check_load ? e_load : 0)
+               | (info->check_store ? e_store : 0)
+               | (info->check_exec ? e_exec : 0);
+    body[11] = info->temporary;
+    put_uint32(&body[12], info->hit_count);
+    put_uint32(&body[16], info->ignore_count);
+    body[20] = info->has_condition;
+    body[21] = monitor_binary_memspace_id(mem);
+
+    monitor_binary_response(MON_BIN_CMD_CHECKPOINT_GET, MON_BIN_ERR_OK, request_id,
+                            body, sizeof body);
+}
+
+static void monitor_binary_event_pc(uint8_t type, MEMSPACE mem)
+{
+    uint8_t body[3];
+
+    put_uint16(&body[0], monitor_binary_get_pc(mem));
+    body[2] = monitor_binary_memspace_id(mem);
+    monitor_binary_response(type, MON_BIN_ERR_OK, MON_BIN_EVENT_ID, body, sizeof body);
+}
+
+static void monitor_binary_registers_response(MEMSPACE mem, uint8_t type, uint32_t request_id)
+{
+    mon_reg_list_t *list;
+    uint8_t *body;
+    unsigned int count, i;
+
+    list = mon_register_list_get(mem);
+    for (count = 0; list[count].name != NULL; count++) {
+    }
+
+    body = lib_malloc(2 + count * 4);
+    put_uint16(body, count);
+    for (i = 0; i < count; i++) {
+        body[2 + i * 4] = 3;
+        body[3 + i * 4] = (uint8_t)i;
+        put_uint16(&body[4 + i * 4], list[i].val);
+    }
+
+    monitor_binary_response(type, MON_BIN_ERR_OK, request_id, body, 2 + count * 4);
+    lib_free(body);
+    lib_free(list);
+}
+
+static int monitor_binary_cmd_mem(uint8_t command, uint32_t request_id,
+                                  const uint8_t *body, uint32_t length)
+{
+    unsigned int start, end, count, i;
+    int bank, old_bank;
+    MEMSPACE mem;
+
+    if (length < 8) {
+        return MON_BIN_ERR_CMD_INVALID_LENGTH;
+    }
+
+    start = get_uint16(&body[1]);
+    end = get_uint16(&body[3]);
+    bank = (int)get_uint16(&body[6]);
+    if (start > end) {
+        return MON_BIN_ERR_INVALID_PARAMETER;
+    }
+    count = end - start + 1;
+
+    if (monitor_binary_memspace(body[5], &mem) < 0) {
+        return MON_BIN_ERR_INVALID_MEMSPACE;
+    }
+    if (mon_interfaces[mem]->mem_bank_list != NULL
+        && mon_get_bank_name_for_bank(mem, bank) == NULL) {
+        return MON_BIN_ERR_INVALID_PARAMETER;
+    }
+
+    if (command == MON_BIN_CMD_MEM_GET) {
+        uint8_t *data;
+        int old_sidefx = sidefx;
+
+        if (length != 8) {
+            return MON_BIN_ERR_CMD_INVALID_LENGTH;
+        }
+
+        data = lib_malloc(count);
+        sidefx = body[0] ? 1 : 0;
+        for (i = 0; i < count; i++) {
+            data[i] = mon_get_mem_val_ex(mem, bank, (uint16_t)(start + i));
+        }
+        sidefx = old_sidefx;
+
+        monitor_binary_response(command, MON_BIN_ERR_OK, request_id, data, count);
+        lib_free(data);
+        return MON_BIN_ERR_OK;
+    }
+
+    if (length != 8 + count) {
+        return MON_BIN_ERR_CMD_INVALID_LENGTH;
+    }
+
+    /* body[0] is ignored, there is no store without side effects.  */
+    old_bank = mon_interfaces[mem]->current_bank;
+    mon_interfaces[mem]->current_bank = bank;
+    for (i = 0; i < count; i++) {
+        mon_set_mem_val(mem, (uint16_t)(start + i), body[8 + i]);
+    }
+    mon_interfaces[mem]->current_bank = old_bank;
+
+    monitor_binary_error(command, MON_BIN_ERR_OK, request_id);
+    return MON_BIN_ERR_OK;
+}
+
+static int monitor_binary_cmd_checkpoint_set(uint32_t request_id,
+                                             const uint8_t *body, uint32_t length)
+{
+    mon_checkpoint_info_t info;
+    unsigned int start, end;
+    int checknum, old_exit_mon;
+    MEMSPACE mem;
+    MEMORY_OP op;
+
+    if (length != 9) {
+        return MON_BIN_ERR_CMD_INVALID_LENGTH;
+    }
+
+    start = get_uint16(&body[0]);
+    end = get_uint16(&body[2]);
+    op = (MEMORY_OP)(body[6] & (e_load | e_store | e_exec));
+    if (start > end || op == 0) {
+        return MON_BIN_ERR_INVALID_PARAMETER;
+    }
+    if (monitor_binary_memspace(body[8], &mem) < 0) {
+        return MON_BIN_ERR_INVALID_MEMSPACE;
+    }
+
+    /* a temporary checkpoint would leave the monitor, like "until" */
+    old_exit_mon = exit_mon;
+    checknum = mon_breakpoint_add_checkpoint_quiet(new_addr(mem, start), new_addr(mem, end),
+                                                   body[4] ? TRUE : FALSE, op,
+                                                   body[7] ? TRUE : FALSE);
+    exit_mon = old_exit_mon;
+
+    if (!body[5]) {
+        mon_breakpoint_switch_checkpoint(e_OFF, checknum);
+    }
+
+    mon_breakpoint_get_info(checknum, &info);
+    monitor_binary_checkpoint_response(&info, request_id);
+    return MON_BIN_ERR_OK;
+}
+
+static int monitor_binary_cmd_condition_set(uint32_t request_id,
+                                            const uint8_t *body, uint32_t length)
+{
+    mon_checkpoint_info_t info;
+    char *text, *line;
+    int checknum, error;
+
+    if (length < 5 || length != 5 + (uint32_t)body[4]) {
+        return MON_BIN_ERR_CMD_INVALID_LENGTH;
+    }
+
+    checknum = (int)get_uint32(&body[0]);
+    if (!mon_breakpoint_get_info(checknum, &info)) {
+        return MON_BIN_ERR_OBJECT_MISSING;
+    }
+
+    /* let the monitor parser do the work */
+    text = lib_malloc(body[4] + 1);
+    memcpy(text, &body[5], body[4]);
+    text[body[4]] = 0;
+    line = lib_msprintf("condition %d if %s", checknum, text);
+    error = parse_and_execute_line(line);
+    lib_free(line);
+    lib_free(text);
+
+    if (error != 0) {
+        return MON_BIN_ERR_INVALID_PARAMETER;
+    }
+
+    monitor_binary_error(MON_BIN_CMD_CONDITION_SET, MON_BIN_ERR_OK, request_id);
+    return MON_BIN_ERR_OK;
+}
+
+static int monitor_binary_cmd_registers_set(uint32_t request_id,
+                                            const uint8_t *body, uint32_t length)
+{
+    mon_reg_list_t *list;
+    unsigned int count, num, i;
+    MEMSPACE mem;
+    int ok = 1;
+
+    if (length < 3) {
+        return MON_BIN_ERR_CMD_INVALID_LENGTH;
+    }
+    if (monitor_binary_memspace(body[0], &mem) < 0) {
+        return MON_BIN_ERR_INVALID_MEMSPACE;
+    }
+    count = get_uint16(&body[1]);
+    if (length != 3 + count * 4) {
+        return MON_BIN_ERR_CMD_INVALID_LENGTH;
+    }
+
+    list = mon_register_list_get(mem);
+    for (num = 0; list[num].name != NULL; num++) {
+    }
+
+    for (i = 0; i < count; i++) {
+        const uint8_t *item = &body[3 + i * 4];
+
+        if (item[0] != 3 || item[1] >= num) {
+            ok = 0;
+            continue;
+        }
+        if (list[item[1]].flags & MON_REGISTER_IS_MEMORY) {
+            int old_bank = mon_interfaces[mem]->current_bank;
+
+            if (mon_interfaces[mem]->mem_bank_from_name != NULL) {
+                mon_interfaces[mem]->current_bank = mon_interfaces[mem]->mem_bank_from_name("cpu");
+            }
+            mon_set_mem_val(mem, (uint16_t)list[item[1]].extra, (uint8_t)get_uint16(&item[2]));
+            mon_interfaces[mem]->current_bank = old_bank;
+        } else {
+            (monitor_cpu_for_memspace[mem]->mon_register_set_val)(mem, list[item[1]].id,
+                                                                  (uint16_t)get_uint16(&item[2]));
+        }
+    }
+    lib_free(list);
+
+    if (!ok) {
+        return MON_BIN_ERR_INVALID_PARAMETER;
+    }
+
+    monitor_binary_registers_response(mem, MON_BIN_CMD_REGISTERS_SET, request_id);
+    return MON_BIN_ERR_OK;
+}
+
+static int monitor_binary_cmd_banks_available(uint32_t request_id, MEMSPACE mem)
+{
+    const char **names = NULL;
+    uint8_t *body;
+    unsigned int count = 0, size = 2, i;
+
+    if (mon_interfaces[mem]->mem_bank_list != NULL) {
+        names = mon_interfaces[mem]->mem_bank_list();
+        for (count = 0; names[count] != NULL; count++) {
+            size += 4 + (unsigned int)strlen(names[count]);
+        }
+    }
+
+    body = lib_malloc(size);
+    put_uint16(body, count);
+    size = 2;
+    for (i = 0; i < count; i++) {
+        unsigned int len = (unsigned int)strlen(names[i]);
+
+        body[size] = (uint8_t)(3 + len);
+        put_uint16(&body[size + 1], mon_interfaces[mem]->mem_bank_from_name(names[i]));
+        body[size + 3] = (uint8_t)len;
+        memcpy(&body[size + 4], names[i], len);
+        size += 4 + len;
+    }
+
+    monitor_binary_response(MON_BIN_CMD_BANKS_AVAILABLE, MON_BIN_ERR_OK, request_id, body, size);
+    lib_free(body);
+    return MON_BIN_ERR_OK;
+}
+
+static int monitor_binary_cmd_registers_available(uint32_t request_id, MEMSPACE mem)
+{
+    mon_reg_list_t *list;
+    uint8_t *body;
+    unsigned int count, size = 2, i;
+
+    list = mon_register_list_get(mem);
+    for (count = 0; list[count].name != NULL; count++) {
+        size += 4 + (unsigned int)strlen(list[count].name);
+    }
+
+    body = lib_malloc(size);
+    put_uint16(body, count);
+    size = 2;
+    for (i = 0; i < count; i++) {
+        unsigned int len = (unsigned int)strlen(list[i].name);
+
+        body[size] = (uint8_t)(3 + len);
+        body[size + 1] = (uint8_t)i;
+        body[size + 2] = (uint8_t)list[i].size;
+        body[size + 3] = (uint8_t)len;
+        memcpy(&body[size + 4], list[i].name, len);
+        size += 4 + len;
+    }
+    lib_free(list);
+
+    monitor_binary_response(MON_BIN_CMD_REGISTERS_AVAILABLE, MON_BIN_ERR_OK, request_id, body, size);
+    lib_free(body);
+    return MON_BIN_ERR_OK;
+}
+
+/* Handle one request, answering it.  */
+static void monitor_binary_process_command(uint8_t command, uint32_t request_id,
+                                           const uint8_t *body, uint32_t length)
+{
+    mon_checkpoint_info_t info;
+    MEMSPACE mem;
+    int error = MON_BIN_ERR_OK;
+    int i, count;
+
+    switch (command) {
+        case MON_BIN_CMD_MEM_GET:
+        case MON_BIN_CMD_MEM_SET:
+            error = monitor_binary_cmd_mem(command, request_id, body, length);
+            break;
+
+        case MON_BIN_CMD_CHECKPOINT_GET:
+        case MON_BIN_CMD_CHECKPOINT_DELETE:
+        case MON_BIN_CMD_CHECKPOINT_TOGGLE:
+            if (length != ((command == MON_BIN_CMD_CHECKPOINT_TOGGLE) ? 5u : 4u)) {
+                error = MON_BIN_ERR_CMD_INVALID_LENGTH;
+                break;
+            }
+            if (!mon_breakpoint_get_info((int)get_uint32(body), &info)) {
+                error = MON_BIN_ERR_OBJECT_MISSING;
+                break;
+            }
+            if (command == MON_BIN_CMD_CHECKPOINT_GET) {
+                monitor_binary_checkpoint_response(&info, request_id);
+                break;
+            }
+            if (command == MON_BIN_CMD_CHECKPOINT_DELETE) {
+                mon_breakpoint_delete_checkpoint(info.checknum);
+            } else {
+                mon_breakpoint_switch_checkpoint(body[4] ? e_ON : e_OFF, info.checknum);
+            }
+            monitor_binary_error(command, MON_BIN_ERR_OK, request_id);
+            break;
+
+        case MON_BIN_CMD_CHECKPOINT_SET:
+            error = monitor_binary_cmd_checkpoint_set(request_id, body, length);
+            break;
+
+        case MON_BIN_CMD_CHECKPOINT_LIST:
+            if (length != 0) {
+                error = MON_BIN_ERR_CMD_INVALID_LENGTH;
+                break;
+            }
+            count = 0;
+            for (i = 1; i <= mon_breakpoint_get_last_number(); i++) {
+                if (mon_breakpoint_get_info(i, &info)) {
+                    monitor_binary_checkpoint_response(&info, request_id);
+                    count++;
+                }
+            }
+            {
+                uint8_t answer[4];
+
+                put_uint32(answer, count);
+                monitor_binary_response(command, MON_BIN_ERR_OK, request_id, answer, sizeof answer);
+            }
+            break;
+
+        case MON_BIN_CMD_CONDITION_SET:
+            error = monitor_binary_cmd_condition_set(request_id, body, length);
+            break;
+
+        case MON_BIN_CMD_REGISTERS_GET:
+        case MON_BIN_CMD_BANKS_AVAILABLE:
+        case MON_BIN_CMD_REGISTERS_AVAILABLE:
+            if (length != 1) {
+                error = MON_BIN_ERR_CMD_INVALID_LENGTH;
+            } else if (monitor_binary_memspace(body[0], &mem) < 0) {
+                error = MON_BIN_ERR_INVALID_MEMSPACE;
+            } else if (command == MON_BIN_CMD_REGISTERS_GET) {
+                monitor_binary_registers_response(mem, command, request_id);
+            } else if (command == MON_BIN_CMD_BANKS_AVAILABLE) {
+                error = monitor_binary_cmd_banks_available(request_id, mem);
+            } else {
+                error = monitor_binary_cmd_registers_available(request_id, mem);
+            }
+            break;
+
+        case MON_BIN_CMD_REGISTERS_SET:
+            error = monitor_binary_cmd_registers_set(request_id, body, length);
+            break;
+
+        case MON_BIN_CMD_ADVANCE:
+            if (length != 3) {
+                error = MON_BIN_ERR_CMD_INVALID_LENGTH;
+            } else if (!binary_stopped) {
+                error = MON_BIN_ERR_NOT_STOPPED;
+            } else {
+                monitor_binary_error(command, MON_BIN_ERR_OK, request_id);
+                if (body[0]) {
+                    mon_instructions_next((int)get_uint16(&body[1]));
+                } else {
+                    mon_instructions_step((int)get_uint16(&body[1]));
+                }
+            }
+            break;
+
+        case MON_BIN_CMD_PING:
+            monitor_binary_error(command, MON_BIN_ERR_OK, request_id);
+            break;
+
+        case MON_BIN_CMD_EXIT:
+            monitor_binary_error(command, MON_BIN_ERR_OK, request_id);
+            if (binary_stopped) {
+                exit_mon = 1;
+            }
+            break;
+
+        case MON_BIN_CMD_STOP:
+            monitor_binary_error(command, MON_BIN_ERR_OK, request_id);
+            if (!binary_stopped) {
+                binary_stop_requested = 1;
+            }
+            break;
+
+        case MON_BIN_CMD_RESET:
+            if (length != 1) {
+                error = MON_BIN_ERR_CMD_INVALID_LENGTH;
+                break;
+            }
+            monitor_binary_error(command, MON_BIN_ERR_OK, request_id);
+            if (binary_stopped) {
+                mon_reset_machine(body[0] ? 1 : 0);
+            } else {
+                machine_trigger_reset(body[0] ? MACHINE_RESET_MODE_HARD : MACHINE_RESET_MODE_SOFT);
+            }
+            break;
+
+        default:
+            log_message(LOG_DEFAULT, "monitor_binary: unknown command %u", command);
+            error = MON_BIN_ERR_UNKNOWN_COMMAND;
+            break;
+    }
+
+    if (error != MON_BIN_ERR_OK) {
+        monitor_binary_error(command, (uint8_t)error, request_id);
+    }
+}
+
+/* Handle all complete requests in the receive buffer.  */
+static void monitor_binary_process_requests(void)
+{
+    unsigned int pos = 0;
+
+    while (recv_buffer != NULL && recv_len - pos >= MON_BIN_REQUEST_HEADER) {
+        uint8_t *request = recv_buffer + pos;
+        uint32_t length = get_uint32(&request[2]);
+
+        if (request[0] != ASC_STX || length > MON_BIN_MAX_BODY) {
+            log_message(LOG_DEFAULT, "monitor_binary: invalid request, breaking connection");
+            monitor_binary_quit();
+            return;
+        }
+        if (recv_len - pos < MON_BIN_REQUEST_HEADER + length) {
+            break;
+        }
+
+        if (request[1] != MON_BIN_API_VERSION) {
+            monitor_binary_error(request[10], MON_BIN_ERR_INVALID_API_VERSION,
+                                 get_uint32(&request[6]));
+        } else {
+            monitor_binary_process_command(request[10], get_uint32(&request[6]),
+                                           request + MON_BIN_REQUEST_HEADER, length);
+        }
+        pos += MON_BIN_REQUEST_HEADER + length;
+    }
+
+    if (recv_buffer != NULL && pos > 0) {
+        memmove(recv_buffer, recv_buffer + pos, recv_len - pos);
+        recv_len -= pos;
+    }
+}
+
+/* Returns nonzero if there is a complete request in the receive buffer.  */
+static int monitor_binary_request_complete(void)
+{
+    return recv_len >= MON_BIN_REQUEST_HEADER
+           && (recv_buffer[0] != ASC_STX
+               || recv_len >= MON_BIN_REQUEST_HEADER + get_uint32(&recv_buffer[2]));
+}
+
+/* Accept a new connection or read what has arrived, without waiting.
+   Returns nonzero if data was read.  */
+static int monitor_binary_receive(void)
+{
+    int count;
+
+    if (connected_socket == NULL) {
+        if (listen_socket != NULL && vice_network_select_poll_one(listen_socket)) {
+            connected_socket = vice_network_accept(listen_socket);
+            if (connected_socket != NULL) {
+                recv_buffer = lib_malloc(MON_BIN_REQUEST_HEADER + MON_BIN_MAX_BODY);
+                recv_len = 0;
+            }
+        }
+        return 0;
+    }
+
+    monitor_binary_flush();
+
+    if (connected_socket == NULL || !vice_network_select_poll_one(connected_socket)) {
+        return 0;
+    }
+
+    count = vice_network_receive(connected_socket, recv_buffer + recv_len,
+                                 MON_BIN_REQUEST_HEADER + MON_BIN_MAX_BODY - recv_len, 0);
+    if (count <= 0) {
+        monitor_binary_quit();
+        return 0;
+    }
+    recv_len += count;
+    return 1;
+}
+
+static void monitor_binary_trap(uint16_t addr, void *unused_data)
+{
+    binary_trap_pending = 0;
+    monitor_binary_process_requests();
+
+    if (binary_stop_requested) {
+        binary_stop_requested = 0;
+        monitor_startup(e_comp_space);
+    }
+}
+
+static void monitor_binary_poll(void)
+{
+    monitor_binary_receive();
+
+    /* requests left over when the machine was resumed are handled, too */
+    if (!binary_trap_pending && monitor_binary_request_complete()) {
+        binary_trap_pending = 1;
+        interrupt_maincpu_trigger_trap(monitor_binary_trap, NULL);
+    }
+}
+
+static CLOCK monitor_binary_poll_interval(void)
+{
+    return (CLOCK)(machine_get_cycles_per_second() / 1000);
+}
+
+static void monitor_binary_poll_alarm_handler(CLOCK offset, void *data)
+{
+    if (listen_socket == NULL && connected_socket == NULL) {
+        alarm_unset(binary_poll_alarm);
+        binary_poll_pending = 0;
+        return;
+    }
+
+    alarm_set(binary_poll_alarm, maincpu_clk - offset + monitor_binary_poll_interval());
+    monitor_binary_poll();
+}
+
+/* Called once per frame: the alarm is only set up here, as the CPU alarm
+   context does not exist yet when the server is activated.  */
+void monitor_check_binary(void)
+{
+    if (listen_socket == NULL && connected_socket == NULL) {
+        return;
+    }
+
+    if (binary_poll_alarm == NULL) {
+        binary_poll_alarm = alarm_new(maincpu_alarm_context, "MonitorBinaryPoll",
+                                      monitor_binary_poll_alarm_handler, NULL);
+    }
+    if (!binary_poll_pending) {
+        binary_poll_pending = 1;
+        alarm_set(binary_poll_alarm, maincpu_clk + monitor_binary_poll_interval());
+    }
+
+    monitor_binary_poll();
+}
+
+int monitor_is_binary(void)
+{
+    return connected_socket != NULL;
+}
+
+/* Called by the monitor instead of opening its console: serve the client
+   until it resumes the machine or goes away.  */
+void monitor_binary_stopped(MEMSPACE mem)
+{
+    binary_stopped = 1;
+    monitor_binary_event_pc(MON_BIN_EVENT_STOPPED, mem);
+
+    /* requests that came in while the machine was running */
+    monitor_binary_process_requests();
+
+    while (!exit_mon && connected_socket != NULL) {
+        if (monitor_binary_receive()) {
+            monitor_binary_process_requests();
+        } else {
+            ui_dispatch_events();
+            vsyncarch_sleep(vsyncarch_frequency() / 1000);
+        }
+    }
+
+    binary_stopped = 0;
+    monitor_binary_event_pc(MON_BIN_EVENT_RESUMED, mem);
+}
+
+void monitor_binary_event_checkpoint(int checknum)
+{
+    mon_checkpoint_info_t info;
+
+    if (connected_socket != NULL && mon_breakpoint_get_info(checknum, &info)) {
+        monitor_binary_checkpoint_response(&info, MON_BIN_EVENT_ID);
+    }
+}
+
+void monitor_binary_event_jam(const char *message)
+{
+    monitor_binary_response(MON_BIN_EVENT_JAM, MON_BIN_ERR_OK, MON_BIN_EVENT_ID,
+                            (const uint8_t *)message, (uint32_t)strlen(message));
+}
+
+void monitor_binary_event_reset(void)
+{
+    monitor_binary_error(MON_BIN_EVENT_RESET, MON_BIN_ERR_OK, MON_BIN_EVENT_ID);
+}
+
+ui_jam_action_t monitor_binary_ui_jam_dialog(const char *message)
+{
+    /* the client has been told by the JAM event, let it look at the machine */
+    return UI_JAM_MONITOR;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int monitor_binary_activate(void)
+{
+    vice_network_socket_address_t *server_addr = NULL;
+    int error = 1;
+
+    do {
+        if (!binary_server_address) {
+            break;
+        }
+
+        server_addr = vice_network_address_generate(binary_server_address, 0);
+        if (!server_addr) {
+            break;
+        }
+
+        listen_socket = vice_network_server(server_addr);
+        if (!listen_socket) {
+            break;
+        }
+
+        error = 0;
+    } while (0);
+
+    if (server_addr) {
+        vice_network_address_close(server_addr);
+    }
+
+    return error;
+}
+
+static int monitor_binary_deactivate(void)
+{
+    if (listen_socket) {
+        vice_network_socket_close(listen_socket);
+        listen_socket = NULL;
+    }
+
+    return 0;
+}
+
+static int set_binary_enabled(int value, void *param)
+{
+    int val = value ? 1 : 0;
+
+    if (!val) {
+        if (binary_enabled) {
+            if (monitor_binary_deactivate() < 0) {
+                return -1;
+            }
+        }
+        binary_enabled = 0;
+        return 0;
+    } else {
+        if (!binary_enabled) {
+            if (monitor_binary_activate() < 0) {
+                return -1;
+            }
+        }
+
+        binary_enabled = 1;
+        return 0;
+    }
+}
+
+static int set_binary_server_address(const char *name, void *param)
+{
+    if (binary_server_address != NULL && name != NULL
+        && strcmp(name, binary_server_address) == 0) {
+        return 0;
+    }
+
+    if (binary_enabled) {
+        monitor_binary_deactivate();
+    }
+    util_string_set(&binary_server_address, name);
+
+    if (binary_enabled) {
+        monitor_binary_activate();
+    }
+
+    return 0;
+}
+
+static const resource_string_t resources_string[] = {
+    { "BinaryMonitorServerAddress", "ip4://127.0.0.1:6502", RES_EVENT_NO, NULL,
+      &binary_server_address, set_binary_server_address, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+static const resource_int_t resources_int[] = {
+    { "BinaryMonitorServer", 0, RES_EVENT_STRICT, (resource_value_t)0,
+      &binary_enabled, set_binary_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int monitor_binary_resources_init(void)
+{
+    if (resources_register_string(resources_string) < 0) {
+        return -1;
+    }
+
+    return resources_register_int(resources_int);
+}
+
+void monitor_binary_resources_shutdown(void)
+{
+    monitor_binary_deactivate();
+    monitor_binary_quit();
+
+    lib_free(binary_server_address);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-binarymonitor", SET_RESOURCE, 0,
+      NULL, NULL, "BinaryMonitorServer", (resource_value_t)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, N_("Enable binary remote monitor") },
+    { "+binarymonitor", SET_RESOURCE, 0,
+      NULL, NULL, "BinaryMonitorServer", (resource_value_t)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, N_("Disable binary remote monitor") },
+    { "-binarymonitoraddress", SET_RESOURCE, 1,
+      NULL, NULL, "BinaryMonitorServerAddress", NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      N_("<Name>"), N_("The local address the binary remote monitor should bind to") },
+    CMDLINE_LIST_END
+};
+
+int monitor_binary_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+#else
+
+int monitor_binary_resources_init(void)
+{
+    return 0;
+}
+
+void monitor_binary_resources_shutdown(void)
+{
+}
+
+int monitor_binary_cmdline_options_init(void)
+{
+    return 0;
+}
+
+void monitor_check_binary(void)
+{
+}
+
+int monitor_is_binary(void)
+{
+    return 0;
+}
+
+void monitor_binary_stopped(MEMSPACE mem)
+{
+}
+
+void monitor_binary_event_checkpoint(int checknum)
+{
+}
+
+void monitor_binary_event_jam(const char *message)
+{
+}
+
+void monitor_binary_event_reset(void)
+{
+}
+
+ui_jam_action_t monitor_binary_ui_jam_dialog(const char *message)
+{
+    return UI_JAM_HARD_RESET;
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * monitor_binary.h - Monitor implementation - binary remote protocol.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MONITOR_BINARY_H
+#define VICE_MONITOR_BINARY_H
+
+#include "montypes.h"
+#include "types.h"
+#include "uiapi.h"
+
+extern int monitor_binary_resources_init(void);
+extern void monitor_binary_resources_shutdown(void);
+extern int monitor_binary_cmdline_options_init(void);
+
+extern void monitor_check_binary(void);
+extern int monitor_is_binary(void);
+extern void monitor_binary_stopped(MEMSPACE mem);
+
+extern void monitor_binary_event_checkpoint(int checknum);
+extern void monitor_binary_event_jam(const char *message);
+extern void monitor_binary_event_reset(void);
+
+extern ui_jam_action_t monitor_binary_ui_jam_dialog(const char *message);
+
+#endif
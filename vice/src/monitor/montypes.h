@@ -155,6 +155,9 @@ struct cond_node_s {
 };
 typedef struct cond_node_s cond_node_t;
 
+/* A condition compiled by mon_compile_conditional().  */
+typedef struct cond_code_s cond_code_t;
+
 typedef void monitor_toggle_func_t(int value);
 
 /* Defines */
@@ -262,6 +265,7 @@ extern const char *mon_get_bank_name_for_bank(MEMSPACE mem, int banknum);
 extern int mon_banknum_from_bank(MEMSPACE mem, const char *bankname);
 extern void mon_display_io_regs(MON_ADDR addr);
 extern void mon_evaluate_default_addr(MON_ADDR *a);
+extern void monitor_disassemble_on_entry(void);
 extern void mon_set_mem_val(MEMSPACE mem, uint16_t mem_addr, uint8_t val);
 extern bool mon_inc_addr_location(MON_ADDR *a, unsigned inc);
 extern void mon_start_assemble_mode(MON_ADDR addr, char *asm_line);
@@ -272,6 +276,9 @@ extern bool check_drive_emu_level_ok(int drive_num);
 extern void mon_print_conditional(cond_node_t *cnode);
 extern void mon_delete_conditional(cond_node_t *cnode);
 extern int mon_evaluate_conditional(cond_node_t *cnode);
+extern cond_code_t *mon_compile_conditional(cond_node_t *cnode);
+extern void mon_delete_compiled_conditional(cond_code_t *code);
+extern int mon_evaluate_compiled_conditional(cond_code_t *code);
 extern bool mon_is_valid_addr(MON_ADDR a);
 extern bool mon_is_in_range(MON_ADDR start_addr, MON_ADDR end_addr,
                             unsigned loc);
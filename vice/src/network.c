@@ -247,13 +247,15 @@ static void network_free_frame_event_list(void)
 
 static void network_event_record_sync_test(uint16_t addr, void *data)
 {
-    uint8_t regbuf[5 * 4];
+    uint8_t regbuf[6 * 4];
 
     util_dword_to_le_buf(&regbuf[0 * 4], (uint32_t)(maincpu_get_pc()));
     util_dword_to_le_buf(&regbuf[1 * 4], (uint32_t)(maincpu_get_a()));
     util_dword_to_le_buf(&regbuf[2 * 4], (uint32_t)(maincpu_get_x()));
     util_dword_to_le_buf(&regbuf[3 * 4], (uint32_t)(maincpu_get_y()));
     util_dword_to_le_buf(&regbuf[4 * 4], (uint32_t)(maincpu_get_sp()));
+    /* hash of the whole machine state, 0 unless EventFrameHash is set */
+    util_dword_to_le_buf(&regbuf[5 * 4], event_state_hash());
 
     network_event_record(EVENT_SYNC_TEST, (void *)regbuf, sizeof(regbuf));
 }
@@ -871,9 +873,20 @@ static void network_hook_connected_receive(void)
         /* test for sync */
         if (client_event_list->base->type == EVENT_SYNC_TEST
             && server_event_list->base->type == EVENT_SYNC_TEST) {
-            int i;
+            int i, num;
+
+            /* older versions send no state hash, it is compared only if
+               both sides have one */
+            if (client_event_list->base->size >= 6 * 4
+                && server_event_list->base->size >= 6 * 4
+                && ((uint32_t *)client_event_list->base->data)[5] != 0
+                && ((uint32_t *)server_event_list->base->data)[5] != 0) {
+                num = 6;
+            } else {
+                num = 5;
+            }
 
-            for (i = 0; i < 5; i++) {
+            for (i = 0; i < num; i++) {
                 if (((uint32_t *)client_event_list->base->data)[i]
                     != ((uint32_t *)server_event_list->base->data)[i]) {
                     ui_error(translate_text(IDGS_NETWORK_OUT_OF_SYNC));
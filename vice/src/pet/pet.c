@@ -97,6 +97,7 @@
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
 #include "sidcart.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "tape.h"
 #include "tapeport.h"
@@ -899,7 +900,11 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks,
 
 int machine_read_snapshot(const char *name, int event_mode)
 {
-    return pet_snapshot_read(name, event_mode);
+    if (pet_snapshot_read(name, event_mode) < 0) {
+        return -1;
+    }
+    snapshot_read_done();
+    return 0;
 }
 
 
@@ -93,6 +93,7 @@
 #include "sidcart.h"
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "tape.h"
 #include "tapeport.h"
@@ -1038,7 +1039,11 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks,
 
 int machine_read_snapshot(const char *name, int event_mode)
 {
-    return plus4_snapshot_read(name, event_mode);
+    if (plus4_snapshot_read(name, event_mode) < 0) {
+        return -1;
+    }
+    snapshot_read_done();
+    return 0;
 }
 
 /* ------------------------------------------------------------------------- */
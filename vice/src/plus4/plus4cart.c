@@ -29,6 +29,7 @@
 
 #include <string.h>
 
+#include "bootsnapshot.h"
 #include "cartridge.h"
 #include "cmdline.h"
 #include "plus4cart.h"
@@ -293,6 +294,8 @@ void plus4cart_detach_cartridges(void)
 
 void cartridge_detach_image(int type)
 {
+    bootsnapshot_cartridge_detach(type);
+
     if (type < 0) {
         plus4cart_detach_cartridges();
     } else {
@@ -401,7 +404,11 @@ int cartridge_attach_image(int type, const char *filename)
 #endif
         default:
             if ((type & 0xff00) == CARTRIDGE_PLUS4_DETECT) {
-                return cart_load_generic(type, filename);
+                if (cart_load_generic(type, filename) < 0) {
+                    return -1;
+                }
+                bootsnapshot_cartridge_attach(type, filename);
+                return 0;
             } else {
                 log_error(LOG_DEFAULT, "cartridge_attach_image: unsupported type (%04x)", type);
             }
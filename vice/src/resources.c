@@ -1396,6 +1396,24 @@ int resources_dump(const char *fname)
     return 0;
 }
 
+/* Call `func' for every resource whose name starts with one of the
+   prefixes in the NULL terminated list `prefixes'.  */
+void resources_foreach_prefix(const char * const *prefixes,
+                              void (*func)(const char *name, void *param),
+                              void *param)
+{
+    unsigned int i, j;
+
+    for (i = 0; i < num_resources; i++) {
+        for (j = 0; prefixes[j] != NULL; j++) {
+            if (strncmp(resources[i].name, prefixes[j], strlen(prefixes[j])) == 0) {
+                func(resources[i].name, param);
+                break;
+            }
+        }
+    }
+}
+
 int resources_register_callback(const char *name,
                                 resource_callback_func_t *callback,
                                 void *callback_param)
@@ -103,6 +103,7 @@
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
 #include "sid.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "translate.h"
 #include "traps.h"
@@ -1133,7 +1134,11 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks, int
 
 int machine_read_snapshot(const char *name, int event_mode)
 {
-    return scpu64_snapshot_read(name, event_mode);
+    if (scpu64_snapshot_read(name, event_mode) < 0) {
+        return -1;
+    }
+    snapshot_read_done();
+    return 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -224,6 +224,39 @@ int screenshot_save(const char *drvname, const char *filename,
     return result;
 }
 
+/* Return the displayed area as palette indices, before any palette or
+   rendering is applied.  The buffer must be freed with lib_free().  */
+uint8_t *screenshot_get_indexed(struct video_canvas_s *canvas,
+                                unsigned int *width, unsigned int *height)
+{
+    screenshot_t screenshot;
+    uint8_t *data, *line_base;
+    unsigned int x, y;
+
+    if (machine_screenshot(&screenshot, canvas) < 0) {
+        log_error(screenshot_log, "Retrieving screen geometry failed.");
+        return NULL;
+    }
+
+    *width = screenshot.max_width & ~3;
+    *height = screenshot.last_displayed_line
+              - screenshot.first_displayed_line + 1;
+
+    data = lib_malloc(*width * *height);
+
+    for (y = 0; y < *height; y++) {
+        line_base = BUFFER_LINE_START(&screenshot,
+                                      (y + screenshot.first_displayed_line)
+                                      * screenshot.size_height);
+        for (x = 0; x < *width; x++) {
+            data[y * *width + x]
+                = line_base[x * screenshot.size_width + screenshot.x_offset];
+        }
+    }
+
+    return data;
+}
+
 #ifdef FEATURE_CPUMEMHISTORY
 int memmap_screenshot_save(const char *drvname, const char *filename, int x_size, int y_size, uint8_t *gfx, uint8_t *palette)
 {
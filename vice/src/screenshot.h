@@ -117,6 +117,9 @@ extern void screenshot_stop_recording(void);
 extern int screenshot_is_recording(void);
 extern void screenshot_prepare_reopen(void);
 extern void screenshot_try_reopen(void);
+extern uint8_t *screenshot_get_indexed(struct video_canvas_s *canvas,
+                                       unsigned int *width,
+                                       unsigned int *height);
 
 #ifdef FEATURE_CPUMEMHISTORY
 extern int memmap_screenshot_save(const char *drvname, const char *filename, int x_size, int y_size, uint8_t *gfx, uint8_t *palette);
@@ -883,6 +883,12 @@ static int sid_snapshot_write_module_extended(snapshot_t *s, int sidnr)
         return -1;
     }
 
+    /* Without sound there is no engine to take the state from, the
+       registers in the SID module are all there is.  */
+    if (sound_get_psid(sidnr) == NULL) {
+        return snapshot_module_close(m);
+    }
+
     switch (sid_engine) {
 #ifdef HAVE_RESID
         case SID_ENGINE_RESID:
@@ -958,8 +964,9 @@ static int sid_snapshot_read_module_extended(snapshot_t *s, int sidnr)
     }
 
     /* If the sid engine data that was save does not match the current engine
-       then don't try to load the data */
-    if (intended_sid_engine != sid_engine) {
+       or there is no engine because sound is off, then don't try to load
+       the data */
+    if (intended_sid_engine != sid_engine || sound_get_psid(sidnr) == NULL) {
         siddata = sid_get_siddata(sidnr);
         for (i = 0; i < 32; ++i) {
             if (!sidnr) {
@@ -59,8 +59,8 @@ char snapshot_version_magic_string[] = "VICE Version\032";
 #define SNAPSHOT_VERSION_MAGIC_LEN      13
 
 struct snapshot_module_s {
-    /* File descriptor.  */
-    FILE *file;
+    /* Snapshot the module is part of.  */
+    snapshot_t *snapshot;
 
     /* Flag: are we writing it?  */
     int write_mode;
@@ -76,9 +76,13 @@ struct snapshot_module_s {
 };
 
 struct snapshot_s {
-    /* File descriptor.  */
+    /* File descriptor, NULL if the snapshot is kept in memory.  */
     FILE *file;
 
+    /* Memory buffer and current position, for snapshots kept in memory.  */
+    snapshot_memory_t *memory;
+    unsigned int pos;
+
     /* Offset of the first module.  */
     long first_module_offset;
 
@@ -88,9 +92,130 @@ struct snapshot_s {
 
 /* ------------------------------------------------------------------------- */
 
-static int snapshot_write_byte(FILE *f, uint8_t data)
+/* Snapshots can be kept in memory instead of a file, for the keyframes
+   and state hashes of event histories and for reverse execution; this
+   saves the file system round trip.  The buffer is kept between writes,
+   so it only grows to the size of the largest snapshot once.  */
+struct snapshot_memory_s {
+    uint8_t *data;
+    unsigned int len;
+    unsigned int size;
+};
+
+/* While set, snapshot_create() and snapshot_open() use this buffer
+   instead of the file they are given.  */
+static snapshot_memory_t *memory_redirect = NULL;
+
+static int snapshot_put(snapshot_t *s, const uint8_t *data, unsigned int num)
+{
+    snapshot_memory_t *mem = s->memory;
+
+    if (mem == NULL) {
+        return (fwrite(data, (size_t)num, 1, s->file) < 1) ? -1 : 0;
+    }
+
+    if (s->pos + num > mem->size) {
+        while (s->pos + num > mem->size) {
+            mem->size = mem->size ? mem->size * 2 : 0x10000;
+        }
+        mem->data = lib_realloc(mem->data, mem->size);
+    }
+    memcpy(mem->data + s->pos, data, num);
+    s->pos += num;
+    if (s->pos > mem->len) {
+        mem->len = s->pos;
+    }
+    return 0;
+}
+
+static int snapshot_putc(snapshot_t *s, uint8_t c)
+{
+    return snapshot_put(s, &c, 1);
+}
+
+static int snapshot_getc(snapshot_t *s)
+{
+    if (s->memory == NULL) {
+        return fgetc(s->file);
+    }
+    if (s->pos >= s->memory->len) {
+        return EOF;
+    }
+    return s->memory->data[s->pos++];
+}
+
+static int snapshot_get(snapshot_t *s, uint8_t *data, unsigned int num)
+{
+    if (s->memory == NULL) {
+        return (fread(data, (size_t)num, 1, s->file) < 1) ? -1 : 0;
+    }
+    if (num > s->memory->len - s->pos) {
+        s->pos = s->memory->len;
+        return -1;
+    }
+    memcpy(data, s->memory->data + s->pos, num);
+    s->pos += num;
+    return 0;
+}
+
+static long snapshot_tell(snapshot_t *s)
+{
+    if (s->memory == NULL) {
+        return ftell(s->file);
+    }
+    return (long)s->pos;
+}
+
+static int snapshot_seek(snapshot_t *s, long offset)
+{
+    if (s->memory == NULL) {
+        return fseek(s->file, offset, SEEK_SET);
+    }
+    if (offset < 0 || offset > (long)s->memory->len) {
+        return -1;
+    }
+    s->pos = (unsigned int)offset;
+    return 0;
+}
+
+snapshot_memory_t *snapshot_memory_create(void)
+{
+    return lib_calloc(1, sizeof(snapshot_memory_t));
+}
+
+void snapshot_memory_destroy(snapshot_memory_t *mem)
+{
+    if (mem != NULL) {
+        lib_free(mem->data);
+        lib_free(mem);
+    }
+}
+
+const uint8_t *snapshot_memory_get_data(snapshot_memory_t *mem, unsigned int *len)
+{
+    *len = mem->len;
+    return mem->data;
+}
+
+void snapshot_memory_set_data(snapshot_memory_t *mem, const uint8_t *data, unsigned int len)
+{
+    if (len > mem->size) {
+        mem->size = len;
+        mem->data = lib_realloc(mem->data, mem->size);
+    }
+    memcpy(mem->data, data, len);
+    mem->len = len;
+}
+
+void snapshot_memory_redirect(snapshot_memory_t *mem)
+{
+    memory_redirect = mem;
+}
+/* ------------------------------------------------------------------------- */
+
+static int snapshot_write_byte(snapshot_t *f, uint8_t data)
 {
-    if (fputc(data, f) == EOF) {
+    if (snapshot_putc(f, data) < 0) {
         snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
@@ -98,7 +223,7 @@ static int snapshot_write_byte(FILE *f, uint8_t data)
     return 0;
 }
 
-static int snapshot_write_word(FILE *f, uint16_t data)
+static int snapshot_write_word(snapshot_t *f, uint16_t data)
 {
     if (snapshot_write_byte(f, (uint8_t)(data & 0xff)) < 0
         || snapshot_write_byte(f, (uint8_t)(data >> 8)) < 0) {
@@ -108,7 +233,7 @@ static int snapshot_write_word(FILE *f, uint16_t data)
     return 0;
 }
 
-static int snapshot_write_dword(FILE *f, uint32_t data)
+static int snapshot_write_dword(snapshot_t *f, uint32_t data)
 {
     if (snapshot_write_word(f, (uint16_t)(data & 0xffff)) < 0
         || snapshot_write_word(f, (uint16_t)(data >> 16)) < 0) {
@@ -118,7 +243,7 @@ static int snapshot_write_dword(FILE *f, uint32_t data)
     return 0;
 }
 
-static int snapshot_write_double(FILE *f, double data)
+static int snapshot_write_double(snapshot_t *f, double data)
 {
     uint8_t *byte_data = (uint8_t *)&data;
     int i;
@@ -131,7 +256,7 @@ static int snapshot_write_double(FILE *f, double data)
     return 0;
 }
 
-static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char,
+static int snapshot_write_padded_string(snapshot_t *f, const char *s, uint8_t pad_char,
                                         int len)
 {
     int i, found_zero;
@@ -150,9 +275,9 @@ static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char
     return 0;
 }
 
-static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int num)
+static int snapshot_write_byte_array(snapshot_t *f, const uint8_t *data, unsigned int num)
 {
-    if (num > 0 && fwrite(data, (size_t)num, 1, f) < 1) {
+    if (num > 0 && snapshot_put(f, data, num) < 0) {
         snapshot_error = SNAPSHOT_WRITE_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -160,7 +285,7 @@ static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int
     return 0;
 }
 
-static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int num)
+static int snapshot_write_word_array(snapshot_t *f, const uint16_t *data, unsigned int num)
 {
     unsigned int i;
 
@@ -173,7 +298,7 @@ static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int
     return 0;
 }
 
-static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned int num)
+static int snapshot_write_dword_array(snapshot_t *f, const uint32_t *data, unsigned int num)
 {
     unsigned int i;
 
@@ -187,7 +312,7 @@ static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned in
 }
 
 
-static int snapshot_write_string(FILE *f, const char *s)
+static int snapshot_write_string(snapshot_t *f, const char *s)
 {
     size_t len, i;
 
@@ -206,11 +331,11 @@ static int snapshot_write_string(FILE *f, const char *s)
     return (int)(len + sizeof(uint16_t));
 }
 
-static int snapshot_read_byte(FILE *f, uint8_t *b_return)
+static int snapshot_read_byte(snapshot_t *f, uint8_t *b_return)
 {
     int c;
 
-    c = fgetc(f);
+    c = snapshot_getc(f);
     if (c == EOF) {
         snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
@@ -219,7 +344,7 @@ static int snapshot_read_byte(FILE *f, uint8_t *b_return)
     return 0;
 }
 
-static int snapshot_read_word(FILE *f, uint16_t *w_return)
+static int snapshot_read_word(snapshot_t *f, uint16_t *w_return)
 {
     uint8_t lo, hi;
 
@@ -231,7 +356,7 @@ static int snapshot_read_word(FILE *f, uint16_t *w_return)
     return 0;
 }
 
-static int snapshot_read_dword(FILE *f, uint32_t *dw_return)
+static int snapshot_read_dword(snapshot_t *f, uint32_t *dw_return)
 {
     uint16_t lo, hi;
 
@@ -243,7 +368,7 @@ static int snapshot_read_dword(FILE *f, uint32_t *dw_return)
     return 0;
 }
 
-static int snapshot_read_double(FILE *f, double *d_return)
+static int snapshot_read_double(snapshot_t *f, double *d_return)
 {
     int i;
     int c;
@@ -251,7 +376,7 @@ static int snapshot_read_double(FILE *f, double *d_return)
     uint8_t *byte_val = (uint8_t *)&val;
 
     for (i = 0; i < sizeof(double); i++) {
-        c = fgetc(f);
+        c = snapshot_getc(f);
         if (c == EOF) {
             snapshot_error = SNAPSHOT_READ_EOF_ERROR;
             return -1;
@@ -262,9 +387,9 @@ static int snapshot_read_double(FILE *f, double *d_return)
     return 0;
 }
 
-static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num)
+static int snapshot_read_byte_array(snapshot_t *f, uint8_t *b_return, unsigned int num)
 {
-    if (num > 0 && fread(b_return, (size_t)num, 1, f) < 1) {
+    if (num > 0 && snapshot_get(f, b_return, num) < 0) {
         snapshot_error = SNAPSHOT_READ_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -272,7 +397,7 @@ static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num
     return 0;
 }
 
-static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int num)
+static int snapshot_read_word_array(snapshot_t *f, uint16_t *w_return, unsigned int num)
 {
     unsigned int i;
 
@@ -285,7 +410,7 @@ static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int nu
     return 0;
 }
 
-static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int num)
+static int snapshot_read_dword_array(snapshot_t *f, uint32_t *dw_return, unsigned int num)
 {
     unsigned int i;
 
@@ -298,7 +423,7 @@ static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int
     return 0;
 }
 
-static int snapshot_read_string(FILE *f, char **s)
+static int snapshot_read_string(snapshot_t *f, char **s)
 {
     int i, len;
     uint16_t w;
@@ -333,7 +458,7 @@ static int snapshot_read_string(FILE *f, char **s)
 
 int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 {
-    if (snapshot_write_byte(m->file, b) < 0) {
+    if (snapshot_write_byte(m->snapshot, b) < 0) {
         return -1;
     }
 
@@ -343,7 +468,7 @@ int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 
 int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 {
-    if (snapshot_write_word(m->file, w) < 0) {
+    if (snapshot_write_word(m->snapshot, w) < 0) {
         return -1;
     }
 
@@ -353,7 +478,7 @@ int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 
 int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 {
-    if (snapshot_write_dword(m->file, dw) < 0) {
+    if (snapshot_write_dword(m->snapshot, dw) < 0) {
         return -1;
     }
 
@@ -363,7 +488,7 @@ int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 
 int snapshot_module_write_double(snapshot_module_t *m, double db)
 {
-    if (snapshot_write_double(m->file, db) < 0) {
+    if (snapshot_write_double(m->snapshot, db) < 0) {
         return -1;
     }
 
@@ -373,7 +498,7 @@ int snapshot_module_write_double(snapshot_module_t *m, double db)
 
 int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uint8_t pad_char, int len)
 {
-    if (snapshot_write_padded_string(m->file, s, (uint8_t)pad_char, len) < 0) {
+    if (snapshot_write_padded_string(m->snapshot, s, (uint8_t)pad_char, len) < 0) {
         return -1;
     }
 
@@ -383,7 +508,7 @@ int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uin
 
 int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, unsigned int num)
 {
-    if (snapshot_write_byte_array(m->file, b, num) < 0) {
+    if (snapshot_write_byte_array(m->snapshot, b, num) < 0) {
         return -1;
     }
 
@@ -393,7 +518,7 @@ int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, uns
 
 int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, unsigned int num)
 {
-    if (snapshot_write_word_array(m->file, w, num) < 0) {
+    if (snapshot_write_word_array(m->snapshot, w, num) < 0) {
         return -1;
     }
 
@@ -403,7 +528,7 @@ int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, un
 
 int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw, unsigned int num)
 {
-    if (snapshot_write_dword_array(m->file, dw, num) < 0) {
+    if (snapshot_write_dword_array(m->snapshot, dw, num) < 0) {
         return -1;
     }
 
@@ -414,7 +539,7 @@ int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw,
 int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 {
     int len;
-    len = snapshot_write_string(m->file, s);
+    len = snapshot_write_string(m->snapshot, s);
     if (len < 0) {
         snapshot_error = SNAPSHOT_ILLEGAL_STRING_LENGTH_ERROR;
         return -1;
@@ -428,82 +553,82 @@ int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 
 int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
 {
-    if (ftell(m->file) + sizeof(uint8_t) > m->offset + m->size) {
+    if (snapshot_tell(m->snapshot) + sizeof(uint8_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_byte(m->file, b_return);
+    return snapshot_read_byte(m->snapshot, b_return);
 }
 
 int snapshot_module_read_word(snapshot_module_t *m, uint16_t *w_return)
 {
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
+    if (snapshot_tell(m->snapshot) + sizeof(uint16_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_word(m->file, w_return);
+    return snapshot_read_word(m->snapshot, w_return);
 }
 
 int snapshot_module_read_dword(snapshot_module_t *m, uint32_t *dw_return)
 {
-    if (ftell(m->file) + sizeof(uint32_t) > m->offset + m->size) {
+    if (snapshot_tell(m->snapshot) + sizeof(uint32_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_dword(m->file, dw_return);
+    return snapshot_read_dword(m->snapshot, dw_return);
 }
 
 int snapshot_module_read_double(snapshot_module_t *m, double *db_return)
 {
-    if (ftell(m->file) + sizeof(double) > m->offset + m->size) {
+    if (snapshot_tell(m->snapshot) + sizeof(double) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_double(m->file, db_return);
+    return snapshot_read_double(m->snapshot, db_return);
 }
 
 int snapshot_module_read_byte_array(snapshot_module_t *m, uint8_t *b_return, unsigned int num)
 {
-    if ((long)(ftell(m->file) + num) > (long)(m->offset + m->size)) {
+    if ((long)(snapshot_tell(m->snapshot) + num) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_byte_array(m->file, b_return, num);
+    return snapshot_read_byte_array(m->snapshot, b_return, num);
 }
 
 int snapshot_module_read_word_array(snapshot_module_t *m, uint16_t *w_return, unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
+    if ((long)(snapshot_tell(m->snapshot) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_word_array(m->file, w_return, num);
+    return snapshot_read_word_array(m->snapshot, w_return, num);
 }
 
 int snapshot_module_read_dword_array(snapshot_module_t *m, uint32_t *dw_return, unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
+    if ((long)(snapshot_tell(m->snapshot) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_dword_array(m->file, dw_return, num);
+    return snapshot_read_dword_array(m->snapshot, dw_return, num);
 }
 
 int snapshot_module_read_string(snapshot_module_t *m, char **charp_return)
 {
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
+    if (snapshot_tell(m->snapshot) + sizeof(uint16_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_string(m->file, charp_return);
+    return snapshot_read_string(m->snapshot, charp_return);
 }
 
 int snapshot_module_read_byte_into_int(snapshot_module_t *m, int *value_return)
@@ -570,8 +695,8 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
     current_module = (char *)name;
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
-    m->offset = ftell(s->file);
+    m->snapshot = s;
+    m->offset = snapshot_tell(s);
     if (m->offset == -1) {
         snapshot_error = SNAPSHOT_ILLEGAL_OFFSET_ERROR;
         lib_free(m);
@@ -579,15 +704,15 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
     }
     m->write_mode = 1;
 
-    if (snapshot_write_padded_string(s->file, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
-        || snapshot_write_byte(s->file, major_version) < 0
-        || snapshot_write_byte(s->file, minor_version) < 0
-        || snapshot_write_dword(s->file, 0) < 0) {
+    if (snapshot_write_padded_string(s, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
+        || snapshot_write_byte(s, major_version) < 0
+        || snapshot_write_byte(s, minor_version) < 0
+        || snapshot_write_dword(s, 0) < 0) {
         return NULL;
     }
 
-    m->size = ftell(s->file) - m->offset;
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+    m->size = snapshot_tell(s) - m->offset;
+    m->size_offset = snapshot_tell(s) - sizeof(uint32_t);
 
     return m;
 }
@@ -600,13 +725,13 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
 
     current_module = (char *)name;
 
-    if (fseek(s->file, s->first_module_offset, SEEK_SET) < 0) {
+    if (snapshot_seek(s, s->first_module_offset) < 0) {
         snapshot_error = SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR;
         return NULL;
     }
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
+    m->snapshot = s;
     m->write_mode = 0;
 
     m->offset = s->first_module_offset;
@@ -614,11 +739,18 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
     /* Search for the module name.  This is quite inefficient, but I don't
        think we care.  */
     while (1) {
-        if (snapshot_read_byte_array(s->file, (uint8_t *)n,
+        if (snapshot_read_byte_array(s, (uint8_t *)n,
                                      SNAPSHOT_MODULE_NAME_LEN) < 0
-            || snapshot_read_byte(s->file, major_version_return) < 0
-            || snapshot_read_byte(s->file, minor_version_return) < 0
-            || snapshot_read_dword(s->file, &m->size)) {
+            || snapshot_read_byte(s, major_version_return) < 0
+            || snapshot_read_byte(s, minor_version_return) < 0
+            || snapshot_read_dword(s, &m->size)) {
+            snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
+            goto fail;
+        }
+
+        /* A module whose size was never backpatched (the write did not
+           finish) would make us read the same header forever.  */
+        if (m->size < SNAPSHOT_MODULE_NAME_LEN + 2 + sizeof(uint32_t)) {
             snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
             goto fail;
         }
@@ -630,18 +762,18 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t
         }
 
         m->offset += m->size;
-        if (fseek(s->file, m->offset, SEEK_SET) < 0) {
+        if (snapshot_seek(s, m->offset) < 0) {
             snapshot_error = SNAPSHOT_MODULE_NOT_FOUND_ERROR;
             goto fail;
         }
     }
 
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+    m->size_offset = snapshot_tell(s) - sizeof(uint32_t);
 
     return m;
 
 fail:
-    fseek(s->file, s->first_module_offset, SEEK_SET);
+    snapshot_seek(s, s->first_module_offset);
     lib_free(m);
     return NULL;
 }
@@ -650,14 +782,14 @@ int snapshot_module_close(snapshot_module_t *m)
 {
     /* Backpatch module size if writing.  */
     if (m->write_mode
-        && (fseek(m->file, m->size_offset, SEEK_SET) < 0
-            || snapshot_write_dword(m->file, m->size) < 0)) {
+        && (snapshot_seek(m->snapshot, m->size_offset) < 0
+            || snapshot_write_dword(m->snapshot, m->size) < 0)) {
         snapshot_error = SNAPSHOT_MODULE_CLOSE_ERROR;
         return -1;
     }
 
     /* Skip module.  */
-    if (fseek(m->file, m->offset + m->size, SEEK_SET) < 0) {
+    if (snapshot_seek(m->snapshot, m->offset + m->size) < 0) {
         snapshot_error = SNAPSHOT_MODULE_SKIP_ERROR;
         return -1;
     }
@@ -666,70 +798,119 @@ int snapshot_module_close(snapshot_module_t *m)
     return 0;
 }
 
+/* Call `func' for every module of a snapshot file that has been loaded
+   into memory, with the module name and the data after the module
+   header.  Returns the number of modules, or -1 if `buf' is not a
+   snapshot.  */
+int snapshot_module_walk(const uint8_t *buf, unsigned int len,
+                         snapshot_walk_func_t func, void *param)
+{
+    char name[SNAPSHOT_MODULE_NAME_LEN + 1];
+    size_t offs, hdr;
+    uint32_t size;
+    int count = 0;
+
+    offs = SNAPSHOT_MAGIC_LEN + 2 + SNAPSHOT_MACHINE_NAME_LEN;
+    if (len < offs || memcmp(buf, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0) {
+        return -1;
+    }
+    if (len >= offs + SNAPSHOT_VERSION_MAGIC_LEN + 8
+        && memcmp(buf + offs, snapshot_version_magic_string, SNAPSHOT_VERSION_MAGIC_LEN) == 0) {
+        offs += SNAPSHOT_VERSION_MAGIC_LEN + 8;
+    }
+
+    hdr = SNAPSHOT_MODULE_NAME_LEN + 2 + 4;
+    while (len - offs >= hdr) {
+        size = (uint32_t)buf[offs + hdr - 4]
+               | ((uint32_t)buf[offs + hdr - 3] << 8)
+               | ((uint32_t)buf[offs + hdr - 2] << 16)
+               | ((uint32_t)buf[offs + hdr - 1] << 24);
+        if (size < hdr || size > len - offs) {
+            break;
+        }
+
+        memcpy(name, buf + offs, SNAPSHOT_MODULE_NAME_LEN);
+        name[SNAPSHOT_MODULE_NAME_LEN] = 0;
+        func(name, buf + offs + hdr, (unsigned int)(size - hdr), param);
+
+        offs += size;
+        count++;
+    }
+
+    return count;
+}
+
 /* ------------------------------------------------------------------------- */
 
 snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
 {
-    FILE *f;
     snapshot_t *s;
     unsigned char viceversion[4] = { VERSION_RC_NUMBER };
 
     current_filename = (char *)filename;
 
-    f = fopen(filename, MODE_WRITE);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
-        return NULL;
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->write_mode = 1;
+    if (memory_redirect != NULL) {
+        s->memory = memory_redirect;
+        s->memory->len = 0;
+    } else {
+        s->file = fopen(filename, MODE_WRITE);
+        if (s->file == NULL) {
+            snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
+            lib_free(s);
+            return NULL;
+        }
     }
 
     /* Magic string.  */
-    if (snapshot_write_padded_string(f, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
         goto fail;
     }
 
     /* Version number.  */
-    if (snapshot_write_byte(f, major_version) < 0
-        || snapshot_write_byte(f, minor_version) < 0) {
+    if (snapshot_write_byte(s, major_version) < 0
+        || snapshot_write_byte(s, minor_version) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
         goto fail;
     }
 
     /* Machine.  */
-    if (snapshot_write_padded_string(f, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MACHINE_NAME_ERROR;
         goto fail;
     }
 
     /* VICE version and revision */
-    if (snapshot_write_padded_string(f, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
         goto fail;
     }
 
-    if (snapshot_write_byte(f, viceversion[0]) < 0
-        || snapshot_write_byte(f, viceversion[1]) < 0
-        || snapshot_write_byte(f, viceversion[2]) < 0
-        || snapshot_write_byte(f, viceversion[3]) < 0
+    if (snapshot_write_byte(s, viceversion[0]) < 0
+        || snapshot_write_byte(s, viceversion[1]) < 0
+        || snapshot_write_byte(s, viceversion[2]) < 0
+        || snapshot_write_byte(s, viceversion[3]) < 0
 #ifdef USE_SVN_REVISION
-        || snapshot_write_dword(f, VICE_SVN_REV_NUMBER) < 0) {
+        || snapshot_write_dword(s, VICE_SVN_REV_NUMBER) < 0) {
 #else
-        || snapshot_write_dword(f, 0) < 0) {
+        || snapshot_write_dword(s, 0) < 0) {
 #endif
         snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
         goto fail;
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
-    s->write_mode = 1;
+    s->first_module_offset = snapshot_tell(s);
 
     return s;
 
 fail:
-    fclose(f);
-    ioutil_remove(filename);
+    if (s->file != NULL) {
+        fclose(s->file);
+        ioutil_remove(filename);
+    }
+    lib_free(s);
     return NULL;
 }
 
@@ -737,11 +918,25 @@ fail:
 static unsigned char snapshot_viceversion[4];
 static uint32_t snapshot_vicerevision;
 
+/* number of machine snapshots read successfully so far */
+static unsigned int snapshot_read_count = 0;
+
+unsigned int snapshot_get_read_count(void)
+{
+    return snapshot_read_count;
+}
+
+/* Called by machine_read_snapshot() once the machine state has been
+   replaced, opening a snapshot only to check it does not count.  */
+void snapshot_read_done(void)
+{
+    snapshot_read_count++;
+}
+
 snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
 {
-    FILE *f;
+    snapshot_t *s;
     char magic[SNAPSHOT_MAGIC_LEN];
-    snapshot_t *s = NULL;
     int machine_name_len;
     size_t offs;
 
@@ -749,28 +944,34 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
     current_filename = (char *)filename;
     current_module = NULL;
 
-    f = zfile_fopen(filename, MODE_READ);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
-        return NULL;
+    s = lib_calloc(1, sizeof(snapshot_t));
+    if (memory_redirect != NULL) {
+        s->memory = memory_redirect;
+    } else {
+        s->file = zfile_fopen(filename, MODE_READ);
+        if (s->file == NULL) {
+            snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+            lib_free(s);
+            return NULL;
+        }
     }
 
     /* Magic string.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
+    if (snapshot_read_byte_array(s, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0) {
         snapshot_error = SNAPSHOT_MAGIC_STRING_MISMATCH_ERROR;
         goto fail;
     }
 
     /* Version number.  */
-    if (snapshot_read_byte(f, major_version_return) < 0
-        || snapshot_read_byte(f, minor_version_return) < 0) {
+    if (snapshot_read_byte(s, major_version_return) < 0
+        || snapshot_read_byte(s, minor_version_return) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
         goto fail;
     }
 
     /* Machine.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)read_name, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
+    if (snapshot_read_byte_array(s, (uint8_t *)read_name, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_READ_MACHINE_NAME_ERROR;
         goto fail;
     }
@@ -787,35 +988,35 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
     /* VICE version and revision */
     memset(snapshot_viceversion, 0, 4);
     snapshot_vicerevision = 0;
-    offs = ftell(f);
+    offs = snapshot_tell(s);
 
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
+    if (snapshot_read_byte_array(s, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_version_magic_string, SNAPSHOT_VERSION_MAGIC_LEN) != 0) {
         /* old snapshots do not contain VICE version */
-        fseek(f, offs, SEEK_SET);
+        snapshot_seek(s, (long)offs);
         log_warning(LOG_DEFAULT, "attempting to load pre 2.4.30 snapshot");
     } else {
         /* actually read the version */
-        if (snapshot_read_byte(f, &snapshot_viceversion[0]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[1]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[2]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[3]) < 0
-            || snapshot_read_dword(f, &snapshot_vicerevision) < 0) {
+        if (snapshot_read_byte(s, &snapshot_viceversion[0]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[1]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[2]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[3]) < 0
+            || snapshot_read_dword(s, &snapshot_vicerevision) < 0) {
             snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
             goto fail;
         }
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
-    s->write_mode = 0;
+    s->first_module_offset = snapshot_tell(s);
 
     vsync_suspend_speed_eval();
     return s;
 
 fail:
-    fclose(f);
+    if (s->file != NULL) {
+        zfile_fclose(s->file);
+    }
+    lib_free(s);
     return NULL;
 }
 
@@ -823,7 +1024,9 @@ int snapshot_close(snapshot_t *s)
 {
     int retval;
 
-    if (!s->write_mode) {
+    if (s->memory != NULL) {
+        retval = 0;
+    } else if (!s->write_mode) {
         if (zfile_fclose(s->file) == EOF) {
             snapshot_error = SNAPSHOT_READ_CLOSE_EOF_ERROR;
             retval = -1;
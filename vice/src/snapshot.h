@@ -62,6 +62,7 @@
 
 typedef struct snapshot_module_s snapshot_module_t;
 typedef struct snapshot_s snapshot_t;
+typedef struct snapshot_memory_s snapshot_memory_t;
 
 extern void snapshot_display_error(void);
 
@@ -136,6 +137,19 @@ extern snapshot_module_t *snapshot_module_open(snapshot_t *s,
                                                uint8_t *minor_version_return);
 extern int snapshot_module_close(snapshot_module_t *m);
 
+typedef void (*snapshot_walk_func_t)(const char *name, const uint8_t *data,
+                                     unsigned int size, void *param);
+extern int snapshot_module_walk(const uint8_t *buf, unsigned int len,
+                                snapshot_walk_func_t func, void *param);
+
+extern snapshot_memory_t *snapshot_memory_create(void);
+extern void snapshot_memory_destroy(snapshot_memory_t *mem);
+extern const uint8_t *snapshot_memory_get_data(snapshot_memory_t *mem,
+                                               unsigned int *len);
+extern void snapshot_memory_set_data(snapshot_memory_t *mem,
+                                     const uint8_t *data, unsigned int len);
+extern void snapshot_memory_redirect(snapshot_memory_t *mem);
+
 extern snapshot_t *snapshot_create(const char *filename,
                                    uint8_t major_version, uint8_t minor_version,
                                    const char *snapshot_machine_name);
@@ -144,6 +158,8 @@ extern snapshot_t *snapshot_open(const char *filename,
                                  uint8_t *minor_version_return,
                                  const char *snapshot_machine_name);
 extern int snapshot_close(snapshot_t *s);
+extern unsigned int snapshot_get_read_count(void);
+extern void snapshot_read_done(void);
 
 extern void snapshot_set_error(int error);
 
@@ -1040,6 +1040,61 @@ int vice_network_select_poll_one(vice_network_socket_t * readsockfd)
     return select( readsockfd->sockfd + 1, &fdsockset, NULL, NULL, &timeout);
 }
 
+/*! \brief Send data on a connected socket without blocking
+
+  This function sends as much of the outgoing data as the socket
+  accepts right now, and returns immediately otherwise.
+
+  \param sockfd
+     The connected socket to send to
+
+  \param buffer
+     Pointer to the buffer which holds the data to send
+
+  \param buffer_length
+     The length of the buffer pointed to by buffer.
+
+  \return
+     the number of bytes send, which can be 0 if the socket cannot
+     take any data at the moment, and -1 in case of an error.
+
+  \remark
+     Where MSG_DONTWAIT is not available, at most
+     VICE_NETWORK_NONBLOCKING_CHUNK bytes are sent after select()
+     reported the socket to be writable.
+*/
+#define VICE_NETWORK_NONBLOCKING_CHUNK 512
+
+int vice_network_send_nonblocking(vice_network_socket_t * sockfd, const void * buffer, size_t buffer_length)
+{
+    TIMEVAL timeout = { 0, 0 };
+    fd_set fdsockset;
+    int ret;
+
+    FD_ZERO(&fdsockset);
+    FD_SET(sockfd->sockfd, &fdsockset);
+
+    ret = select(sockfd->sockfd + 1, NULL, &fdsockset, NULL, &timeout);
+    if (ret <= 0) {
+        return ret;
+    }
+
+    signals_pipe_set();
+#ifdef MSG_DONTWAIT
+    ret = send(sockfd->sockfd, buffer, buffer_length, MSG_DONTWAIT);
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        ret = 0;
+    }
+#else
+    if (buffer_length > VICE_NETWORK_NONBLOCKING_CHUNK) {
+        buffer_length = VICE_NETWORK_NONBLOCKING_CHUNK;
+    }
+    ret = send(sockfd->sockfd, buffer, buffer_length, 0);
+#endif
+    signals_pipe_unset();
+    return ret;
+}
+
 /*! \brief Get the error of the last socket operation
 
   This function determines the error code for the last
@@ -38,6 +38,8 @@
 #define TAP_HDR_SYSTEM       13
 #define TAP_HDR_LEN          16
 
+#define TAP_READ_BUFFER_SIZE 0x10000
+
 
 struct tape_init_s;
 struct tape_file_record_s;
@@ -95,6 +97,24 @@ typedef struct tap_s {
 
     /* Has the tap changed? We correct the size then.  */
     int has_changed;
+
+    /* Read buffer used while decoding, `read_pos' is the file position
+       while `read_depth' is nonzero.  */
+    uint8_t *read_buffer;
+    long read_buffer_start;
+    size_t read_buffer_len;
+    long read_pos;
+    int read_depth;
+
+    /* File positions and pilot types of the headers found so far, set
+       `file_index_count' to 0 when the image is written to.  The index is
+       kept in a sidecar file next to the image, `file_index_saved' is the
+       number of entries that file holds.  */
+    long *file_index_pos;
+    int *file_index_type;
+    int file_index_count;
+    int file_index_size;
+    int file_index_saved;
 } tap_t;
 
 extern void tap_init(const struct tape_init_s *init);
@@ -110,4 +130,6 @@ extern struct tape_file_record_s *tap_get_current_file_record(tap_t *tap);
 
 extern int tap_read(tap_t *tap, uint8_t *buf, size_t size);
 
+extern void tap_set_index_write(int enable);
+
 #endif
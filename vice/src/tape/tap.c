@@ -33,6 +33,7 @@
 
 #include "archdep.h"
 #include "datasette.h"
+#include "ioutil.h"
 #include "lib.h"
 #include "tap.h"
 #include "tape.h"
@@ -62,6 +63,10 @@
 #define PILOT_TYPE_CBM 0
 #define PILOT_TYPE_TT  1
 
+/* Sidecar file with the header index, see tap_index_load().  */
+#define TAP_INDEX_SUFFIX ".vtx"
+#define TAP_INDEX_HEADER "# VICE tape header index 1"
+
 /* Default values.  Call tap_init() to change. */
 static int tap_pulse_short_min = 0x24;
 static int tap_pulse_short_max = 0x36;
@@ -75,6 +80,9 @@ static int tap_pulse_tt_short_max = 0x22;
 static int tap_pulse_tt_long_min = 0x23;
 static int tap_pulse_tt_long_max = 0x36;
 
+/* Write the header index next to the image, see tap_set_index_write().  */
+static int tap_index_write = 1;
+
 
 static int tap_header_read(tap_t *tap, FILE *fd)
 {
@@ -97,6 +105,122 @@ static int tap_header_read(tap_t *tap, FILE *fd)
     return 0;
 }
 
+/* The header index of an image is kept in `<image>.vtx', starting with
+   the size and modification time of the image it was made for, followed
+   by one line with file position and pilot type per header.  An index
+   whose image has a different size or time is ignored.  */
+
+static int tap_index_image_stat(const char *name, unsigned int *size,
+                                unsigned long *mtime)
+{
+    unsigned int isdir;
+
+    if (ioutil_stat(name, size, &isdir) != 0 || isdir
+        || ioutil_mtime(name, mtime) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void tap_index_append(tap_t *tap, long pos, int type)
+{
+    if (tap->file_index_count == tap->file_index_size) {
+        tap->file_index_size = tap->file_index_size ? tap->file_index_size * 2 : 64;
+        tap->file_index_pos = lib_realloc(tap->file_index_pos,
+                                          tap->file_index_size * sizeof(long));
+        tap->file_index_type = lib_realloc(tap->file_index_type,
+                                           tap->file_index_size * sizeof(int));
+    }
+    tap->file_index_pos[tap->file_index_count] = pos;
+    tap->file_index_type[tap->file_index_count] = type;
+    tap->file_index_count++;
+}
+
+static void tap_index_load(tap_t *tap)
+{
+    char *index_name;
+    FILE *fd;
+    char line[80];
+    unsigned int size, index_size;
+    unsigned long mtime, index_mtime;
+    long pos;
+    int type;
+
+    if (tap_index_image_stat(tap->file_name, &size, &mtime) < 0) {
+        return;
+    }
+
+    index_name = util_concat(tap->file_name, TAP_INDEX_SUFFIX, NULL);
+    fd = fopen(index_name, MODE_READ_TEXT);
+    lib_free(index_name);
+    if (fd == NULL) {
+        return;
+    }
+
+    if (fgets(line, sizeof(line), fd) == NULL
+        || strncmp(line, TAP_INDEX_HEADER, strlen(TAP_INDEX_HEADER)) != 0
+        || fgets(line, sizeof(line), fd) == NULL
+        || sscanf(line, "%u %lu", &index_size, &index_mtime) != 2
+        || index_size != size || index_mtime != mtime) {
+        fclose(fd);
+        return;
+    }
+
+    while (fgets(line, sizeof(line), fd) != NULL) {
+        if (sscanf(line, "%ld %d", &pos, &type) != 2
+            || pos < tap->offset
+            || (type != PILOT_TYPE_CBM && type != PILOT_TYPE_TT)) {
+            tap->file_index_count = 0;
+            break;
+        }
+        tap_index_append(tap, pos, type);
+    }
+    fclose(fd);
+
+    tap->file_index_saved = tap->file_index_count;
+}
+
+/* Called after the image is closed, so the size and time are final.  */
+static void tap_index_save(tap_t *tap)
+{
+    char *index_name;
+    FILE *fd;
+    unsigned int size;
+    unsigned long mtime;
+    int i;
+
+    if (!tap_index_write
+        || tap->file_index_count <= tap->file_index_saved
+        || tap_index_image_stat(tap->file_name, &size, &mtime) < 0) {
+        return;
+    }
+
+    index_name = util_concat(tap->file_name, TAP_INDEX_SUFFIX, NULL);
+    fd = fopen(index_name, MODE_WRITE_TEXT);
+    if (fd != NULL) {
+        int failed;
+
+        fprintf(fd, "%s\n%u %lu\n", TAP_INDEX_HEADER, size, mtime);
+        for (i = 0; i < tap->file_index_count; i++) {
+            fprintf(fd, "%ld %d\n", tap->file_index_pos[i],
+                    tap->file_index_type[i]);
+        }
+        failed = ferror(fd);
+        if (fclose(fd) != 0 || failed) {
+            /* The index is only a cache, a partial one is not kept.  */
+            ioutil_remove(index_name);
+        }
+    }
+    lib_free(index_name);
+}
+
+/* Enable or disable writing the header index file when an image is
+   closed.  An existing index is still read.  */
+void tap_set_index_write(int enable)
+{
+    tap_index_write = enable ? 1 : 0;
+}
+
 static tap_t *tap_new(void)
 {
     tap_t *tap;
@@ -162,6 +286,8 @@ tap_t *tap_open(const char *name, unsigned int *read_only)
     new->current_file_data = NULL;
     new->current_file_size = 0;
 
+    tap_index_load(new);
+
     return new;
 }
 
@@ -177,6 +303,9 @@ int tap_close(tap_t *tap)
         }
         retval = zfile_fclose(tap->fd);
         tap->fd = NULL;
+        if (retval == 0) {
+            tap_index_save(tap);
+        }
     } else {
         retval = 0;
     }
@@ -184,6 +313,9 @@ int tap_close(tap_t *tap)
     lib_free(tap->current_file_data);
     lib_free(tap->file_name);
     lib_free(tap->tap_file_record);
+    lib_free(tap->read_buffer);
+    lib_free(tap->file_index_pos);
+    lib_free(tap->file_index_type);
     lib_free(tap);
 
     return retval;
@@ -226,6 +358,84 @@ int tap_create(const char *name)
 
 static int tap_find_pilot(tap_t *tap, int type);
 
+/* Buffered access to the image while decoding.  The decoder reads single
+   pulses and often steps back a few bytes, which would make stdio throw
+   away its buffer on every seek.  Between tap_read_begin() and
+   tap_read_end() all positioning is done in `read_pos' and the image is
+   read in blocks of TAP_READ_BUFFER_SIZE bytes.  */
+
+static void tap_read_begin(tap_t *tap)
+{
+    if (tap->read_depth++ == 0) {
+        /* the datasette may have moved or written in the meantime */
+        tap->read_pos = ftell(tap->fd);
+        tap->read_buffer_len = 0;
+    }
+}
+
+static void tap_read_end(tap_t *tap)
+{
+    if (--tap->read_depth == 0) {
+        fseek(tap->fd, tap->read_pos, SEEK_SET);
+    }
+}
+
+static size_t tap_fread(void *ptr, size_t size, size_t nmemb, tap_t *tap)
+{
+    uint8_t *dest = ptr;
+    size_t len = size * nmemb;
+    size_t done = 0;
+
+    while (done < len) {
+        size_t avail, offset;
+
+        if (tap->read_pos < tap->read_buffer_start
+            || tap->read_pos >= tap->read_buffer_start
+                                + (long)tap->read_buffer_len) {
+            if (tap->read_buffer == NULL) {
+                tap->read_buffer = lib_malloc(TAP_READ_BUFFER_SIZE);
+            }
+            tap->read_buffer_start = tap->read_pos;
+            tap->read_buffer_len = 0;
+            if (fseek(tap->fd, tap->read_pos, SEEK_SET) == 0) {
+                tap->read_buffer_len = fread(tap->read_buffer, 1,
+                                             TAP_READ_BUFFER_SIZE, tap->fd);
+            }
+            if (tap->read_buffer_len == 0) {
+                break;
+            }
+        }
+
+        offset = (size_t)(tap->read_pos - tap->read_buffer_start);
+        avail = tap->read_buffer_len - offset;
+        if (avail > len - done) {
+            avail = len - done;
+        }
+        memcpy(dest + done, tap->read_buffer + offset, avail);
+        done += avail;
+        tap->read_pos += (long)avail;
+    }
+
+    return size ? done / size : 0;
+}
+
+static long tap_ftell(tap_t *tap)
+{
+    return tap->read_pos;
+}
+
+static int tap_fseek(tap_t *tap, long offset, int whence)
+{
+    if (whence == SEEK_CUR) {
+        offset += tap->read_pos;
+    }
+    if (offset < 0) {
+        return -1;
+    }
+    tap->read_pos = offset;
+    return 0;
+}
+
 inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
 {
     uint8_t data;
@@ -233,7 +443,7 @@ inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
     size_t res;
 
     *pos_advance = 0;
-    res = fread(&data, 1, 1, tap->fd);
+    res = tap_fread(&data, 1, 1, tap);
 
     if (res == 0) {
         return -1;
@@ -246,7 +456,7 @@ inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
             pulse_length = 256;
         } else if ((tap->version == 1) || (tap->version == 2)) {
             uint8_t size[3];
-            res = fread(size, 3, 1, tap->fd);
+            res = tap_fread(size, 3, 1, tap);
             if (res == 0) {
                 return -1;
             }
@@ -261,7 +471,7 @@ inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
     if (tap->version == 2) {
         uint32_t pulse_length2;
 
-        res = fread(&data, 1, 1, tap->fd);
+        res = tap_fread(&data, 1, 1, tap);
 
         if (res == 0) {
             return -1;
@@ -269,7 +479,7 @@ inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
         *pos_advance += (int)res;
         if (data == 0) {
             uint8_t size[3];
-            res = fread(size, 3, 1, tap->fd);
+            res = tap_fread(size, 3, 1, tap);
             if (res == 0) {
                 return -1;
             }
@@ -382,7 +592,7 @@ static int tap_cbm_skip_pilot(tap_t *tap)
 
     errors = 0;
     counter = 0;
-    current_filepos = ftell(tap->fd);
+    current_filepos = tap_ftell(tap);
     while (1) {
         /*  Save file position */
         fpos = current_filepos;
@@ -391,7 +601,7 @@ static int tap_cbm_skip_pilot(tap_t *tap)
         fpos2 = current_filepos;
         if (TAP_PULSE_LONG(data)) {
             /* found an L pulse, try to read a byte */
-            fseek(tap->fd, fpos, SEEK_SET);
+            tap_fseek(tap, fpos, SEEK_SET);
             current_filepos = fpos;
             data = tap_cbm_read_byte(tap);
             if (data == -1) {
@@ -404,12 +614,12 @@ static int tap_cbm_skip_pilot(tap_t *tap)
                 }
 
                 /* Start over after the L pulse */
-                fseek(tap->fd, fpos2, SEEK_SET);
+                tap_fseek(tap, fpos2, SEEK_SET);
                 current_filepos = fpos2;
                 counter = 0;
             } else {
                 /* success.  Go back to start of byte and return */
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap_fseek(tap, fpos, SEEK_SET);
                 current_filepos = fpos;
                 return 0;
             }
@@ -766,13 +976,13 @@ static int tap_cbm_skip_file(tap_t *tap)
         int ret;
 
         while (1) {
-            fpos = ftell(tap->fd);
+            fpos = tap_ftell(tap);
 
             /* find next pilot */
             ret = tap_find_pilot(tap, PILOT_TYPE_CBM);
             if (ret < 0) {
                 /* no more pilot found => end of data */
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap_fseek(tap, fpos, SEEK_SET);
                 break;
             }
 
@@ -780,7 +990,7 @@ static int tap_cbm_skip_file(tap_t *tap)
             ret = tap_cbm_read_block(tap, buffer, 193);
             if (ret < 1 || buffer[0] != 2) {
                 /* next block is not a data continuation block => end of data */
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap_fseek(tap, fpos, SEEK_SET);
                 break;
             }
         }
@@ -847,7 +1057,7 @@ static int tap_tt_skip_pilot(tap_t *tap)
     int data;
 
 #if TAP_DEBUG > 1
-    log_debug("\nTAP_TT_SKIP_PILOT(0x%X", ftell(tap->fd));
+    log_debug("\nTAP_TT_SKIP_PILOT(0x%X", tap_ftell(tap));
 #endif
 
     /* turbo-tape pilot is just repeats of value 0x02 */
@@ -860,12 +1070,12 @@ static int tap_tt_skip_pilot(tap_t *tap)
         if (data != 2) {
             /* value != 0x02, we found the end of the pilot.  Go back
                so byte can be read again */
-            fseek(tap->fd, -8, SEEK_CUR);
+            tap_fseek(tap, -8, SEEK_CUR);
         }
     } while (data == 2);
 
 #if TAP_DEBUG > 1
-    log_debug("-0x%X) ", ftell(tap->fd));
+    log_debug("-0x%X) ", tap_ftell(tap));
 #endif
 
     return 0;
@@ -1103,7 +1313,7 @@ static int tap_find_pilot(tap_t *tap, int type)
        file */
     minCBM = (type == PILOT_TYPE_ANY) ? 1000 : PILOT_MIN_LENGTH_CBM;
 
-    startCBM = ftell(tap->fd);
+    startCBM = tap_ftell(tap);
     startTT = startCBM;
     countCBM = 0;
     countTT = 0;
@@ -1113,9 +1323,9 @@ static int tap_find_pilot(tap_t *tap, int type)
 #endif
 
     while ((countCBM < minCBM) && (countTT < PILOT_MIN_LENGTH_TT * 8)) {
-/*        count = fread(&data, 1, 256, tap->fd); */
-        int startpos = ftell(tap->fd);
-        int readlen = (int)fread(buffer, 1, 256, tap->fd);
+/*        count = tap_fread(&data, 1, 256, tap); */
+        int startpos = tap_ftell(tap);
+        int readlen = (int)tap_fread(buffer, 1, 256, tap);
         uint32_t pulse_length = 0;
         int j = 0;
         int needed;
@@ -1136,7 +1346,7 @@ static int tap_find_pilot(tap_t *tap, int type)
                         /* There is not enough in the buffer
                            Read some more */
                         memcpy(buffer, buffer + i + 1, still_in_buffer);
-                        res = (int)fread(buffer + still_in_buffer, 1, needed, tap->fd);
+                        res = (int)tap_fread(buffer + still_in_buffer, 1, needed, tap);
                         i = readlen;
                         if (res == 0) {
                             continue;
@@ -1154,7 +1364,7 @@ static int tap_find_pilot(tap_t *tap, int type)
                 uint32_t pulse_length2;
                 /*  Read one more byte if run out of buffer */
                 if (i == readlen) {
-                    readlen = (int)fread(buffer, 1, 1, tap->fd);
+                    readlen = (int)tap_fread(buffer, 1, 1, tap);
                     if (readlen == 0) {
                         continue;
                     }
@@ -1170,7 +1380,7 @@ static int tap_find_pilot(tap_t *tap, int type)
                         /* There is not enough in the buffer
                            Read some more */
                         memcpy(buffer, buffer + i + 1, still_in_buffer);
-                        res = (int)fread(buffer + still_in_buffer, 1, needed, tap->fd);
+                        res = (int)tap_fread(buffer + still_in_buffer, 1, needed, tap);
                         i = readlen;
                         if (res == 0) {
                             continue;
@@ -1186,14 +1396,14 @@ static int tap_find_pilot(tap_t *tap, int type)
             j++;
         }
         count = j;
-        pos[j] = ftell(tap->fd);
+        pos[j] = tap_ftell(tap);
 
 /*        for (i = 0, count = 0; i < 256; i++, count++) {
-            pos[i] = ftell(tap->fd);
+            pos[i] = tap_ftell(tap);
             data[i] = tap_get_pulse(tap);
             if (data[i] < 0) break;
         }
-        pos[i] = ftell(tap->fd);*/
+        pos[i] = tap_ftell(tap);*/
         if (count < 1) {
             return -1;
         }
@@ -1254,10 +1464,10 @@ static int tap_find_pilot(tap_t *tap, int type)
         /* startTT points to a '1' bit which we assume to be part of the
            value 00000010.  Skip over the 1 and following 0 so we start
            at the beginning of a 00000010 sequence */
-        fseek(tap->fd, startTT + 2, SEEK_SET);
+        tap_fseek(tap, startTT + 2, SEEK_SET);
         return 1;
     } else {
-        fseek(tap->fd, startCBM, SEEK_SET);
+        tap_fseek(tap, startCBM, SEEK_SET);
         return 0;
     }
 }
@@ -1277,21 +1487,21 @@ static int tap_find_header(tap_t *tap)
         }
 
         /* store current position in TAP file */
-        fpos = ftell(tap->fd);
+        fpos = tap_ftell(tap);
 
         /* try to read a header */
         if (type == PILOT_TYPE_CBM) {
             res = tap_cbm_read_header(tap);
             if (res < 0) {
                 int pos_advance;
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap_fseek(tap, fpos, SEEK_SET);
                 while (TAP_PULSE_SHORT(tap_get_pulse(tap, &pos_advance))) {
                 }
             }
         } else if (type == PILOT_TYPE_TT) {
             res = tap_tt_read_header(tap);
             if (res < 0) {
-                fseek(tap->fd, fpos, SEEK_SET);
+                tap_fseek(tap, fpos, SEEK_SET);
                 tap_tt_skip_pilot(tap);
             }
         } else {
@@ -1305,7 +1515,7 @@ static int tap_find_header(tap_t *tap)
             }
 
             /* success.  Rewind to start of header and return. */
-            fseek(tap->fd, fpos, SEEK_SET);
+            tap_fseek(tap, fpos, SEEK_SET);
             tap->current_file_seek_position = fpos;
             return type;
         }
@@ -1323,7 +1533,7 @@ static int tap_read_file(tap_t *tap)
 #endif
 
     /* store current position in TAP file */
-    fpos = ftell(tap->fd);
+    fpos = tap_ftell(tap);
 
     /* clear old file data */
     tap->current_file_size = 0;
@@ -1349,7 +1559,7 @@ static int tap_read_file(tap_t *tap)
     }
 
     /* go back to previous position in TAP file */
-    fseek(tap->fd, fpos, SEEK_SET);
+    tap_fseek(tap, fpos, SEEK_SET);
 
 #if TAP_DEBUG > 0
     log_debug("\nTAP_READ_FILE(END%i)\n", ret);
@@ -1408,27 +1618,85 @@ int tap_seek_start(tap_t *tap)
     tap->current_file_number = -1;
     tap->current_file_seek_position = 0;
     fseek(tap->fd, tap->offset, SEEK_SET);
+    if (tap->read_depth > 0) {
+        tap->read_pos = tap->offset;
+    }
+    return 0;
+}
+
+/* Remember where the header of the next file was found.  */
+static void tap_index_add(tap_t *tap, int type)
+{
+    if (tap->current_file_number + 1 != tap->file_index_count) {
+        return;
+    }
+
+    tap_index_append(tap, tap_ftell(tap), type);
+}
+
+/* Go to a file whose header was already found, without decoding the
+   files in front of it again.  */
+static int tap_index_seek(tap_t *tap, unsigned int file_number)
+{
+    long fpos = tap->file_index_pos[file_number];
+    int res;
+
+    tap_seek_start(tap);
+    tap_fseek(tap, fpos, SEEK_SET);
+
+    if (tap->file_index_type[file_number] == PILOT_TYPE_CBM) {
+        res = tap_cbm_read_header(tap);
+    } else {
+        res = tap_tt_read_header(tap);
+    }
+
+    if (res < 0) {
+        /* should not happen, the image must have changed */
+        tap->file_index_count = 0;
+        tap->file_index_saved = 0;
+        return -1;
+    }
+
+    tap_fseek(tap, fpos, SEEK_SET);
+    tap->current_file_seek_position = fpos;
+    tap->current_file_number = (int)file_number;
     return 0;
 }
 
 int tap_seek_to_file(tap_t *tap, unsigned int file_number)
 {
+    int ret = 0;
+
+    tap_read_begin(tap);
+
+    if ((int)file_number < tap->file_index_count
+        && tap_index_seek(tap, file_number) == 0) {
+        tap_read_end(tap);
+        return 0;
+    }
+
     tap_seek_start(tap);
     while ((int) file_number > tap->current_file_number) {
         if (tap_seek_to_next_file(tap, 0) < 0) {
-            return -1;
+            ret = -1;
+            break;
         }
     }
 
-    return 0;
+    tap_read_end(tap);
+    return ret;
 }
 
 int tap_seek_to_next_file(tap_t *tap, unsigned int allow_rewind)
 {
+    int type;
+
     if (tap == NULL) {
         return -1;
     }
 
+    tap_read_begin(tap);
+
     /* clear old file content buffer */
     tap->current_file_size = 0;
     lib_free(tap->current_file_data);
@@ -1440,36 +1708,50 @@ int tap_seek_to_next_file(tap_t *tap, unsigned int allow_rewind)
         tap_skip_file(tap);
     }
 
-    if (tap_find_header(tap) < 0) {
+    type = tap_find_header(tap);
+    if (type < 0) {
         if (allow_rewind) {
             tap_seek_start(tap);
-            if (tap_find_header(tap) < 0) {
+            type = tap_find_header(tap);
+            if (type < 0) {
+                tap_read_end(tap);
                 return -1;
             }
         } else {
+            tap_read_end(tap);
             return -1;
         }
     }
 
+    tap_index_add(tap, type);
+
     tap->current_file_number++;
+    tap_read_end(tap);
     return 0;
 }
 
 int tap_read(tap_t *tap, uint8_t *buf, size_t size)
 {
     if (tap->current_file_data == NULL) {
+        int ret;
+
         /* no file data yet */
         if (tap->current_file_size > 0) {
             return -1; /* data==NULL and size>0 indicates read error */
         } else {
+            tap_read_begin(tap);
+
             /* if at beginning of TAP file, seek to first file */
             if (tap->current_file_number < 0) {
                 if (tap_seek_to_next_file(tap, 0) < 0) {
+                    tap_read_end(tap);
                     return -1;
                 }
             }
 
-            if (tap_read_file(tap) < 0) {
+            ret = tap_read_file(tap);
+            tap_read_end(tap);
+            if (ret < 0) {
                 return -1; /* reading the file failed */
             } else {
                 tap->current_file_data_pos = 0;
@@ -47,6 +47,7 @@
 #include "types.h"
 #include "vdrive-bam.h"
 #include "vdrive-command.h"
+#include "vdrive-dir.h"
 #include "vdrive.h"
 
 /*
@@ -76,6 +77,38 @@ static int vdrive_calculate_disk_half(vdrive_t *vdrive)
     return -1;
 }
 
+/*
+    Returns non-zero if the bitmap of \a track has any free sector left, so
+    the allocators can pass over full tracks without testing every sector.
+    The free count byte can't be trusted, see vdrive_bam_get_track_entry().
+*/
+static int vdrive_bam_track_has_free(vdrive_t *vdrive, unsigned int track,
+                                     unsigned int max_sector)
+{
+    uint8_t *bamp;
+    unsigned int i;
+
+    /* Tracks > 70 don't go into the (regular) BAM on 1571 */
+    if ((track > NUM_TRACKS_1571) && (vdrive->image_format == VDRIVE_IMAGE_FORMAT_1571)) {
+        return 0;
+    }
+
+    bamp = vdrive_bam_get_track_entry(vdrive, track);
+    if (bamp == NULL || max_sector > 256) {
+        return bamp != NULL;
+    }
+
+    for (i = 0; i < max_sector / 8; i++) {
+        if (bamp[1 + i]) {
+            return 1;
+        }
+    }
+    if (max_sector % 8) {
+        return bamp[1 + i] & ((1 << (max_sector % 8)) - 1);
+    }
+    return 0;
+}
+
 /*
     FIXME: partition support
 */
@@ -96,6 +129,9 @@ int vdrive_bam_alloc_first_free_sector(vdrive_t *vdrive,
 #endif
         if (d && t >= 1) {
             max_sector = vdrive_get_max_sectors(vdrive, t);
+            if (!vdrive_bam_track_has_free(vdrive, t, max_sector)) {
+                max_sector = 0;
+            }
             for (s = 0; s < (unsigned int)max_sector; s++) {
                 if (vdrive_bam_allocate_sector(vdrive, t, s)) {
                     *track = t;
@@ -121,6 +157,9 @@ int vdrive_bam_alloc_first_free_sector(vdrive_t *vdrive,
             } else {
                 s = max_sector; /* skip bam track */
             }
+            if (!vdrive_bam_track_has_free(vdrive, t, max_sector)) {
+                s = max_sector;
+            }
             for (; s < (unsigned int)max_sector; s++) {
                 if (vdrive_bam_allocate_sector(vdrive, t, s)) {
                     *track = t;
@@ -144,6 +183,9 @@ static int vdrive_bam_alloc_down(vdrive_t *vdrive,
 
     for (t = *track; t >= 1; t--) {
         max_sector = vdrive_get_max_sectors(vdrive, t);
+        if (!vdrive_bam_track_has_free(vdrive, t, max_sector)) {
+            continue;
+        }
         for (s = 0; s < max_sector; s++) {
             if (vdrive_bam_allocate_sector(vdrive, t, s)) {
                 *track = t;
@@ -162,6 +204,9 @@ static int vdrive_bam_alloc_up(vdrive_t *vdrive,
 
     for (t = *track; t <= vdrive->num_tracks; t++) {
         max_sector = vdrive_get_max_sectors(vdrive, t);
+        if (!vdrive_bam_track_has_free(vdrive, t, max_sector)) {
+            continue;
+        }
         for (s = 0; s < max_sector; s++) {
             if (vdrive_bam_allocate_sector(vdrive, t, s)) {
                 *track = t;
@@ -438,6 +483,46 @@ int vdrive_bam_free_sector(vdrive_t *vdrive, unsigned int track,
     return 0;
 }
 
+/*
+    Returns 1 if the sector is allocated in the BAM, 0 if it is free and -1
+    if the BAM does not cover the track (tracks 36-40 on 1541 and 2040,
+    tracks > 70 on 1571).  Uses the same bit order as
+    vdrive_bam_allocate_sector().
+*/
+int vdrive_bam_is_sector_allocated(vdrive_t *vdrive, unsigned int track,
+                                   unsigned int sector)
+{
+    uint8_t *bamp;
+
+    switch (vdrive->image_format) {
+        case VDRIVE_IMAGE_FORMAT_1541:
+        case VDRIVE_IMAGE_FORMAT_2040:
+            if (track > NUM_TRACKS_1541) {
+                return -1;
+            }
+            break;
+        case VDRIVE_IMAGE_FORMAT_1571:
+            if (track > NUM_TRACKS_1571) {
+                return -1;
+            }
+            break;
+        case VDRIVE_IMAGE_FORMAT_4000:
+            sector ^= 7;
+            break;
+        default:
+            break;
+    }
+
+    if (track < 1 || track > vdrive->num_tracks || sector > 255) {
+        return -1;
+    }
+    bamp = vdrive_bam_get_track_entry(vdrive, track);
+    if (bamp == NULL) {
+        return -1;
+    }
+    return vdrive_bam_isset(bamp, sector) ? 0 : 1;
+}
+
 void vdrive_bam_clear_all(vdrive_t *vdrive)
 {
     uint8_t *bam = vdrive->bam;
@@ -683,6 +768,10 @@ int vdrive_bam_read_bam(vdrive_t *vdrive)
 {
     int err = -1, i;
 
+    /* The image may have been changed behind our back, so anything cached
+       from the directory is stale as well.  */
+    vdrive_dir_cache_invalidate(vdrive);
+
     switch (vdrive->image_format) {
         case VDRIVE_IMAGE_FORMAT_2040:
         case VDRIVE_IMAGE_FORMAT_1541:
@@ -783,7 +872,7 @@ int vdrive_bam_write_bam(vdrive_t *vdrive)
             err |= vdrive_write_sector(vdrive, vdrive->bam + 256, BAM_TRACK_8050 - 1, BAM_SECTOR_8050);
             err |= vdrive_write_sector(vdrive, vdrive->bam + 512, BAM_TRACK_8050 - 1, BAM_SECTOR_8050 + 3);
 
-            if (vdrive->image_format == 8050) {
+            if (vdrive->image_format == VDRIVE_IMAGE_FORMAT_8050) {
                 break;
             }
 
@@ -808,6 +897,16 @@ int vdrive_bam_write_bam(vdrive_t *vdrive)
  * Return the number of free blocks on disk.
  */
 
+/* Number of bits set in a BAM bitmap byte.  */
+static unsigned int vdrive_bam_popcount(uint8_t bits)
+{
+    static const uint8_t nibble_bits[16] = {
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+    };
+
+    return nibble_bits[bits & 0x0f] + nibble_bits[bits >> 4];
+}
+
 unsigned int vdrive_bam_free_block_count(vdrive_t *vdrive)
 {
     unsigned int blocks, i, j;
@@ -859,8 +958,8 @@ unsigned int vdrive_bam_free_block_count(vdrive_t *vdrive)
                 }
                 break;
             case VDRIVE_IMAGE_FORMAT_4000:
-                for (j = ((i == vdrive->Bam_Track) ? 64 : 0); j < 256; j++) {
-                    blocks += (vdrive->bam[BAM_BIT_MAP_4000 + 256 + 32 * (i - 1) + j / 8] >> (j % 8)) & 1;
+                for (j = ((i == vdrive->Bam_Track) ? 64 : 0); j < 256; j += 8) {
+                    blocks += vdrive_bam_popcount(vdrive->bam[BAM_BIT_MAP_4000 + 256 + 32 * (i - 1) + j / 8]);
                 }
                 break;
             default:
@@ -61,6 +61,75 @@ void vdrive_dir_init(void)
     vdrive_dir_log = log_open("VDriveDIR");
 }
 
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Directory sector cache.
+ *
+ * Every OPEN, SAVE or SCRATCH walks the directory chain from the header
+ * sector on, so the sectors it visits are kept in memory.  Writes through
+ * vdrive_write_sector() update the cached copy, anything that rereads the
+ * BAM (attach, INITIALIZE, true drive emulation changes) drops the cache.
+ */
+
+static vdrive_dir_cache_t *vdrive_dir_cache_entry(vdrive_t *vdrive,
+                                                  unsigned int track,
+                                                  unsigned int sector)
+{
+    return &vdrive->dir_cache[((track << 4) + sector)
+                              & (VDRIVE_DIR_CACHE_SIZE - 1)];
+}
+
+void vdrive_dir_cache_invalidate(vdrive_t *vdrive)
+{
+    unsigned int i;
+
+    for (i = 0; i < VDRIVE_DIR_CACHE_SIZE; i++) {
+        vdrive->dir_cache[i].track = 0;
+    }
+}
+
+/* Called for every sector written to the image.  \a valid is zero if the
+   write failed, in which case the cached copy is dropped. */
+void vdrive_dir_cache_update(vdrive_t *vdrive, const uint8_t *buf,
+                             unsigned int track, unsigned int sector,
+                             int valid)
+{
+    vdrive_dir_cache_t *entry = vdrive_dir_cache_entry(vdrive, track, sector);
+
+    if (entry->track != track || entry->sector != sector) {
+        return;
+    }
+    if (valid) {
+        memcpy(entry->data, buf, 256);
+    } else {
+        entry->track = 0;
+    }
+}
+
+/* Read a directory sector, from the cache if possible. */
+int vdrive_dir_read_sector(vdrive_t *vdrive, uint8_t *buf,
+                           unsigned int track, unsigned int sector)
+{
+    vdrive_dir_cache_t *entry = vdrive_dir_cache_entry(vdrive, track, sector);
+    int status;
+
+    if (track != 0 && entry->track == track && entry->sector == sector) {
+        memcpy(buf, entry->data, 256);
+        return 0;
+    }
+
+    status = vdrive_read_sector(vdrive, buf, track, sector);
+    if (status == 0 && track != 0) {
+        entry->track = track;
+        entry->sector = sector;
+        memcpy(entry->data, buf, 256);
+    }
+    return status;
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* Returns the interleave for directory sectors of a given image type */
 static int vdrive_dir_get_interleave(unsigned int type)
 {
@@ -220,7 +289,7 @@ void vdrive_dir_find_first_slot(vdrive_t *vdrive, const char *name,
     dir->sector = vdrive->Header_Sector;
     dir->slot = 7;
 
-    vdrive_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
+    vdrive_dir_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
 
     dir->buffer[0] = vdrive->Dir_Track;
     dir->buffer[1] = vdrive->Dir_Sector;
@@ -262,7 +331,7 @@ uint8_t *vdrive_dir_find_next_slot(vdrive_dir_context_t *dir)
             dir->track = (unsigned int)dir->buffer[0];
             dir->sector = (unsigned int)dir->buffer[1];
 
-            status = vdrive_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
+            status = vdrive_dir_read_sector(vdrive, dir->buffer, dir->track, dir->sector);
             if (status != 0) {
                 return NULL; /* error */
             }
@@ -66,6 +66,16 @@ typedef struct vdrive_dir_context_s {
     struct vdrive_s *vdrive;
 } vdrive_dir_context_t;
 
+/* Number of directory sectors kept in memory per vdrive, must be a power of 2 */
+#define VDRIVE_DIR_CACHE_SIZE 64
+
+/* Cached copy of a directory sector, track 0 marks an unused entry. */
+typedef struct vdrive_dir_cache_s {
+    unsigned int track;
+    unsigned int sector;
+    uint8_t data[256];
+} vdrive_dir_cache_t;
+
 extern void vdrive_dir_init(void);
 extern int vdrive_dir_first_directory(struct vdrive_s *vdrive, const char *name, int length, int filetype, struct bufferinfo_s *p);
 extern int vdrive_dir_next_directory(struct vdrive_s *vdrive, struct bufferinfo_s *b);
@@ -76,5 +86,8 @@ extern int vdrive_dir_filetype(const char *name, int length);
 extern void vdrive_dir_remove_slot(vdrive_dir_context_t *dir);
 extern void vdrive_dir_create_slot(struct bufferinfo_s *p, char *realname, int reallength, int filetype);
 extern void vdrive_dir_free_chain(struct vdrive_s *vdrive, int t, int s);
+extern int vdrive_dir_read_sector(struct vdrive_s *vdrive, uint8_t *buf, unsigned int track, unsigned int sector);
+extern void vdrive_dir_cache_update(struct vdrive_s *vdrive, const uint8_t *buf, unsigned int track, unsigned int sector, int valid);
+extern void vdrive_dir_cache_invalidate(struct vdrive_s *vdrive);
 
 #endif
@@ -152,6 +152,7 @@ void vdrive_device_shutdown(vdrive_t *vdrive)
             p = &(vdrive->buffers[i]);
             vdrive_free_buffer(p);
             lib_free(p->buffer);
+            p->buffer = NULL;
         }
     }
 }
@@ -229,6 +230,7 @@ void vdrive_detach_image(disk_image_t *image, unsigned int unit,
     lib_free(vdrive->bam);
     vdrive->bam = NULL;
     vdrive->image = NULL;
+    vdrive_dir_cache_invalidate(vdrive);
 }
 
 int vdrive_attach_image(disk_image_t *image, unsigned int unit,
@@ -445,7 +447,11 @@ int vdrive_read_sector(vdrive_t *vdrive, uint8_t *buf, unsigned int track, unsig
 int vdrive_write_sector(vdrive_t *vdrive, const uint8_t *buf, unsigned int track, unsigned int sector)
 {
     disk_addr_t dadr;
+    int rc;
+
     dadr.track = track;
     dadr.sector = sector;
-    return disk_image_write_sector(vdrive->image, buf, &dadr);
+    rc = disk_image_write_sector(vdrive->image, buf, &dadr);
+    vdrive_dir_cache_update(vdrive, buf, track, sector, rc == 0);
+    return rc;
 }
@@ -146,6 +146,9 @@ typedef struct vdrive_s {
     /* BYTE *side_sector; */
 
     uint8_t ram[0x800];
+
+    /* Directory sectors read by the directory search, see vdrive-dir.c */
+    vdrive_dir_cache_t dir_cache[VDRIVE_DIR_CACHE_SIZE];
 } vdrive_t;
 
 /* Actually, serial-code errors ... */
@@ -45,6 +45,7 @@
 #endif
 
 #include "behrbonz.h"
+#include "bootsnapshot.h"
 #include "c64acia.h"
 #include "cartridge.h"
 #include "cmdline.h"
@@ -443,12 +444,14 @@ int cartridge_attach_image(int type, const char *filename)
     }
     if (ret == 0) {
         cartridge_attach(type, NULL);
+        bootsnapshot_cartridge_attach(type_orig, filename);
     }
     return ret;
 }
 
 void cartridge_detach_image(int type)
 {
+    bootsnapshot_cartridge_detach(-1);
     cartridge_detach(vic20cart_type);
     vic20cart_type = CARTRIDGE_NONE;
     cartridge_is_from_snapshot = 0;
@@ -84,6 +84,7 @@
 #include "sidcart.h"
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "tape.h"
 #include "tapeport.h"
@@ -1196,7 +1197,11 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks,
 
 int machine_read_snapshot(const char *name, int event_mode)
 {
-    return vic20_snapshot_read(name, event_mode);
+    if (vic20_snapshot_read(name, event_mode) < 0) {
+        return -1;
+    }
+    snapshot_read_done();
+    return 0;
 }
 
 
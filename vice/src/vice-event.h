@@ -46,6 +46,7 @@
 #define EVENT_SYNC_TEST         14
 #define EVENT_KEYBOARD_CLEAR    15
 #define EVENT_RESOURCE          16
+#define EVENT_KEYFRAME          17
 
 #define EVENT_START_MODE_FILE_SAVE 0
 #define EVENT_START_MODE_FILE_LOAD 1
@@ -87,9 +88,15 @@ extern int event_record_active(void);
 extern int event_playback_active(void);
 extern int event_record_set_milestone(void);
 extern int event_record_reset_milestone(void);
+extern int event_playback_seek(unsigned int seconds);
+
+extern void event_vsync_hook(void);
+extern uint32_t event_state_hash(void);
 
 extern void event_reset_ack(void);
 
+extern void event_record_input_list(event_list_state_t *list);
+extern void event_playback_input(event_list_t *event);
 extern void event_record_in_list(event_list_state_t *list, unsigned int type,
                                  void *data, unsigned int size);
 extern void event_record(unsigned int type, void *data, unsigned int size);
@@ -59,10 +59,12 @@ int vsync_frame_counter;
 #include "clkguard.h"
 #include "cmdline.h"
 #include "debug.h"
+#include "inputscript.h"
 #include "log.h"
 #include "maincpu.h"
 #include "machine.h"
 #ifdef HAVE_NETWORK
+#include "monitor_binary.h"
 #include "monitor_network.h"
 #endif
 #include "network.h"
@@ -70,6 +72,7 @@ int vsync_frame_counter;
 #include "sound.h"
 #include "translate.h"
 #include "types.h"
+#include "vice-event.h"
 #include "vsync.h"
 #include "vsyncapi.h"
 
@@ -374,10 +377,14 @@ int vsync_do_vsync(struct video_canvas_s *c, int been_skipped)
 #ifdef HAVE_NETWORK
     /* check if someone wants to connect remotely to the monitor */
     monitor_check_remote();
+    monitor_check_binary();
 #endif
 
     vsync_frame_counter++;
 
+    event_vsync_hook();
+    inputscript_vsync_hook();
+
     /*
      * process everything wich should be done before the synchronisation
      * e.g. OS/2: exit the programm if trigger_shutdown set
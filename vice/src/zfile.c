@@ -50,6 +50,7 @@
 #endif
 
 #include "archdep.h"
+#include "crc32.h"
 #include "ioutil.h"
 #include "lib.h"
 #include "log.h"
@@ -91,11 +92,47 @@ struct zfile_s {
     struct zfile_s *prev, *next; /* Link to the previous and next nodes.  */
     zfile_action_t action;       /* action on close */
     char *request_string;        /* ui string for action=ZFILE_REQUEST */
+    unsigned long tmp_crc;       /* CRC32 of the temporary file at open.  */
+    void *mem_data;              /* Buffer behind an in-memory stream.  */
 };
 typedef struct zfile_s zfile_t;
 
 static zfile_t *zfile_list = NULL;
 
+#ifdef HAVE_ZLIB
+/* Images up to this size are decompressed into memory.  */
+#define ZFILE_CACHE_MAX_LEN (4 * 1024 * 1024)
+
+/* Number of decompressed images kept around.  */
+#define ZFILE_CACHE_ENTRIES 8
+
+/* Recently decompressed gzip files, so attaching the same image again
+   (fliplist, autostart) does not decompress it again.  */
+typedef struct zfile_cache_s {
+    char *name;         /* Complete path of the compressed file.  */
+    unsigned long crc;  /* CRC32 of the compressed file.  */
+    uint8_t *data;      /* Decompressed contents.  */
+    size_t len;
+    unsigned int stamp; /* Time of last use, 0 if the entry is unused.  */
+} zfile_cache_t;
+
+static zfile_cache_t zfile_cache[ZFILE_CACHE_ENTRIES];
+static unsigned int zfile_cache_stamp = 0;
+
+static void zfile_cache_destroy(void)
+{
+    int i;
+
+    for (i = 0; i < ZFILE_CACHE_ENTRIES; i++) {
+        lib_free(zfile_cache[i].name);
+        lib_free(zfile_cache[i].data);
+        zfile_cache[i].name = NULL;
+        zfile_cache[i].data = NULL;
+        zfile_cache[i].stamp = 0;
+    }
+}
+#endif
+
 static log_t zlog = LOG_ERR;
 
 /* ------------------------------------------------------------------------- */
@@ -175,6 +212,8 @@ static void zfile_list_add(const char *tmp_name,
     new_zfile->type = type;
     new_zfile->action = ZFILE_KEEP;
     new_zfile->request_string = NULL;
+    new_zfile->tmp_crc = 0;
+    new_zfile->mem_data = NULL;
     new_zfile->next = zfile_list;
     new_zfile->prev = NULL;
     if (zfile_list != NULL) {
@@ -186,12 +225,125 @@ static void zfile_list_add(const char *tmp_name,
 void zfile_shutdown(void)
 {
     zfile_list_destroy();
+#ifdef HAVE_ZLIB
+    zfile_cache_destroy();
+#endif
 }
 
 /* ------------------------------------------------------------------------ */
 
 /* Uncompression.  */
 
+#ifdef HAVE_ZLIB
+/* Return the decompressed contents of the gzip file `name', NULL if it
+   cannot be read or is larger than ZFILE_CACHE_MAX_LEN.  The data belongs
+   to the cache and stays valid until the next call.  */
+static zfile_cache_t *zfile_cache_get(const char *name)
+{
+    zfile_cache_t *entry = NULL;
+    char *full_name = NULL;
+    unsigned long crc;
+    gzFile fdsrc;
+    uint8_t *data;
+    size_t len, size;
+    int i, n;
+
+    crc = crc32_file(name);
+    archdep_expand_path(&full_name, name);
+
+    for (i = 0; i < ZFILE_CACHE_ENTRIES; i++) {
+        if (zfile_cache[i].stamp != 0
+            && zfile_cache[i].crc == crc
+            && !strcmp(zfile_cache[i].name, full_name)) {
+            ZDEBUG(("zfile_cache_get: `%s' found in cache", name));
+            lib_free(full_name);
+            zfile_cache[i].stamp = ++zfile_cache_stamp;
+            return &zfile_cache[i];
+        }
+        /* replace the least recently used entry */
+        if (entry == NULL || zfile_cache[i].stamp < entry->stamp) {
+            entry = &zfile_cache[i];
+        }
+    }
+
+    fdsrc = gzopen(name, MODE_READ);
+    if (fdsrc == NULL) {
+        lib_free(full_name);
+        return NULL;
+    }
+
+    size = 0x10000;
+    data = lib_malloc(size);
+    len = 0;
+    do {
+        if (len == size) {
+            if (size >= ZFILE_CACHE_MAX_LEN) {
+                gzclose(fdsrc);
+                lib_free(data);
+                lib_free(full_name);
+                return NULL;
+            }
+            size *= 2;
+            data = lib_realloc(data, size);
+        }
+        n = gzread(fdsrc, (void *)(data + len), (unsigned int)(size - len));
+        if (n < 0) {
+            gzclose(fdsrc);
+            lib_free(data);
+            lib_free(full_name);
+            return NULL;
+        }
+        len += (size_t)n;
+    } while (n > 0);
+
+    gzclose(fdsrc);
+
+    lib_free(entry->name);
+    lib_free(entry->data);
+    entry->name = full_name;
+    entry->crc = crc;
+    entry->data = data;
+    entry->len = len;
+    entry->stamp = ++zfile_cache_stamp;
+
+    return entry;
+}
+
+#ifdef HAVE_FMEMOPEN
+/* Open the gzip file `name' for reading as a stream on a copy of its
+   decompressed contents, without a temporary file.  */
+static FILE *zfile_fopen_memory(const char *name, const char *mode)
+{
+    zfile_cache_t *entry;
+    FILE *stream;
+    void *data;
+
+    if (!file_is_gzip(name)) {
+        return NULL;
+    }
+
+    entry = zfile_cache_get(name);
+    if (entry == NULL || entry->len == 0) {
+        return NULL;
+    }
+
+    data = lib_malloc(entry->len);
+    memcpy(data, entry->data, entry->len);
+
+    stream = fmemopen(data, entry->len, mode);
+    if (stream == NULL) {
+        lib_free(data);
+        return NULL;
+    }
+
+    zfile_list_add(NULL, name, COMPR_GZIP, 0, stream, NULL);
+    zfile_list->mem_data = data;
+
+    return stream;
+}
+#endif
+#endif
+
 /* If `name' has a gzip-like extension, try to uncompress it into a temporary
    file using gzip or zlib if available.  If this succeeds, return the name
    of the temporary file; return NULL otherwise.  */
@@ -201,6 +353,7 @@ static char *try_uncompress_with_gzip(const char *name)
     FILE *fddest;
     gzFile fdsrc;
     char *tmp_name = NULL;
+    zfile_cache_t *entry;
     int len;
 
     if (!file_is_gzip(name)) {
@@ -213,6 +366,18 @@ static char *try_uncompress_with_gzip(const char *name)
         return NULL;
     }
 
+    entry = zfile_cache_get(name);
+    if (entry != NULL) {
+        if (fwrite((void *)entry->data, 1, entry->len, fddest) < entry->len) {
+            fclose(fddest);
+            ioutil_remove(tmp_name);
+            lib_free(tmp_name);
+            return NULL;
+        }
+        fclose(fddest);
+        return tmp_name;
+    }
+
     fdsrc = gzopen(name, MODE_READ);
     if (fdsrc == NULL) {
         fclose(fddest);
@@ -764,6 +929,24 @@ static const valid_archives_t valid_archives[] = {
     { NULL, NULL, NULL, NULL, NULL }
 };
 
+#if defined(HAVE_ZLIB) && defined(HAVE_FMEMOPEN)
+/* Check whether `name' has the extension of one of the archive formats,
+   these are handled by try_uncompress_archive() first.  */
+static int is_archive_name(const char *name)
+{
+    size_t l = strlen(name), len;
+    int i;
+
+    for (i = 0; valid_archives[i].program; i++) {
+        len = strlen(valid_archives[i].extension);
+        if (l > len && !strcasecmp(name + l - len, valid_archives[i].extension)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
 /* Try to uncompress file `name' using the algorithms we know of.  If this is
    not possible, return `COMPR_NONE'.  Otherwise, uncompress the file into a
    temporary file, return the type of algorithm used and the name of the
@@ -824,27 +1007,33 @@ static int compress_with_gzip(const char *src, const char *dest)
     gzFile fddest;
     size_t len;
 
-    fdsrc = fopen(dest, MODE_READ);
+    fdsrc = fopen(src, MODE_READ);
     if (fdsrc == NULL) {
         return -1;
     }
 
-    fddest = gzopen(src, MODE_WRITE "9");
+    fddest = gzopen(dest, MODE_WRITE "9");
     if (fddest == NULL) {
         fclose(fdsrc);
         return -1;
     }
 
     do {
-        char buf[256];
-        len = fread((void *)buf, 256, 1, fdsrc);
+        char buf[4096];
+        len = fread((void *)buf, 1, sizeof(buf), fdsrc);
         if (len > 0) {
-            gzwrite(fddest, (void *)buf, (unsigned int)len);
+            if (gzwrite(fddest, (void *)buf, (unsigned int)len) != (int)len) {
+                gzclose(fddest);
+                fclose(fdsrc);
+                return -1;
+            }
         }
     } while (len > 0);
 
-    gzclose(fddest);
     fclose(fdsrc);
+    if (gzclose(fddest) != Z_OK) {
+        return -1;
+    }
 
     ZDEBUG(("compress with zlib: OK."));
 
@@ -1047,6 +1236,15 @@ FILE *zfile_fopen(const char *name, const char *mode)
         return NULL;
     }
 
+#if defined(HAVE_ZLIB) && defined(HAVE_FMEMOPEN)
+    if (!write_mode && !is_archive_name(name)) {
+        stream = zfile_fopen_memory(name, mode);
+        if (stream != NULL) {
+            return stream;
+        }
+    }
+#endif
+
     type = try_uncompress(name, &tmp_name, write_mode);
     if (type == COMPR_NONE) {
         stream = fopen(name, mode);
@@ -1068,6 +1266,12 @@ FILE *zfile_fopen(const char *name, const char *mode)
 
     zfile_list_add(tmp_name, name, type, write_mode, stream, NULL);
 
+    /* Remember the contents, so closing an image that was only read does
+       not recompress it.  */
+    if (write_mode && (type == COMPR_GZIP || type == COMPR_BZIP)) {
+        zfile_list->tmp_crc = crc32_file(tmp_name);
+    }
+
     /* now we don't need the archdep_tmpnam allocation any more */
     lib_free(tmp_name);
 
@@ -1110,6 +1314,7 @@ static int handle_close(zfile_t *ptr)
         /* Recompress into the original file.  */
         if (ptr->orig_name
             && ptr->write_mode
+            && crc32_file(ptr->tmp_name) != ptr->tmp_crc
             && zfile_compress(ptr->tmp_name, ptr->orig_name, ptr->type)) {
             return -1;
         }
@@ -1142,6 +1347,7 @@ static int handle_close(zfile_t *ptr)
     if (ptr->request_string) {
         lib_free(ptr->request_string);
     }
+    lib_free(ptr->mem_data);
 
     lib_free(ptr);
 